@@ -0,0 +1,509 @@
+/*
+ * Copyright (C) 2024  OverbearingPearl
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ * The above copyright notice and this permission notice shall be included in
+ * all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+ * THE SOFTWARE.
+ */
+
+// Drives every cache policy, directly and through Memoization, over the
+// standard workloads and prints one result per run as CSV or JSON:
+//
+//   cmake --build build --target benchmarks
+//   build/benchmarks/benchmarks --threads=8 --format=json > results.json
+//
+// Modes: "policy" calls Get/Insert on a bare policy (single-threaded, as
+// policies are not thread-safe); "memoize" shares one Memoize'd function
+// between the threads; "sharded" does the same with MemoizeSharded, and
+// "front" with MemoizeWithFrontCache, whose hit ratio leaves out the hits
+// answered by the threads' front caches, and "read-mostly" with
+// MemoizeReadMostly (not for TTL, which it does not accept).
+//
+// Running "policy" at two --capacity values shows whether a policy's cost
+// per operation grows with its size (it should not for any of them):
+//
+//   build/benchmarks/benchmarks --filter=policy/lfu --capacity=256
+//   build/benchmarks/benchmarks --filter=policy/lfu --capacity=16384
+
+#include <atomic>
+#include <chrono>
+#include <cstdint>
+#include <cstdlib>
+#include <functional>
+#include <iostream>
+#include <memory>
+#include <string>
+#include <thread>
+#include <tuple>
+#include <type_traits>
+#include <utility>
+#include <vector>
+
+#include "benchmarks/heap_usage.h"
+#include "benchmarks/workloads.h"
+#include "src/side_effects/cache/cache_arc.h"
+#include "src/side_effects/cache/cache_clock.h"
+#include "src/side_effects/cache/cache_fifo.h"
+#include "src/side_effects/cache/cache_flush.h"
+#include "src/side_effects/cache/cache_lfu.h"
+#include "src/side_effects/cache/cache_lru.h"
+#include "src/side_effects/cache/cache_rr.h"
+#include "src/side_effects/cache/cache_sieve.h"
+#include "src/side_effects/cache/cache_tinylfu.h"
+#include "src/side_effects/cache/cache_ttl.h"
+#include "src/side_effects/cache/cache_two_queue.h"
+#include "src/side_effects/memoization/latency_histogram.h"
+#include "src/side_effects/memoization/memoization.h"
+
+namespace benchmarks {
+namespace {
+
+namespace cache = side_effects::cache;
+
+using Key = std::tuple<int>;
+using Clock = std::chrono::steady_clock;
+using side_effects::memoization::LatencyHistogram;
+using side_effects::memoization::LatencySnapshot;
+
+// Every kSampleEvery-th operation is timed on its own for the latency
+// percentiles; throughput is measured over the whole run.
+constexpr size_t kSampleEvery = 8;
+
+struct Options {
+  Options()
+      : max_threads(std::max(1u, std::thread::hardware_concurrency())),
+        ops(200000),
+        keys(100000),
+        capacity(10000),
+        shards(side_effects::memoization::kDefaultShardCount),
+        format("csv") {}
+
+  size_t max_threads;
+  size_t ops;  // Per thread.
+  int keys;
+  size_t capacity;
+  size_t shards;
+  std::string format;
+  std::string filter;
+};
+
+struct Result {
+  // The measurements start at zero and are filled in by the run.
+  Result(std::string mode, std::string policy, std::string workload,
+         size_t threads)
+      : mode(std::move(mode)),
+        policy(std::move(policy)),
+        workload(std::move(workload)),
+        threads(threads),
+        ops(0),
+        seconds(0),
+        hit_ratio(0),
+        bytes_per_entry(0) {}
+
+  std::string mode;
+  std::string policy;
+  std::string workload;
+  size_t threads;
+  uint64_t ops;
+  double seconds;
+  LatencySnapshot latency;
+  double hit_ratio;
+  double bytes_per_entry;
+};
+
+class Reporter {
+ public:
+  explicit Reporter(const Options& options)
+      : json_(options.format == "json"), first_(true) {
+    if (json_) {
+      std::cout << "[\n";
+    } else {
+      std::cout << "mode,policy,workload,threads,ops,seconds,ops_per_sec,"
+                   "p50_ns,p99_ns,hit_ratio,bytes_per_entry\n";
+    }
+  }
+
+  ~Reporter() {
+    if (json_) {
+      std::cout << "\n]\n";
+    }
+  }
+
+  void Report(const Result& result) {
+    double throughput = result.seconds > 0 ? result.ops / result.seconds : 0;
+    uint64_t p50 = result.latency.ValueAtPercentile(50);
+    uint64_t p99 = result.latency.ValueAtPercentile(99);
+    if (json_) {
+      std::cout << (first_ ? "" : ",\n") << "  {\"mode\": \"" << result.mode
+                << "\", \"policy\": \"" << result.policy
+                << "\", \"workload\": \"" << result.workload
+                << "\", \"threads\": " << result.threads
+                << ", \"ops\": " << result.ops
+                << ", \"seconds\": " << result.seconds
+                << ", \"ops_per_sec\": " << throughput
+                << ", \"p50_ns\": " << p50 << ", \"p99_ns\": " << p99
+                << ", \"hit_ratio\": " << result.hit_ratio
+                << ", \"bytes_per_entry\": " << result.bytes_per_entry << "}";
+    } else {
+      std::cout << result.mode << ',' << result.policy << ','
+                << result.workload << ',' << result.threads << ','
+                << result.ops << ',' << result.seconds << ',' << throughput
+                << ',' << p50 << ',' << p99 << ',' << result.hit_ratio << ','
+                << result.bytes_per_entry << '\n';
+    }
+    std::cout.flush();
+    first_ = false;
+  }
+
+ private:
+  bool json_;
+  bool first_;
+};
+
+double Seconds(Clock::duration elapsed) {
+  return std::chrono::duration<double>(elapsed).count();
+}
+
+uint64_t Nanos(Clock::duration elapsed) {
+  return static_cast<uint64_t>(
+      std::chrono::duration_cast<std::chrono::nanoseconds>(elapsed).count());
+}
+
+// Heap growth between the two readings per entry. The heap can shrink
+// over a run (buffers of an earlier run are freed), which counts as 0.
+double BytesPerEntry(size_t heap_before, size_t heap_after, size_t entries) {
+  if (entries == 0 || heap_after <= heap_before) {
+    return 0;
+  }
+  return static_cast<double>(heap_after - heap_before) / entries;
+}
+
+int Compute(int key) { return key * 2 + 1; }
+
+template <typename Policy, typename MakePolicy>
+Result RunPolicy(const std::string& name, MakePolicy make_policy,
+                 const Workload& workload, const Options& options) {
+  std::vector<int> trace =
+      workload.Make(options.ops, options.keys, options.capacity, 1);
+  std::unique_ptr<LatencyHistogram> latency(new LatencyHistogram());
+  Result result("policy", name, workload.name, 1);
+  result.ops = trace.size();
+
+  size_t heap_before = LiveHeapBytes();
+  std::unique_ptr<Policy> policy(new Policy(make_policy(options.capacity)));
+  std::unique_ptr<typename Policy::CacheType> cache(
+      new typename Policy::CacheType());
+  Clock::time_point start = Clock::now();
+  for (size_t i = 0; i < trace.size(); ++i) {
+    Clock::time_point begin;
+    if (i % kSampleEvery == 0) {
+      begin = Clock::now();
+    }
+    Key key(trace[i]);
+    if (policy->Get(cache.get(), key) == nullptr) {
+      policy->Insert(cache.get(), key, Compute(trace[i]));
+    }
+    if (i % kSampleEvery == 0) {
+      latency->Record(Nanos(Clock::now() - begin));
+    }
+  }
+  result.seconds = Seconds(Clock::now() - start);
+  result.bytes_per_entry =
+      BytesPerEntry(heap_before, LiveHeapBytes(), cache->size());
+  result.hit_ratio = policy->Stats(*cache).HitRatio();
+  result.latency = latency->Snapshot();
+  return result;
+}
+
+// Runs threads copies of the loop over func, each on its own trace, and
+// fills in throughput and latency.
+template <typename Func>
+void RunThreads(Func func, const Workload& workload, size_t threads,
+                const Options& options, Result* result) {
+  std::vector<std::vector<int>> traces;
+  std::vector<std::unique_ptr<LatencyHistogram>> latencies;
+  for (size_t t = 0; t < threads; ++t) {
+    traces.push_back(
+        workload.Make(options.ops, options.keys, options.capacity, t + 1));
+    latencies.emplace_back(new LatencyHistogram());
+  }
+
+  std::atomic<size_t> ready(0);
+  std::atomic<bool> go(false);
+  std::atomic<int> sink(0);
+  std::vector<std::thread> workers;
+  for (size_t t = 0; t < threads; ++t) {
+    workers.emplace_back([&, t]() {
+      const std::vector<int>& trace = traces[t];
+      LatencyHistogram& latency = *latencies[t];
+      int local = 0;
+      ready.fetch_add(1);
+      while (!go.load(std::memory_order_acquire)) {
+        std::this_thread::yield();
+      }
+      for (size_t i = 0; i < trace.size(); ++i) {
+        if (i % kSampleEvery == 0) {
+          Clock::time_point begin = Clock::now();
+          local += func(trace[i]);
+          latency.Record(Nanos(Clock::now() - begin));
+        } else {
+          local += func(trace[i]);
+        }
+      }
+      sink.fetch_add(local, std::memory_order_relaxed);
+    });
+  }
+  while (ready.load() != threads) {
+    std::this_thread::yield();
+  }
+  Clock::time_point start = Clock::now();
+  go.store(true, std::memory_order_release);
+  for (auto& worker : workers) {
+    worker.join();
+  }
+  result->seconds = Seconds(Clock::now() - start);
+  result->ops = threads * options.ops;
+  for (const auto& latency : latencies) {
+    result->latency += latency->Snapshot();
+  }
+}
+
+// Memory per entry covers the table and policy; the traces RunThreads
+// builds are freed again before it returns.
+template <typename MemoizedFunc>
+void FinishMemoized(const MemoizedFunc& func, size_t heap_before,
+                    Result* result) {
+  side_effects::cache::CacheStats stats = func.Stats();
+  result->hit_ratio = stats.HitRatio();
+  result->bytes_per_entry =
+      BytesPerEntry(heap_before, LiveHeapBytes(), stats.size);
+}
+
+template <typename MakePolicy>
+Result RunMemoize(const std::string& name, MakePolicy make_policy,
+                  const Workload& workload, size_t threads,
+                  const Options& options) {
+  Result result("memoize", name, workload.name, threads);
+  side_effects::memoization::Memoization memoization;
+  size_t heap_before = LiveHeapBytes();
+  auto func = memoization.Memoize(std::function<int(int)>(Compute),
+                                  make_policy(options.capacity));
+  RunThreads(func, workload, threads, options, &result);
+  FinishMemoized(func, heap_before, &result);
+  return result;
+}
+
+template <typename MakePolicy>
+Result RunSharded(const std::string& name, MakePolicy make_policy,
+                  const Workload& workload, size_t threads,
+                  const Options& options) {
+  Result result("sharded", name, workload.name, threads);
+  side_effects::memoization::Memoization memoization;
+  size_t shard_capacity =
+      (options.capacity + options.shards - 1) / options.shards;
+  size_t heap_before = LiveHeapBytes();
+  auto func = memoization.MemoizeSharded(std::function<int(int)>(Compute),
+                                         make_policy(shard_capacity),
+                                         options.shards);
+  RunThreads(func, workload, threads, options, &result);
+  FinishMemoized(func, heap_before, &result);
+  return result;
+}
+
+template <typename MakePolicy>
+Result RunFront(const std::string& name, MakePolicy make_policy,
+                const Workload& workload, size_t threads,
+                const Options& options) {
+  Result result("front", name, workload.name, threads);
+  side_effects::memoization::Memoization memoization;
+  size_t heap_before = LiveHeapBytes();
+  auto func = memoization.MemoizeWithFrontCache(
+      std::function<int(int)>(Compute), make_policy(options.capacity));
+  RunThreads(func, workload, threads, options, &result);
+  FinishMemoized(func, heap_before, &result);
+  return result;
+}
+
+template <typename MakePolicy>
+Result RunReadMostly(const std::string& name, MakePolicy make_policy,
+                     const Workload& workload, size_t threads,
+                     const Options& options) {
+  Result result("read-mostly", name, workload.name, threads);
+  side_effects::memoization::Memoization memoization;
+  size_t heap_before = LiveHeapBytes();
+  auto func = memoization.MemoizeReadMostly(std::function<int(int)>(Compute),
+                                            make_policy(options.capacity));
+  RunThreads(func, workload, threads, options, &result);
+  FinishMemoized(func, heap_before, &result);
+  return result;
+}
+
+// MemoizeReadMostly takes policies whose hits can be shared or deferred.
+template <typename Policy>
+using ReadMostlyCapable =
+    std::integral_constant<bool, Policy::kConcurrentHits ||
+                                     Policy::kDeferredHits>;
+
+template <typename MakePolicy>
+void ReportReadMostly(const std::string& name, MakePolicy make_policy,
+                      const Workload& workload, size_t threads,
+                      const Options& options, Reporter* reporter,
+                      std::true_type) {
+  reporter->Report(
+      RunReadMostly(name, make_policy, workload, threads, options));
+}
+
+template <typename MakePolicy>
+void ReportReadMostly(const std::string&, MakePolicy, const Workload&, size_t,
+                      const Options&, Reporter*, std::false_type) {}
+
+// 1, 2, 4, ... up to and including max_threads.
+std::vector<size_t> ThreadCounts(size_t max_threads) {
+  std::vector<size_t> counts;
+  for (size_t threads = 1; threads < max_threads; threads *= 2) {
+    counts.push_back(threads);
+  }
+  counts.push_back(max_threads);
+  return counts;
+}
+
+bool Selected(const Options& options, const std::string& run) {
+  return options.filter.empty() ||
+         run.find(options.filter) != std::string::npos;
+}
+
+template <typename Policy, typename MakePolicy>
+void RunAll(const std::string& name, MakePolicy make_policy,
+            const Options& options, Reporter* reporter) {
+  for (const Workload& workload : StandardWorkloads()) {
+    std::string run = name + "/" + workload.name;
+    if (Selected(options, "policy/" + run)) {
+      reporter->Report(RunPolicy<Policy>(name, make_policy, workload, options));
+    }
+    for (size_t threads : ThreadCounts(options.max_threads)) {
+      if (Selected(options, "memoize/" + run)) {
+        reporter->Report(
+            RunMemoize(name, make_policy, workload, threads, options));
+      }
+      if (Selected(options, "sharded/" + run)) {
+        reporter->Report(
+            RunSharded(name, make_policy, workload, threads, options));
+      }
+      if (Selected(options, "front/" + run)) {
+        reporter->Report(
+            RunFront(name, make_policy, workload, threads, options));
+      }
+      if (Selected(options, "read-mostly/" + run)) {
+        ReportReadMostly(name, make_policy, workload, threads, options,
+                         reporter, ReadMostlyCapable<Policy>());
+      }
+    }
+  }
+}
+
+// Policies sized by entry count alone.
+template <typename Policy>
+Policy WithCapacity(size_t capacity) {
+  return Policy(capacity);
+}
+
+template <template <typename, typename> class Policy>
+void RunSized(const std::string& name, const Options& options,
+              Reporter* reporter) {
+  RunAll<Policy<Key, int>>(name, &WithCapacity<Policy<Key, int>>, options,
+                           reporter);
+}
+
+void RunEveryPolicy(const Options& options, Reporter* reporter) {
+  RunSized<cache::CacheWithArcPolicy>("arc", options, reporter);
+  RunSized<cache::CacheWithClockPolicy>("clock", options, reporter);
+  RunSized<cache::CacheWithFifoPolicy>("fifo", options, reporter);
+  RunSized<cache::CacheWithFlushPolicy>("flush", options, reporter);
+  RunSized<cache::CacheWithLfuPolicy>("lfu", options, reporter);
+  RunSized<cache::CacheWithLruPolicy>("lru", options, reporter);
+  RunSized<cache::CacheWithRrPolicy>("rr", options, reporter);
+  RunSized<cache::CacheWithSampledLruPolicy>("sampled-lru", options, reporter);
+  RunSized<cache::CacheWithSievePolicy>("sieve", options, reporter);
+  RunSized<cache::CacheWithTinyLfuPolicy>("tinylfu", options, reporter);
+  RunSized<cache::CacheWithTwoQueuePolicy>("2q", options, reporter);
+  // Long enough that nothing expires during a run: this measures the
+  // timer wheel's bookkeeping, not expiry.
+  RunAll<cache::CacheWithTtlPolicy<Key, int>>(
+      "ttl",
+      [](size_t capacity) {
+        return cache::CacheWithTtlPolicy<Key, int>(std::chrono::minutes(10),
+                                                   capacity);
+      },
+      options, reporter);
+}
+
+bool ParseFlag(const std::string& arg, const std::string& flag,
+               std::string* value) {
+  std::string prefix = "--" + flag + "=";
+  if (arg.compare(0, prefix.size(), prefix) != 0) {
+    return false;
+  }
+  *value = arg.substr(prefix.size());
+  return true;
+}
+
+bool ParseOptions(int argc, char** argv, Options* options) {
+  for (int i = 1; i < argc; ++i) {
+    std::string arg = argv[i];
+    std::string value;
+    if (ParseFlag(arg, "threads", &value)) {
+      options->max_threads = std::max(1ul, std::strtoul(value.c_str(), 0, 10));
+    } else if (ParseFlag(arg, "ops", &value)) {
+      options->ops = std::strtoul(value.c_str(), 0, 10);
+    } else if (ParseFlag(arg, "keys", &value)) {
+      options->keys = std::max(1, std::atoi(value.c_str()));
+    } else if (ParseFlag(arg, "capacity", &value)) {
+      options->capacity = std::max(1ul, std::strtoul(value.c_str(), 0, 10));
+    } else if (ParseFlag(arg, "shards", &value)) {
+      options->shards = std::max(1ul, std::strtoul(value.c_str(), 0, 10));
+    } else if (ParseFlag(arg, "format", &value) &&
+               (value == "csv" || value == "json")) {
+      options->format = value;
+    } else if (ParseFlag(arg, "filter", &value)) {
+      options->filter = value;
+    } else {
+      return false;
+    }
+  }
+  return true;
+}
+
+}  // namespace
+}  // namespace benchmarks
+
+int main(int argc, char** argv) {
+  benchmarks::Options options;
+  if (!benchmarks::ParseOptions(argc, argv, &options)) {
+    std::cerr << "usage: " << argv[0]
+              << " [--threads=N] [--ops=N] [--keys=N] [--capacity=N]"
+                 " [--shards=N] [--format=csv|json] [--filter=SUBSTRING]\n"
+                 "--filter matches mode/policy/workload, e.g. "
+                 "sharded/lru/zipf-0.9\n";
+    return 1;
+  }
+  if (!benchmarks::HeapUsageTracked()) {
+    std::cerr << "heap usage is not tracked on this platform; "
+                 "bytes_per_entry will be 0\n";
+  }
+  benchmarks::Reporter reporter(options);
+  benchmarks::RunEveryPolicy(options, &reporter);
+  return 0;
+}
@@ -0,0 +1,73 @@
+/*
+ * Copyright (C) 2024  OverbearingPearl
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ * The above copyright notice and this permission notice shall be included in
+ * all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+ * THE SOFTWARE.
+ */
+
+#include "benchmarks/heap_usage.h"
+
+#include <atomic>
+#include <cstdlib>
+#include <new>
+
+#if defined(__GLIBC__)
+#include <malloc.h>
+#define BENCHMARKS_TRACK_HEAP
+#endif
+
+namespace benchmarks {
+namespace {
+
+std::atomic<size_t> live_bytes(0);
+
+}  // namespace
+
+bool HeapUsageTracked() {
+#ifdef BENCHMARKS_TRACK_HEAP
+  return true;
+#else
+  return false;
+#endif
+}
+
+size_t LiveHeapBytes() { return live_bytes.load(std::memory_order_relaxed); }
+
+}  // namespace benchmarks
+
+#ifdef BENCHMARKS_TRACK_HEAP
+
+// The array and nothrow forms forward to these two.
+void* operator new(size_t size) {
+  void* block = std::malloc(size == 0 ? 1 : size);
+  if (block == nullptr) {
+    throw std::bad_alloc();
+  }
+  benchmarks::live_bytes.fetch_add(malloc_usable_size(block),
+                                   std::memory_order_relaxed);
+  return block;
+}
+
+void operator delete(void* block) noexcept {
+  if (block != nullptr) {
+    benchmarks::live_bytes.fetch_sub(malloc_usable_size(block),
+                                     std::memory_order_relaxed);
+    std::free(block);
+  }
+}
+
+#endif
@@ -0,0 +1,140 @@
+/*
+ * Copyright (C) 2024  OverbearingPearl
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ * The above copyright notice and this permission notice shall be included in
+ * all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+ * THE SOFTWARE.
+ */
+
+#pragma once
+
+#include <algorithm>
+#include <cmath>
+#include <cstddef>
+#include <cstdint>
+#include <string>
+#include <vector>
+
+#include "src/utils/random/xoshiro.h"
+
+namespace benchmarks {
+
+// A named key distribution. Make(length, keys, capacity, seed) returns one
+// thread's trace of length accesses over keys 0..keys-1; scans and loops
+// are sized from capacity, the cache under test's. Threads get different
+// seeds but draw from the same key space, so they share hot keys.
+struct Workload {
+  enum class Kind { kUniform, kZipf, kScan, kLoop, kMixed };
+
+  std::string name;
+  Kind kind;
+  double skew;  // kZipf and kMixed only.
+
+  std::vector<int> Make(size_t length, int keys, size_t capacity,
+                        uint64_t seed) const;
+};
+
+// Uniform, Zipfian at skews 0.6, 0.9 and 1.2, a sequential scan, a loop
+// slightly larger than the cache, and Zipf 0.9 interrupted by scans.
+inline std::vector<Workload> StandardWorkloads() {
+  return {{"uniform", Workload::Kind::kUniform, 0},
+          {"zipf-0.6", Workload::Kind::kZipf, 0.6},
+          {"zipf-0.9", Workload::Kind::kZipf, 0.9},
+          {"zipf-1.2", Workload::Kind::kZipf, 1.2},
+          {"scan", Workload::Kind::kScan, 0},
+          {"loop", Workload::Kind::kLoop, 0},
+          {"mixed", Workload::Kind::kMixed, 0.9}};
+}
+
+// Keys 0..keys-1 with probability proportional to 1 / (rank + 1)^skew,
+// scattered so hot keys are not also small integers.
+class ZipfGenerator {
+ public:
+  ZipfGenerator(int keys, double skew) : cdf_(keys) {
+    double total = 0;
+    for (int key = 0; key < keys; ++key) {
+      total += 1.0 / std::pow(key + 1, skew);
+      cdf_[key] = total;
+    }
+    for (auto& bound : cdf_) {
+      bound /= total;
+    }
+  }
+
+  int operator()(utils::random::Xoshiro256* random) const {
+    double u = static_cast<double>((*random)() >> 11) * (1.0 / (1ULL << 53));
+    size_t rank = static_cast<size_t>(
+        std::lower_bound(cdf_.begin(), cdf_.end(), u) - cdf_.begin());
+    rank = std::min(rank, cdf_.size() - 1);
+    return static_cast<int>(rank * 2654435761u % cdf_.size());
+  }
+
+ private:
+  std::vector<double> cdf_;
+};
+
+inline std::vector<int> Workload::Make(size_t length, int keys,
+                                       size_t capacity, uint64_t seed) const {
+  utils::random::Xoshiro256 random(seed);
+  std::vector<int> trace;
+  trace.reserve(length);
+  switch (kind) {
+    case Kind::kUniform:
+      while (trace.size() < length) {
+        trace.push_back(static_cast<int>(random.Below(keys)));
+      }
+      break;
+    case Kind::kZipf: {
+      ZipfGenerator zipf(keys, skew);
+      while (trace.size() < length) {
+        trace.push_back(zipf(&random));
+      }
+      break;
+    }
+    case Kind::kScan: {
+      // Never repeats, within or across threads: every access misses.
+      int next = keys + static_cast<int>(seed % 64) * static_cast<int>(length);
+      while (trace.size() < length) {
+        trace.push_back(next++);
+      }
+      break;
+    }
+    case Kind::kLoop: {
+      int loop = static_cast<int>(capacity + capacity / 4 + 1);
+      for (int key = 0; trace.size() < length; key = (key + 1) % loop) {
+        trace.push_back(key);
+      }
+      break;
+    }
+    case Kind::kMixed: {
+      // A scan of capacity / 2 fresh keys after every capacity accesses.
+      ZipfGenerator zipf(keys, skew);
+      int next = keys + static_cast<int>(seed % 64) * static_cast<int>(length);
+      while (trace.size() < length) {
+        for (size_t i = 0; i < capacity && trace.size() < length; ++i) {
+          trace.push_back(zipf(&random));
+        }
+        for (size_t i = 0; i < capacity / 2 && trace.size() < length; ++i) {
+          trace.push_back(next++);
+        }
+      }
+      break;
+    }
+  }
+  return trace;
+}
+
+}  // namespace benchmarks
@@ -21,35 +21,292 @@
 
 #pragma once
 
-#include <memory>
+#include <atomic>
 #include <tuple>
-#include <unordered_map>
+#include <utility>
 
+#include "src/side_effects/cache/cache_stats.h"
+#include "src/side_effects/cache/flat_table.h"
+#include "src/side_effects/cache/weigher.h"
 #include "src/utils/immutable/tuple.h"
 
 namespace side_effects {
 namespace cache {
 
-template <typename KeyType, typename ValueType>
-using Cache = std::unordered_map<KeyType, std::shared_ptr<ValueType>,
-                                 utils::immutable::TupleHash,
-                                 utils::immutable::TupleEqual>;
+template <typename KeyType, typename ValueType, typename Metadata = NoMetadata>
+using Cache = FlatTable<KeyType, ValueType, Metadata,
+                        utils::immutable::TupleHash,
+                        utils::immutable::TupleEqual>;
 
-template <typename KeyType, typename ValueType>
+// Told about every entry an Insertable removes, whatever the cause, just
+// before it goes. Runs under whatever lock guards the cache.
+class RemovalObserver {
+ public:
+  virtual void OnRemoval(uint64_t hash, RemovalCause cause) = 0;
+
+ protected:
+  ~RemovalObserver() = default;
+};
+
+// Static policy contract. A policy derives from Insertable<Policy, KeyType,
+// ValueType, Metadata>, where Metadata is what the policy keeps inline in each
+// cache slot, and provides the following hooks, which are resolved at compile
+// time so they can be inlined:
+//
+//   bool OnHit(CacheType* cache, SlotIndex slot)
+//     A lookup found slot. Returns false if the policy erased the entry
+//     (e.g. it expired), in which case the caller treats it as a miss.
+//   void OnInsert(CacheType* cache, SlotIndex slot)
+//     slot has just been added to cache.
+//   void OnErase(CacheType* cache, SlotIndex slot)
+//     slot is about to be erased by someone other than the policy.
+//   void Evict(CacheType* cache)
+//     Called before a new key is added; erases entries until there is room
+//     for one more.
+//
+// A policy bounded by weight rather than entry count also hides
+//
+//   size_t WeightOf(const KeyType& key, const ValueType& value) const
+//     Weight stored with a new entry (default 1). Evict then tests
+//     NoRoomFor(cache, limit), which accounts for the incoming entry's weight.
+//
+// A policy whose choice of victim depends on the key being added (ARC checks
+// its ghost lists) hides EvictFor(CacheType* cache, uint64_t hash) instead;
+// hash is the new key's CacheType::HashOf.
+//
+// A policy whose hits only set flags in atomic metadata (CLOCK, SIEVE) also
+// declares kConcurrentHits = true and provides
+//
+//   void OnSharedHit(const CacheType& cache, SlotIndex slot) const
+//     Like OnHit, but may run concurrently with other OnSharedHit calls and
+//     lookups, so hits can be served under a shared lock (see GetShared).
+//
+// Other policies have their hits applied later instead when read-mostly
+// callers serve them under a shared lock (see GetDeferred and ReplayHit).
+// A policy whose OnHit can turn a hit into a miss (TTL) cannot be used that
+// way and declares kDeferredHits = false.
+//
+// Policies remove entries through Discard and DiscardAll rather than
+// erasing from the cache directly, so Stats can attribute each removal to
+// its cause.
+//
+// Policies refer to entries by SlotIndex, so a policy is only meaningful
+// together with the cache it was used on. Copying a policy copies its
+// configuration; the copy starts with no entries.
+template <typename Policy, typename KeyType, typename ValueType,
+          typename Metadata = NoMetadata>
 class Insertable {
  public:
-  virtual void Insert(Cache<KeyType, ValueType>* cache, const KeyType& key,
-                      std::shared_ptr<ValueType> value) = 0;
-  virtual ~Insertable() = default;
+  using CacheType = Cache<KeyType, ValueType, Metadata>;
+
+  // Overwriting a key replaces the entry, so its bookkeeping (recency,
+  // frequency, deadline) starts over.
+  SlotIndex Insert(CacheType* cache, KeyType key, ValueType value) {
+    uint64_t hash = CacheType::HashOf(key);
+    return Insert(cache, std::move(key), std::move(value), hash);
+  }
+
+  // As above, with hash already computed by CacheType::HashOf(key).
+  SlotIndex Insert(CacheType* cache, KeyType key, ValueType value,
+                   uint64_t hash) {
+    Policy* policy = static_cast<Policy*>(this);
+    SlotIndex slot = cache->Find(key, hash);
+    if (slot != kNoSlot) {
+      policy->OnErase(cache, slot);
+      Discard(cache, slot, RemovalCause::kReplaced);
+    }
+    size_t weight = policy->WeightOf(key, value);
+    incoming_weight_ = weight;
+    policy->EvictFor(cache, hash);
+    incoming_weight_ = 1;
+    slot = cache->Emplace(std::move(key), std::move(value), hash, weight);
+    policy->OnInsert(cache, slot);
+    counters_.inserts.Add();
+    return slot;
+  }
+
+  static constexpr bool kConcurrentHits = false;
+  static constexpr bool kDeferredHits = true;
+
+  void EvictFor(CacheType* cache, uint64_t /*hash*/) {
+    static_cast<Policy*>(this)->Evict(cache);
+  }
+
+  size_t WeightOf(const KeyType& /*key*/, const ValueType& /*value*/) const {
+    return 1;
+  }
+
+  // Returns the cached value and records the hit, or nullptr on a miss.
+  // probe can be the key or anything FlatTable::Find accepts for it.
+  template <typename Probe>
+  ValueType* Get(CacheType* cache, const Probe& probe) {
+    return Get(cache, probe, CacheType::HashOf(probe));
+  }
+
+  // As above, with hash already computed by CacheType::HashOf(probe).
+  template <typename Probe>
+  ValueType* Get(CacheType* cache, const Probe& probe, uint64_t hash) {
+    SlotIndex slot = cache->Find(probe, hash);
+    if (slot == kNoSlot || !static_cast<Policy*>(this)->OnHit(cache, slot)) {
+      counters_.misses.Add();
+      return nullptr;
+    }
+    counters_.hits.Add();
+    return &cache->value(slot);
+  }
+
+  // Get for policies with kConcurrentHits. Neither the cache nor the policy
+  // is modified, so callers may run it from several threads at once. Only
+  // hits are counted: a caller that misses here falls back to Get.
+  template <typename Probe>
+  const ValueType* GetShared(const CacheType& cache, const Probe& probe,
+                             uint64_t hash) const {
+    SlotIndex slot = cache.Find(probe, hash);
+    if (slot == kNoSlot) {
+      return nullptr;
+    }
+    static_cast<const Policy*>(this)->OnSharedHit(cache, slot);
+    counters_.hits.Add();
+    return &cache.value(slot);
+  }
+
+  // Lookup for callers that defer the policy's side of a hit: counts it
+  // and returns its slot, or kNoSlot on a miss (not counted, as the caller
+  // falls back to Get). Like GetShared it modifies nothing, so several
+  // threads may run it at once; the slot and hash go to ReplayHit later.
+  template <typename Probe>
+  SlotIndex GetDeferred(const CacheType& cache, const Probe& probe,
+                        uint64_t hash) const {
+    SlotIndex slot = cache.Find(probe, hash);
+    if (slot != kNoSlot) {
+      counters_.hits.Add();
+    }
+    return slot;
+  }
+
+  // Applies a hit GetDeferred returned earlier. A hit on an entry that has
+  // since been erased is dropped (in rare cases it refreshes whichever
+  // entry took over slot, which only costs the policy some precision).
+  void ReplayHit(CacheType* cache, SlotIndex slot, uint64_t hash) {
+    if (cache->Holds(slot, hash)) {
+      static_cast<Policy*>(this)->OnHit(cache, slot);
+    }
+  }
+
+  bool Erase(CacheType* cache, const KeyType& key) {
+    SlotIndex slot = cache->Find(key);
+    if (slot == kNoSlot) {
+      return false;
+    }
+    static_cast<Policy*>(this)->OnErase(cache, slot);
+    Discard(cache, slot, RemovalCause::kExplicit);
+    return true;
+  }
+
+  // Counters since construction (or ResetStats), plus cache's current size
+  // and weight. Safe to call while other threads record hits under a shared
+  // lock; the totals are then approximate.
+  CacheStats Stats(const CacheType& cache) const {
+    CacheStats stats;
+    stats.hits = counters_.hits.Get();
+    stats.misses = counters_.misses.Get();
+    stats.inserts = counters_.inserts.Get();
+    for (size_t cause = 0; cause < kRemovalCauseCount; ++cause) {
+      stats.removals[cause] = counters_.removals[cause].Get();
+    }
+    stats.size = cache.size();
+    stats.weight = cache.weight();
+    return stats;
+  }
+
+  void ResetStats() { counters_.Reset(); }
+
+  // observer (or nullptr to stop) hears of every removal from now on. It is
+  // not copied along with the policy.
+  void SetRemovalObserver(RemovalObserver* observer) { observer_ = observer; }
+
+ protected:
+  Insertable() : incoming_weight_(1), observer_(nullptr) {}
+  // Counters are not copied, like the rest of a policy's bookkeeping.
+  Insertable(const Insertable& /*other*/) : Insertable() {}
+  Insertable& operator=(const Insertable& /*other*/) {
+    counters_.Reset();
+    return *this;
+  }
+  ~Insertable() = default;
+
+  // Erases slot from cache and counts it as removed for cause. The policy
+  // has already dropped its own bookkeeping for slot.
+  void Discard(CacheType* cache, SlotIndex slot, RemovalCause cause) {
+    counters_.removals[static_cast<size_t>(cause)].Add();
+    if (observer_ != nullptr) {
+      observer_->OnRemoval(cache->hash(slot), cause);
+    }
+    cache->Erase(slot);
+  }
+
+  // Empties cache, counting every entry as removed for cause.
+  void DiscardAll(CacheType* cache, RemovalCause cause) {
+    counters_.removals[static_cast<size_t>(cause)].Add(cache->size());
+    if (observer_ != nullptr) {
+      cache->ForEach([this, cache, cause](SlotIndex slot) {
+        observer_->OnRemoval(cache->hash(slot), cause);
+      });
+    }
+    cache->clear();
+  }
+
+  // Whether cache has to give up entries before the one being inserted fits
+  // within limit. With unit weights this is cache.size() >= limit.
+  bool NoRoomFor(const CacheType& cache, size_t limit) const {
+    return cache.weight() + incoming_weight_ > limit;
+  }
+
+ private:
+  size_t incoming_weight_;  // Weight of the entry Insert is making room for.
+  mutable CacheCounters counters_;
+  RemovalObserver* observer_;
 };
 
-template <typename KeyType, typename ValueType>
-class CacheWithNoPolicy : public Insertable<KeyType, ValueType> {
+// Reference bit for CLOCK-style policies. Setting it is a relaxed atomic
+// store, so concurrent hits need no exclusive lock; copies (made when the
+// cache is copied or grows) take a snapshot.
+class VisitedBit {
  public:
-  void Insert(Cache<KeyType, ValueType>* cache, const KeyType& key,
-              std::shared_ptr<ValueType> value) override {
-    (*cache)[key] = value;
+  VisitedBit() : visited_(false) {}
+  VisitedBit(const VisitedBit& other) : visited_(other.Get()) {}
+  VisitedBit& operator=(const VisitedBit& other) {
+    visited_.store(other.Get(), std::memory_order_relaxed);
+    return *this;
+  }
+
+  bool Get() const { return visited_.load(std::memory_order_relaxed); }
+
+  // Skips the store when the bit is already set, so hot entries do not
+  // bounce their cache line between readers.
+  void Set() const {
+    if (!Get()) {
+      visited_.store(true, std::memory_order_relaxed);
+    }
   }
+
+  void Clear() { visited_.store(false, std::memory_order_relaxed); }
+
+ private:
+  mutable std::atomic<bool> visited_;
+};
+
+template <typename KeyType, typename ValueType>
+class CacheWithNoPolicy
+    : public Insertable<CacheWithNoPolicy<KeyType, ValueType>, KeyType,
+                        ValueType> {
+ public:
+  using CacheType = Cache<KeyType, ValueType>;
+
+  bool OnHit(CacheType* /*cache*/, SlotIndex /*slot*/) { return true; }
+  void OnInsert(CacheType* /*cache*/, SlotIndex /*slot*/) {}
+  void OnErase(CacheType* /*cache*/, SlotIndex /*slot*/) {}
+  void Evict(CacheType* /*cache*/) {}
 };
 
 }  // namespace cache
@@ -0,0 +1,179 @@
+/*
+ * Copyright (C) 2024  OverbearingPearl
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ * The above copyright notice and this permission notice shall be included in
+ * all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+ * THE SOFTWARE.
+ */
+
+#pragma once
+
+#include <algorithm>
+#include <cstdint>
+
+#include "src/side_effects/cache/cache.h"
+#include "src/side_effects/cache/pool_allocator.h"
+#include "src/side_effects/cache/ghost_list.h"
+
+namespace side_effects {
+namespace cache {
+
+struct ArcMetadata {
+  bool frequent;  // In the list of keys hit since they were added.
+  SlotList::iterator position;
+};
+
+// Adaptive Replacement Cache (Megiddo and Modha). Resident keys are split
+// between a recency list (seen once) and a frequency list (hit again), each
+// backed by a ghost list of keys it evicted recently. A miss on a ghost
+// shifts the target size of the recency list towards the list that would
+// have kept the key, so the split follows the workload: a sweep of new keys
+// only cycles through the recency list while the frequency list keeps the
+// hot set.
+//
+// Ghosts hold hashes, not keys, and together never exceed capacity.
+template <typename KeyType, typename ValueType>
+class CacheWithArcPolicy
+    : public Insertable<CacheWithArcPolicy<KeyType, ValueType>, KeyType,
+                        ValueType, ArcMetadata> {
+ public:
+  using CacheType = Cache<KeyType, ValueType, ArcMetadata>;
+
+  explicit CacheWithArcPolicy(size_t capacity)
+      : capacity_(capacity),
+        recent_target_(0),
+        admit_frequent_(false),
+        recent_(PoolAllocator<SlotIndex>(capacity)),
+        frequent_(recent_.get_allocator()),
+        recent_ghosts_(capacity),
+        frequent_ghosts_(capacity) {}
+
+  CacheWithArcPolicy(const CacheWithArcPolicy& other)
+      : CacheWithArcPolicy(other.capacity_) {}
+
+  CacheWithArcPolicy& operator=(const CacheWithArcPolicy& other) {
+    capacity_ = other.capacity_;
+    recent_target_ = 0;
+    admit_frequent_ = false;
+    recent_.clear();
+    frequent_.clear();
+    recent_ghosts_.clear();
+    frequent_ghosts_.clear();
+    return *this;
+  }
+
+  bool OnHit(CacheType* cache, SlotIndex slot) {
+    ArcMetadata& metadata = cache->metadata(slot);
+    frequent_.splice(frequent_.begin(), metadata.frequent ? frequent_ : recent_,
+                     metadata.position);
+    metadata.frequent = true;
+    return true;
+  }
+
+  // Placed by the preceding EvictFor: in the frequency list if it was a
+  // ghost, otherwise in the recency list.
+  void OnInsert(CacheType* cache, SlotIndex slot) {
+    SlotList& list = admit_frequent_ ? frequent_ : recent_;
+    list.push_front(slot);
+    cache->metadata(slot) = ArcMetadata{admit_frequent_, list.begin()};
+    admit_frequent_ = false;
+  }
+
+  void OnErase(CacheType* cache, SlotIndex slot) {
+    const ArcMetadata& metadata = cache->metadata(slot);
+    (metadata.frequent ? frequent_ : recent_).erase(metadata.position);
+  }
+
+  void EvictFor(CacheType* cache, uint64_t hash) {
+    if (recent_ghosts_.Erase(hash)) {
+      size_t step = std::max<size_t>(
+          frequent_ghosts_.size() / (recent_ghosts_.size() + 1), 1);
+      recent_target_ = std::min(capacity_, recent_target_ + step);
+      MakeRoom(cache, false);
+      admit_frequent_ = true;
+    } else if (frequent_ghosts_.Erase(hash)) {
+      size_t step = std::max<size_t>(
+          recent_ghosts_.size() / (frequent_ghosts_.size() + 1), 1);
+      recent_target_ = recent_target_ > step ? recent_target_ - step : 0;
+      MakeRoom(cache, true);
+      admit_frequent_ = true;
+    } else {
+      if (recent_.size() + recent_ghosts_.size() >= capacity_ &&
+          recent_ghosts_.empty() && !recent_.empty()) {
+        // The recency side is all resident: drop its oldest key outright.
+        EvictBack(cache, &recent_, nullptr);
+      } else if (recent_.size() + recent_ghosts_.size() >= capacity_) {
+        recent_ghosts_.PopBack();
+      } else if (!frequent_ghosts_.empty() &&
+                 recent_.size() + frequent_.size() + recent_ghosts_.size() +
+                         frequent_ghosts_.size() >=
+                     2 * capacity_) {
+        frequent_ghosts_.PopBack();
+      }
+      MakeRoom(cache, false);
+      admit_frequent_ = false;
+    }
+    TrimGhosts();
+  }
+
+  // Current target size of the recency list.
+  size_t RecentTarget() const { return recent_target_; }
+
+ private:
+  void MakeRoom(CacheType* cache, bool frequent_ghost_hit) {
+    while (cache->size() >= capacity_ && !cache->empty()) {
+      if (!recent_.empty() &&
+          (recent_.size() > recent_target_ || frequent_.empty() ||
+           (frequent_ghost_hit && recent_.size() == recent_target_))) {
+        EvictBack(cache, &recent_, &recent_ghosts_);
+      } else {
+        EvictBack(cache, &frequent_, &frequent_ghosts_);
+      }
+    }
+  }
+
+  void EvictBack(CacheType* cache, SlotList* list, GhostList* ghosts) {
+    SlotIndex slot = list->back();
+    list->pop_back();
+    if (ghosts != nullptr) {
+      ghosts->Push(cache->hash(slot));
+    }
+    this->Discard(cache, slot, RemovalCause::kCapacity);
+  }
+
+  // Keeps the invariants of the paper under external erases: the recency
+  // side (resident and ghost) and all ghosts each fit in capacity.
+  void TrimGhosts() {
+    while (!recent_ghosts_.empty() &&
+           recent_.size() + recent_ghosts_.size() > capacity_) {
+      recent_ghosts_.PopBack();
+    }
+    while (recent_ghosts_.size() + frequent_ghosts_.size() > capacity_) {
+      (frequent_ghosts_.empty() ? recent_ghosts_ : frequent_ghosts_).PopBack();
+    }
+  }
+
+  size_t capacity_;
+  size_t recent_target_;
+  bool admit_frequent_;
+  SlotList recent_;    // Most recently used first.
+  SlotList frequent_;  // Most recently used first.
+  GhostList recent_ghosts_;
+  GhostList frequent_ghosts_;
+};
+
+}  // namespace cache
+}  // namespace side_effects
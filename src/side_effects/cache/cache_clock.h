@@ -0,0 +1,129 @@
+/*
+ * Copyright (C) 2024  OverbearingPearl
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ * The above copyright notice and this permission notice shall be included in
+ * all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+ * THE SOFTWARE.
+ */
+
+#pragma once
+
+#include <vector>
+
+#include "src/side_effects/cache/cache.h"
+
+namespace side_effects {
+namespace cache {
+
+struct ClockMetadata {
+  VisitedBit visited;
+  SlotIndex position;  // Index in the clock ring.
+};
+
+// Entries sit on a ring swept by a hand. A hit only sets the entry's visited
+// bit; eviction clears set bits as the hand passes and takes the first entry
+// whose bit is already clear, which approximates LRU.
+template <typename KeyType, typename ValueType>
+class CacheWithClockPolicy
+    : public Insertable<CacheWithClockPolicy<KeyType, ValueType>, KeyType,
+                        ValueType, ClockMetadata> {
+ public:
+  using CacheType = Cache<KeyType, ValueType, ClockMetadata>;
+
+  static constexpr bool kConcurrentHits = true;
+
+  explicit CacheWithClockPolicy(size_t capacity)
+      : capacity_(capacity), hand_(0) {}
+
+  CacheWithClockPolicy(const CacheWithClockPolicy& other)
+      : Insertable<CacheWithClockPolicy, KeyType, ValueType,
+                   ClockMetadata>(other),
+        capacity_(other.capacity_), hand_(0) {}
+
+  CacheWithClockPolicy& operator=(const CacheWithClockPolicy& other) {
+    capacity_ = other.capacity_;
+    ring_.clear();
+    free_positions_.clear();
+    hand_ = 0;
+    return *this;
+  }
+
+  bool OnHit(CacheType* cache, SlotIndex slot) {
+    OnSharedHit(*cache, slot);
+    return true;
+  }
+
+  void OnSharedHit(const CacheType& cache, SlotIndex slot) const {
+    cache.metadata(slot).visited.Set();
+  }
+
+  void OnInsert(CacheType* cache, SlotIndex slot) {
+    SlotIndex position;
+    if (!free_positions_.empty()) {
+      position = free_positions_.back();
+      free_positions_.pop_back();
+      ring_[position] = slot;
+    } else {
+      position = static_cast<SlotIndex>(ring_.size());
+      ring_.push_back(slot);
+    }
+    cache->metadata(slot).position = position;
+  }
+
+  void OnErase(CacheType* cache, SlotIndex slot) {
+    Release(cache->metadata(slot).position);
+  }
+
+  void Evict(CacheType* cache) {
+    while (cache->size() >= capacity_ && !cache->empty()) {
+      if (hand_ >= ring_.size()) {
+        hand_ = 0;
+      }
+      SlotIndex slot = ring_[hand_];
+      if (slot == kNoSlot) {
+        ++hand_;
+        continue;
+      }
+      ClockMetadata& metadata = cache->metadata(slot);
+      if (metadata.visited.Get()) {
+        metadata.visited.Clear();
+        ++hand_;
+        continue;
+      }
+      // The freed position is the last one the hand reaches again, so the
+      // entry that refills it gets a full sweep before being considered.
+      Release(static_cast<SlotIndex>(hand_++));
+      this->Discard(cache, slot, RemovalCause::kCapacity);
+    }
+  }
+
+ private:
+  void Release(SlotIndex position) {
+    ring_[position] = kNoSlot;
+    free_positions_.push_back(position);
+  }
+
+  size_t capacity_;
+  std::vector<SlotIndex> ring_;  // kNoSlot marks a free position.
+  std::vector<SlotIndex> free_positions_;
+  size_t hand_;
+};
+
+template <typename KeyType, typename ValueType>
+constexpr bool CacheWithClockPolicy<KeyType, ValueType>::kConcurrentHits;
+
+}  // namespace cache
+}  // namespace side_effects
@@ -21,38 +21,75 @@
 
 #pragma once
 
-#include <memory>
-#include <queue>
-#include <unordered_map>
+#include <iterator>
+#include <utility>
 
 #include "src/side_effects/cache/cache.h"
+#include "src/side_effects/cache/pool_allocator.h"
 
 namespace side_effects {
 namespace cache {
 
+struct FifoMetadata {
+  SlotList::iterator position;
+};
+
 template <typename KeyType, typename ValueType>
-class CacheWithFifoPolicy : public Insertable<KeyType, ValueType> {
+class CacheWithFifoPolicy
+    : public Insertable<CacheWithFifoPolicy<KeyType, ValueType>, KeyType,
+                        ValueType, FifoMetadata> {
  public:
-  explicit CacheWithFifoPolicy(size_t capacity) : capacity_(capacity) {}
+  using CacheType = Cache<KeyType, ValueType, FifoMetadata>;
 
-  void Insert(Cache<KeyType, ValueType>* cache, const KeyType& key,
-              std::shared_ptr<ValueType> value) override {
-    if (cache->size() >= capacity_) {
-      Evict(cache);
-    }
-    (*cache)[key] = value;
-    order_.push(key);
+  explicit CacheWithFifoPolicy(size_t capacity)
+      : capacity_(capacity), order_(PoolAllocator<SlotIndex>(capacity)) {}
+
+  // Bounds the total weight of the entries instead of their count.
+  explicit CacheWithFifoPolicy(
+      WeightBudget budget,
+      Weigher<KeyType, ValueType> weigher = SizeofWeigher<KeyType, ValueType>())
+      : capacity_(budget.limit), weigher_(std::move(weigher)) {}
+
+  CacheWithFifoPolicy(const CacheWithFifoPolicy& other)
+      : Insertable<CacheWithFifoPolicy, KeyType, ValueType,
+                   FifoMetadata>(other),
+        capacity_(other.capacity_),
+        weigher_(other.weigher_),
+        order_(SeparatePool(other.order_)) {}
+
+  CacheWithFifoPolicy& operator=(const CacheWithFifoPolicy& other) {
+    capacity_ = other.capacity_;
+    weigher_ = other.weigher_;
+    order_.clear();
+    return *this;
   }
 
- private:
-  void Evict(Cache<KeyType, ValueType>* cache) {
-    KeyType key_to_evict = order_.front();
-    cache->erase(key_to_evict);
-    order_.pop();
+  size_t WeightOf(const KeyType& key, const ValueType& value) const {
+    return weigher_(key, value);
+  }
+
+  bool OnHit(CacheType* /*cache*/, SlotIndex /*slot*/) { return true; }
+
+  void OnInsert(CacheType* cache, SlotIndex slot) {
+    order_.push_back(slot);
+    cache->metadata(slot).position = std::prev(order_.end());
+  }
+
+  void OnErase(CacheType* cache, SlotIndex slot) {
+    order_.erase(cache->metadata(slot).position);
   }
 
+  void Evict(CacheType* cache) {
+    while (this->NoRoomFor(*cache, capacity_) && !order_.empty()) {
+      this->Discard(cache, order_.front(), RemovalCause::kCapacity);
+      order_.pop_front();
+    }
+  }
+
+ private:
   size_t capacity_;
-  std::queue<KeyType> order_;
+  EntryWeigher<KeyType, ValueType> weigher_;
+  SlotList order_;  // Oldest first.
 };
 
 }  // namespace cache
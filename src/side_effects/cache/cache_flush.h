@@ -21,8 +21,7 @@
 
 #pragma once
 
-#include <memory>
-#include <unordered_map>
+#include <utility>
 
 #include "src/side_effects/cache/cache.h"
 
@@ -30,20 +29,39 @@ namespace side_effects {
 namespace cache {
 
 template <typename KeyType, typename ValueType>
-class CacheWithFlushPolicy : public Insertable<KeyType, ValueType> {
+class CacheWithFlushPolicy
+    : public Insertable<CacheWithFlushPolicy<KeyType, ValueType>, KeyType,
+                        ValueType> {
  public:
+  using CacheType = Cache<KeyType, ValueType>;
+
   explicit CacheWithFlushPolicy(size_t capacity) : capacity_(capacity) {}
 
-  void Insert(Cache<KeyType, ValueType>* cache, const KeyType& key,
-              std::shared_ptr<ValueType> value) override {
-    if (cache->size() >= capacity_) {
-      cache->clear();
+  // Bounds the total weight of the entries instead of their count.
+  explicit CacheWithFlushPolicy(
+      WeightBudget budget,
+      Weigher<KeyType, ValueType> weigher = SizeofWeigher<KeyType, ValueType>())
+      : capacity_(budget.limit), weigher_(std::move(weigher)) {}
+
+  size_t WeightOf(const KeyType& key, const ValueType& value) const {
+    return weigher_(key, value);
+  }
+
+  bool OnHit(CacheType* /*cache*/, SlotIndex /*slot*/) { return true; }
+
+  void OnInsert(CacheType* /*cache*/, SlotIndex /*slot*/) {}
+
+  void OnErase(CacheType* /*cache*/, SlotIndex /*slot*/) {}
+
+  void Evict(CacheType* cache) {
+    if (this->NoRoomFor(*cache, capacity_)) {
+      this->DiscardAll(cache, RemovalCause::kCapacity);
     }
-    (*cache)[key] = value;
   }
 
  private:
   size_t capacity_;
+  EntryWeigher<KeyType, ValueType> weigher_;
 };
 
 }  // namespace cache
@@ -21,76 +21,186 @@
 
 #pragma once
 
-#include <algorithm>
+#include <iterator>
 #include <list>
-#include <memory>
-#include <sstream>
-#include <unordered_map>
 #include <utility>
 
 #include "src/side_effects/cache/cache.h"
+#include "src/side_effects/cache/pool_allocator.h"
 #include "src/side_effects/io/logging.h"
 
 namespace side_effects {
 namespace cache {
 
+struct LfuBucket {
+  size_t frequency;
+  SlotList slots;  // Most recently used first.
+};
+
+using LfuBucketList = std::list<LfuBucket, PoolAllocator<LfuBucket>>;
+
+struct LfuMetadata {
+  LfuBucketList::iterator bucket;
+  SlotList::iterator position;
+};
+
+// Constant-time LFU. Slots live in frequency buckets kept in ascending order,
+// so the front bucket is always the minimum frequency. Inside a bucket slots
+// are ordered by recency, which breaks ties in favour of evicting the least
+// recently used key.
+//
+// With a non-zero decay_period every frequency is halved after that many
+// hits and insertions, letting keys that were hot long ago fall out of the
+// cache. Decay is O(n), so keep decay_period >= capacity for amortized O(1).
 template <typename KeyType, typename ValueType>
-class CacheWithLfuPolicy : public Insertable<KeyType, ValueType> {
+class CacheWithLfuPolicy
+    : public Insertable<CacheWithLfuPolicy<KeyType, ValueType>, KeyType,
+                        ValueType, LfuMetadata> {
  public:
-  explicit CacheWithLfuPolicy(size_t capacity) : capacity_(capacity) {
-    LOG("CacheWithLfuPolicy capacity: ", capacity_);
+  using CacheType = Cache<KeyType, ValueType, LfuMetadata>;
+
+  explicit CacheWithLfuPolicy(size_t capacity, size_t decay_period = 0)
+      : capacity_(capacity),
+        decay_period_(decay_period),
+        operations_(0),
+        slot_allocator_(capacity),
+        buckets_(PoolAllocator<LfuBucket>(capacity)) {
+    LOG_DEBUG("CacheWithLfuPolicy capacity: ", capacity_);
+  }
+
+  // Bounds the total weight of the entries instead of their count.
+  explicit CacheWithLfuPolicy(
+      WeightBudget budget,
+      Weigher<KeyType, ValueType> weigher = SizeofWeigher<KeyType, ValueType>(),
+      size_t decay_period = 0)
+      : capacity_(budget.limit),
+        decay_period_(decay_period),
+        operations_(0),
+        weigher_(std::move(weigher)) {
+    LOG_DEBUG("CacheWithLfuPolicy weight budget: ", capacity_);
+  }
+
+  CacheWithLfuPolicy(const CacheWithLfuPolicy& other)
+      : Insertable<CacheWithLfuPolicy, KeyType, ValueType, LfuMetadata>(other),
+        capacity_(other.capacity_),
+        decay_period_(other.decay_period_),
+        operations_(0),
+        weigher_(other.weigher_),
+        slot_allocator_(
+            other.slot_allocator_.select_on_container_copy_construction()),
+        buckets_(SeparatePool(other.buckets_)) {}
+
+  CacheWithLfuPolicy& operator=(const CacheWithLfuPolicy& other) {
+    capacity_ = other.capacity_;
+    decay_period_ = other.decay_period_;
+    weigher_ = other.weigher_;
+    operations_ = 0;
+    buckets_.clear();
+    return *this;
+  }
+
+  size_t WeightOf(const KeyType& key, const ValueType& value) const {
+    return weigher_(key, value);
+  }
+
+  bool OnHit(CacheType* cache, SlotIndex slot) {
+    Touch(&cache->metadata(slot));
+    CountOperation(cache);
+    return true;
+  }
+
+  void OnInsert(CacheType* cache, SlotIndex slot) {
+    if (buckets_.empty() || buckets_.front().frequency != 1) {
+      buckets_.push_front(LfuBucket{1, SlotList(slot_allocator_)});
+    }
+    buckets_.front().slots.push_front(slot);
+    cache->metadata(slot) =
+        LfuMetadata{buckets_.begin(), buckets_.front().slots.begin()};
+    CountOperation(cache);
+  }
+
+  void OnErase(CacheType* cache, SlotIndex slot) {
+    Remove(cache->metadata(slot));
   }
 
-  void Insert(Cache<KeyType, ValueType>* cache, const KeyType& key,
-              std::shared_ptr<ValueType> value) override {
-    for (const auto& pair : frequency_list_) {
-      LOG("Before Insert()", " capacity: ", capacity_,
-          ", size: ", cache->size(), ", Key: ", std::get<0>(pair.first),
-          ", Frequency: ", pair.second);
+  void Evict(CacheType* cache) {
+    while (this->NoRoomFor(*cache, capacity_) && !buckets_.empty()) {
+      SlotIndex slot_to_evict = buckets_.front().slots.back();
+      Remove(cache->metadata(slot_to_evict));
+      this->Discard(cache, slot_to_evict, RemovalCause::kCapacity);
     }
-    if (cache->size() >= capacity_) {
-      Evict(cache);
+  }
+
+  size_t Frequency(const CacheType& cache, const KeyType& key) const {
+    SlotIndex slot = cache.Find(key);
+    return slot == kNoSlot ? 0 : cache.metadata(slot).bucket->frequency;
+  }
+
+  // One per distinct frequency among the cached keys, however many keys
+  // share it; a hit or eviction only touches the front bucket or the ones
+  // on either side of the key's.
+  size_t BucketCount() const { return buckets_.size(); }
+
+ private:
+  using BucketIterator = LfuBucketList::iterator;
+
+  void Touch(LfuMetadata* metadata) {
+    BucketIterator current = metadata->bucket;
+    BucketIterator next = std::next(current);
+    if (next == buckets_.end() || next->frequency != current->frequency + 1) {
+      next = buckets_.insert(
+          next, LfuBucket{current->frequency + 1, SlotList(slot_allocator_)});
     }
-    if (frequency_list_.find(key) != frequency_list_.end()) {
-      Touch(key);
-    } else {
-      (*cache)[key] = value;
-      frequency_list_[key] = 1;
-      frequency_order_.push_back(key);
+    next->slots.splice(next->slots.begin(), current->slots,
+                       metadata->position);
+    metadata->bucket = next;
+    if (current->slots.empty()) {
+      buckets_.erase(current);
     }
-    for (const auto& pair : frequency_list_) {
-      LOG("After Insert()", " capacity: ", capacity_, ", size: ", cache->size(),
-          ", Key: ", std::get<0>(pair.first), ", Frequency: ", pair.second);
+  }
+
+  void Remove(const LfuMetadata& metadata) {
+    BucketIterator bucket = metadata.bucket;
+    bucket->slots.erase(metadata.position);
+    if (bucket->slots.empty()) {
+      buckets_.erase(bucket);
     }
   }
 
- private:
-  void Touch(const KeyType& key) {
-    frequency_list_[key]++;
-    frequency_order_.remove(key);
-    frequency_order_.push_back(key);
-    LOG("Touch()", " Key: ", std::get<0>(key));
+  void CountOperation(CacheType* cache) {
+    if (decay_period_ != 0 && ++operations_ >= decay_period_) {
+      Decay(cache);
+      operations_ = 0;
+    }
   }
 
-  void Evict(Cache<KeyType, ValueType>* cache) {
-    auto min_freq_it =
-        std::min_element(frequency_list_.begin(), frequency_list_.end(),
-                         [](const std::pair<KeyType, size_t>& a,
-                            const std::pair<KeyType, size_t>& b) {
-                           return a.second < b.second;
-                         });
-    KeyType key_to_evict = min_freq_it->first;
-    cache->erase(key_to_evict);
-    frequency_list_.erase(key_to_evict);
-    frequency_order_.remove(key_to_evict);
-    LOG("Evict()", " Key: ", std::get<0>(key_to_evict));
+  // Halves every frequency (rounding up so nothing drops to zero) and merges
+  // buckets that collapse onto the same value. Slots of the higher bucket are
+  // treated as more recent than those of the lower one.
+  void Decay(CacheType* cache) {
+    for (auto bucket = buckets_.begin(); bucket != buckets_.end();) {
+      bucket->frequency = (bucket->frequency + 1) / 2;
+      if (bucket != buckets_.begin()) {
+        BucketIterator previous = std::prev(bucket);
+        if (previous->frequency == bucket->frequency) {
+          for (SlotIndex slot : previous->slots) {
+            cache->metadata(slot).bucket = bucket;
+          }
+          bucket->slots.splice(bucket->slots.end(), previous->slots);
+          buckets_.erase(previous);
+        }
+      }
+      ++bucket;
+    }
   }
 
   size_t capacity_;
-  std::unordered_map<KeyType, size_t, utils::immutable::TupleHash,
-                     utils::immutable::TupleEqual>
-      frequency_list_;
-  std::list<KeyType> frequency_order_;
+  size_t decay_period_;
+  size_t operations_;
+  EntryWeigher<KeyType, ValueType> weigher_;
+  // Shared by every bucket's slots, so slots can be spliced between them.
+  PoolAllocator<SlotIndex> slot_allocator_;
+  LfuBucketList buckets_;  // Ascending frequency; front is minimum.
 };
 
 }  // namespace cache
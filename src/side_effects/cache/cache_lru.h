@@ -21,45 +21,76 @@
 
 #pragma once
 
-#include <list>
-#include <memory>
-#include <unordered_map>
+#include <utility>
 
 #include "src/side_effects/cache/cache.h"
+#include "src/side_effects/cache/slot_list.h"
 
 namespace side_effects {
 namespace cache {
 
+struct LruMetadata {
+  SlotLinks links;
+};
+
+// Recency is an IntrusiveSlotList through the entries' metadata, so the
+// policy adds 8 bytes per entry and no allocation, and a hit relinks the
+// entry in place.
 template <typename KeyType, typename ValueType>
-class CacheWithLruPolicy : public Insertable<KeyType, ValueType> {
+class CacheWithLruPolicy
+    : public Insertable<CacheWithLruPolicy<KeyType, ValueType>, KeyType,
+                        ValueType, LruMetadata> {
  public:
+  using CacheType = Cache<KeyType, ValueType, LruMetadata>;
+
   explicit CacheWithLruPolicy(size_t capacity) : capacity_(capacity) {}
 
-  void Insert(Cache<KeyType, ValueType>* cache, const KeyType& key,
-              std::shared_ptr<ValueType> value) override {
-    if (cache->size() >= capacity_) {
-      Evict(cache);
-    }
-    if (key_iterator_map_.find(key) != key_iterator_map_.end()) {
-      access_order_.erase(key_iterator_map_[key]);
-    }
-    (*cache)[key] = value;
-    access_order_.push_front(key);
-    key_iterator_map_[key] = access_order_.begin();
+  // Bounds the total weight of the entries instead of their count.
+  explicit CacheWithLruPolicy(
+      WeightBudget budget,
+      Weigher<KeyType, ValueType> weigher = SizeofWeigher<KeyType, ValueType>())
+      : capacity_(budget.limit), weigher_(std::move(weigher)) {}
+
+  CacheWithLruPolicy(const CacheWithLruPolicy& other)
+      : Insertable<CacheWithLruPolicy, KeyType, ValueType, LruMetadata>(other),
+        capacity_(other.capacity_), weigher_(other.weigher_) {}
+
+  CacheWithLruPolicy& operator=(const CacheWithLruPolicy& other) {
+    capacity_ = other.capacity_;
+    weigher_ = other.weigher_;
+    access_order_.clear();
+    return *this;
   }
 
- private:
-  void Evict(Cache<KeyType, ValueType>* cache) {
-    KeyType key_to_evict = access_order_.back();
-    cache->erase(key_to_evict);
-    key_iterator_map_.erase(key_to_evict);
-    access_order_.pop_back();
+  size_t WeightOf(const KeyType& key, const ValueType& value) const {
+    return weigher_(key, value);
+  }
+
+  bool OnHit(CacheType* cache, SlotIndex slot) {
+    access_order_.MoveToFront(cache, slot);
+    return true;
+  }
+
+  void OnInsert(CacheType* cache, SlotIndex slot) {
+    access_order_.PushFront(cache, slot);
+  }
+
+  void OnErase(CacheType* cache, SlotIndex slot) {
+    access_order_.Remove(cache, slot);
   }
 
+  void Evict(CacheType* cache) {
+    while (this->NoRoomFor(*cache, capacity_) && !access_order_.empty()) {
+      SlotIndex slot = access_order_.back();
+      access_order_.Remove(cache, slot);
+      this->Discard(cache, slot, RemovalCause::kCapacity);
+    }
+  }
+
+ private:
   size_t capacity_;
-  std::list<KeyType> access_order_;
-  std::unordered_map<KeyType, typename std::list<KeyType>::iterator>
-      key_iterator_map_;
+  EntryWeigher<KeyType, ValueType> weigher_;
+  IntrusiveSlotList<CacheType> access_order_;  // Most recently used first.
 };
 
 }  // namespace cache
@@ -21,40 +21,193 @@
 
 #pragma once
 
-#include <cstdlib>
-#include <memory>
-#include <unordered_map>
+#include <cstdint>
+#include <utility>
 #include <vector>
 
 #include "src/side_effects/cache/cache.h"
+#include "src/utils/random/xoshiro.h"
 
 namespace side_effects {
 namespace cache {
 
+struct RrMetadata {
+  SlotIndex position;  // Index in DenseSlots.
+};
+
+// The live slots of a cache in a dense array, so picking a uniformly random
+// one is O(1). Removal swaps the last slot into the gap and updates its
+// metadata's position. Metadata must have a SlotIndex position member.
+class DenseSlots {
+ public:
+  template <typename CacheType>
+  void Add(CacheType* cache, SlotIndex slot) {
+    cache->metadata(slot).position = static_cast<SlotIndex>(slots_.size());
+    slots_.push_back(slot);
+  }
+
+  template <typename CacheType>
+  void Remove(CacheType* cache, SlotIndex slot) {
+    SlotIndex position = cache->metadata(slot).position;
+    SlotIndex last = slots_.back();
+    slots_[position] = last;
+    cache->metadata(last).position = position;
+    slots_.pop_back();
+  }
+
+  SlotIndex operator[](size_t position) const { return slots_[position]; }
+  size_t size() const { return slots_.size(); }
+  bool empty() const { return slots_.empty(); }
+  void clear() { slots_.clear(); }
+
+ private:
+  std::vector<SlotIndex> slots_;
+};
+
+constexpr uint64_t kDefaultRrSeed = 0x2545F4914F6CDD1DULL;
+
+// Evicts a uniformly random entry in O(1), using a generator owned by the
+// policy (copies restart from the same seed).
 template <typename KeyType, typename ValueType>
-class CacheWithRrPolicy : public Insertable<KeyType, ValueType> {
+class CacheWithRrPolicy
+    : public Insertable<CacheWithRrPolicy<KeyType, ValueType>, KeyType,
+                        ValueType, RrMetadata> {
  public:
-  explicit CacheWithRrPolicy(size_t capacity) : capacity_(capacity) {}
+  using CacheType = Cache<KeyType, ValueType, RrMetadata>;
+
+  explicit CacheWithRrPolicy(size_t capacity, uint64_t seed = kDefaultRrSeed)
+      : capacity_(capacity), seed_(seed), random_(seed) {}
+
+  // Bounds the total weight of the entries instead of their count.
+  explicit CacheWithRrPolicy(
+      WeightBudget budget,
+      Weigher<KeyType, ValueType> weigher = SizeofWeigher<KeyType, ValueType>(),
+      uint64_t seed = kDefaultRrSeed)
+      : capacity_(budget.limit),
+        weigher_(std::move(weigher)),
+        seed_(seed),
+        random_(seed) {}
+
+  CacheWithRrPolicy(const CacheWithRrPolicy& other)
+      : Insertable<CacheWithRrPolicy, KeyType, ValueType, RrMetadata>(other),
+        capacity_(other.capacity_),
+        weigher_(other.weigher_),
+        seed_(other.seed_),
+        random_(other.seed_) {}
+
+  CacheWithRrPolicy& operator=(const CacheWithRrPolicy& other) {
+    capacity_ = other.capacity_;
+    weigher_ = other.weigher_;
+    seed_ = other.seed_;
+    random_ = utils::random::Xoshiro256(seed_);
+    slots_.clear();
+    return *this;
+  }
 
-  void Insert(Cache<KeyType, ValueType>* cache, const KeyType& key,
-              std::shared_ptr<ValueType> value) override {
-    if (cache->size() >= capacity_) {
-      Evict(cache);
+  size_t WeightOf(const KeyType& key, const ValueType& value) const {
+    return weigher_(key, value);
+  }
+
+  bool OnHit(CacheType* /*cache*/, SlotIndex /*slot*/) { return true; }
+
+  void OnInsert(CacheType* cache, SlotIndex slot) { slots_.Add(cache, slot); }
+
+  void OnErase(CacheType* cache, SlotIndex slot) {
+    slots_.Remove(cache, slot);
+  }
+
+  void Evict(CacheType* cache) {
+    while (this->NoRoomFor(*cache, capacity_) && !slots_.empty()) {
+      SlotIndex slot =
+          slots_[random_.Below(static_cast<uint32_t>(slots_.size()))];
+      slots_.Remove(cache, slot);
+      this->Discard(cache, slot, RemovalCause::kCapacity);
     }
-    (*cache)[key] = value;
-    keys_.push_back(key);
   }
 
  private:
-  void Evict(Cache<KeyType, ValueType>* cache) {
-    size_t index = std::rand() % keys_.size();
-    KeyType key_to_evict = keys_[index];
-    cache->erase(key_to_evict);
-    keys_.erase(keys_.begin() + index);
+  size_t capacity_;
+  EntryWeigher<KeyType, ValueType> weigher_;
+  uint64_t seed_;
+  utils::random::Xoshiro256 random_;
+  DenseSlots slots_;
+};
+
+struct SampledLruMetadata {
+  SlotIndex position;    // Index in DenseSlots.
+  uint64_t last_access;  // Value of the policy's access counter.
+};
+
+// Approximated LRU in the manner of Redis: each eviction samples a few
+// random entries and evicts the least recently used of them. A hit only
+// stamps the entry with a counter, so it costs about as little as RR while
+// the hit ratio stays close to exact LRU (closer with more samples).
+template <typename KeyType, typename ValueType>
+class CacheWithSampledLruPolicy
+    : public Insertable<CacheWithSampledLruPolicy<KeyType, ValueType>, KeyType,
+                        ValueType, SampledLruMetadata> {
+ public:
+  using CacheType = Cache<KeyType, ValueType, SampledLruMetadata>;
+
+  explicit CacheWithSampledLruPolicy(size_t capacity, size_t samples = 5,
+                                     uint64_t seed = kDefaultRrSeed)
+      : capacity_(capacity),
+        samples_(samples == 0 ? 1 : samples),
+        seed_(seed),
+        random_(seed),
+        clock_(0) {}
+
+  CacheWithSampledLruPolicy(const CacheWithSampledLruPolicy& other)
+      : CacheWithSampledLruPolicy(other.capacity_, other.samples_,
+                                  other.seed_) {}
+
+  CacheWithSampledLruPolicy& operator=(const CacheWithSampledLruPolicy& other) {
+    capacity_ = other.capacity_;
+    samples_ = other.samples_;
+    seed_ = other.seed_;
+    random_ = utils::random::Xoshiro256(seed_);
+    clock_ = 0;
+    slots_.clear();
+    return *this;
   }
 
+  bool OnHit(CacheType* cache, SlotIndex slot) {
+    cache->metadata(slot).last_access = ++clock_;
+    return true;
+  }
+
+  void OnInsert(CacheType* cache, SlotIndex slot) {
+    slots_.Add(cache, slot);
+    cache->metadata(slot).last_access = ++clock_;
+  }
+
+  void OnErase(CacheType* cache, SlotIndex slot) {
+    slots_.Remove(cache, slot);
+  }
+
+  void Evict(CacheType* cache) {
+    while (cache->size() >= capacity_ && !slots_.empty()) {
+      uint32_t size = static_cast<uint32_t>(slots_.size());
+      SlotIndex victim = slots_[random_.Below(size)];
+      for (size_t sample = 1; sample < samples_; ++sample) {
+        SlotIndex slot = slots_[random_.Below(size)];
+        if (cache->metadata(slot).last_access <
+            cache->metadata(victim).last_access) {
+          victim = slot;
+        }
+      }
+      slots_.Remove(cache, victim);
+      this->Discard(cache, victim, RemovalCause::kCapacity);
+    }
+  }
+
+ private:
   size_t capacity_;
-  std::vector<KeyType> keys_;
+  size_t samples_;
+  uint64_t seed_;
+  utils::random::Xoshiro256 random_;
+  uint64_t clock_;
+  DenseSlots slots_;
 };
 
 }  // namespace cache
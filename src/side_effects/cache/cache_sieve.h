@@ -0,0 +1,120 @@
+/*
+ * Copyright (C) 2024  OverbearingPearl
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ * The above copyright notice and this permission notice shall be included in
+ * all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+ * THE SOFTWARE.
+ */
+
+#pragma once
+
+#include "src/side_effects/cache/cache.h"
+#include "src/side_effects/cache/pool_allocator.h"
+
+namespace side_effects {
+namespace cache {
+
+struct SieveMetadata {
+  VisitedBit visited;
+  SlotList::iterator position;
+};
+
+// SIEVE: entries are kept in insertion order and never move on a hit, which
+// only sets the visited bit. The hand walks from the oldest entry towards the
+// newest, clearing set bits and evicting the first unvisited entry, and
+// resumes from there on the next eviction. New entries that are never hit
+// again are evicted quickly, while popular ones stay put.
+template <typename KeyType, typename ValueType>
+class CacheWithSievePolicy
+    : public Insertable<CacheWithSievePolicy<KeyType, ValueType>, KeyType,
+                        ValueType, SieveMetadata> {
+ public:
+  using CacheType = Cache<KeyType, ValueType, SieveMetadata>;
+
+  static constexpr bool kConcurrentHits = true;
+
+  explicit CacheWithSievePolicy(size_t capacity)
+      : capacity_(capacity),
+        order_(PoolAllocator<SlotIndex>(capacity)),
+        hand_(order_.end()) {}
+
+  CacheWithSievePolicy(const CacheWithSievePolicy& other)
+      : Insertable<CacheWithSievePolicy, KeyType, ValueType,
+                   SieveMetadata>(other),
+        capacity_(other.capacity_),
+        order_(SeparatePool(other.order_)),
+        hand_(order_.end()) {}
+
+  CacheWithSievePolicy& operator=(const CacheWithSievePolicy& other) {
+    capacity_ = other.capacity_;
+    order_.clear();
+    hand_ = order_.end();
+    return *this;
+  }
+
+  bool OnHit(CacheType* cache, SlotIndex slot) {
+    OnSharedHit(*cache, slot);
+    return true;
+  }
+
+  void OnSharedHit(const CacheType& cache, SlotIndex slot) const {
+    cache.metadata(slot).visited.Set();
+  }
+
+  void OnInsert(CacheType* cache, SlotIndex slot) {
+    cache->metadata(slot).position = order_.insert(order_.end(), slot);
+  }
+
+  void OnErase(CacheType* cache, SlotIndex slot) {
+    Unlink(cache->metadata(slot).position);
+  }
+
+  void Evict(CacheType* cache) {
+    while (cache->size() >= capacity_ && !order_.empty()) {
+      if (hand_ == order_.end()) {
+        hand_ = order_.begin();
+      }
+      SieveMetadata& metadata = cache->metadata(*hand_);
+      if (metadata.visited.Get()) {
+        metadata.visited.Clear();
+        ++hand_;
+        continue;
+      }
+      SlotIndex slot = *hand_;
+      Unlink(hand_);
+      this->Discard(cache, slot, RemovalCause::kCapacity);
+    }
+  }
+
+ private:
+  void Unlink(SlotList::iterator position) {
+    if (hand_ == position) {
+      hand_ = order_.erase(position);
+    } else {
+      order_.erase(position);
+    }
+  }
+
+  size_t capacity_;
+  SlotList order_;  // Oldest first.
+  SlotList::iterator hand_;
+};
+
+template <typename KeyType, typename ValueType>
+constexpr bool CacheWithSievePolicy<KeyType, ValueType>::kConcurrentHits;
+
+}  // namespace cache
+}  // namespace side_effects
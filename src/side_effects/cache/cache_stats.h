@@ -0,0 +1,163 @@
+/*
+ * Copyright (C) 2024  OverbearingPearl
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ * The above copyright notice and this permission notice shall be included in
+ * all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+ * THE SOFTWARE.
+ */
+
+#pragma once
+
+#include <atomic>
+#include <cstddef>
+#include <cstdint>
+
+#include "src/side_effects/concurrency/striped.h"
+
+namespace side_effects {
+namespace cache {
+
+// Why an entry left a cache.
+enum class RemovalCause {
+  kCapacity,  // Evicted by the policy to make room.
+  kExpired,   // Outlived its time to live.
+  kReplaced,  // Overwritten by a new value for the same key.
+  kExplicit,  // Erased by the caller.
+};
+
+constexpr size_t kRemovalCauseCount = 4;
+
+// Point-in-time counters of a cache, or of a memoized function summed over
+// its shards. The load fields are only filled in by the memoization layer.
+struct CacheStats {
+  CacheStats()
+      : hits(0),
+        misses(0),
+        inserts(0),
+        removals(),
+        loads(0),
+        load_failures(0),
+        load_nanos(0),
+        size(0),
+        weight(0) {}
+
+  uint64_t Removals(RemovalCause cause) const {
+    return removals[static_cast<size_t>(cause)];
+  }
+
+  double HitRatio() const {
+    uint64_t requests = hits + misses;
+    return requests == 0 ? 0 : static_cast<double>(hits) / requests;
+  }
+
+  // Mean time spent computing a missed value, failures included.
+  double AverageLoadNanos() const {
+    uint64_t attempts = loads + load_failures;
+    return attempts == 0 ? 0 : static_cast<double>(load_nanos) / attempts;
+  }
+
+  CacheStats& operator+=(const CacheStats& other) {
+    hits += other.hits;
+    misses += other.misses;
+    inserts += other.inserts;
+    for (size_t cause = 0; cause < kRemovalCauseCount; ++cause) {
+      removals[cause] += other.removals[cause];
+    }
+    loads += other.loads;
+    load_failures += other.load_failures;
+    load_nanos += other.load_nanos;
+    size += other.size;
+    weight += other.weight;
+    return *this;
+  }
+
+  uint64_t hits;
+  uint64_t misses;
+  uint64_t inserts;
+  uint64_t removals[kRemovalCauseCount];
+  uint64_t loads;
+  uint64_t load_failures;
+  uint64_t load_nanos;
+  size_t size;
+  size_t weight;
+};
+
+// Event counter bumped with a relaxed atomic add: a few nanoseconds, and a
+// reader may see a slightly stale total.
+class StatsCounter {
+ public:
+  StatsCounter() : value_(0) {}
+
+  void Add(uint64_t amount = 1) {
+    value_.fetch_add(amount, std::memory_order_relaxed);
+  }
+
+  uint64_t Get() const { return value_.load(std::memory_order_relaxed); }
+
+  void Reset() { value_.store(0, std::memory_order_relaxed); }
+
+ private:
+  std::atomic<uint64_t> value_;
+};
+
+// StatsCounter for events many threads record at once, such as hits served
+// under a shared lock. Each thread adds to one of several cells on separate
+// cache lines, and Get sums them, so writers do not contend.
+class StripedStatsCounter {
+ public:
+  void Add(uint64_t amount = 1) {
+    cells_[concurrency::internal::ThreadStripe<kStripes>()].value.Add(amount);
+  }
+
+  uint64_t Get() const {
+    uint64_t total = 0;
+    for (const auto& cell : cells_) {
+      total += cell.value.Get();
+    }
+    return total;
+  }
+
+  void Reset() {
+    for (auto& cell : cells_) {
+      cell.value.Reset();
+    }
+  }
+
+ private:
+  static constexpr size_t kStripes = 8;
+
+  concurrency::internal::Padded<StatsCounter> cells_[kStripes];
+};
+
+// The counters Insertable keeps for its cache.
+struct CacheCounters {
+  void Reset() {
+    hits.Reset();
+    misses.Reset();
+    inserts.Reset();
+    for (auto& removal : removals) {
+      removal.Reset();
+    }
+  }
+
+  StripedStatsCounter hits;
+  StatsCounter misses;
+  StatsCounter inserts;
+  StatsCounter removals[kRemovalCauseCount];
+};
+
+}  // namespace cache
+}  // namespace side_effects
@@ -0,0 +1,189 @@
+/*
+ * Copyright (C) 2024  OverbearingPearl
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ * The above copyright notice and this permission notice shall be included in
+ * all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+ * THE SOFTWARE.
+ */
+
+#pragma once
+
+#include <algorithm>
+#include <cstdint>
+
+#include "src/side_effects/cache/cache.h"
+#include "src/side_effects/cache/pool_allocator.h"
+#include "src/side_effects/cache/frequency_sketch.h"
+
+namespace side_effects {
+namespace cache {
+
+enum class TinyLfuRegion : uint8_t { kWindow, kProbation, kProtected };
+
+struct TinyLfuMetadata {
+  TinyLfuRegion region;
+  SlotList::iterator position;
+};
+
+// W-TinyLFU. New entries enter a small LRU window (1% of capacity). An entry
+// leaving the window only gets into the main cache if the FrequencySketch
+// says it is used more often than the main cache's eviction victim, so a
+// scan of one-off keys cannot push out the hot set.
+//
+// The main cache is a segmented LRU: entries are admitted to probation, and
+// a hit there promotes them to the protected segment (80% of the main
+// cache), whose overflow is demoted back to probation. The victim is always
+// probation's least recently used entry.
+//
+// The sketch is fed the hash each entry already stores, so recording an
+// access never hashes the key again.
+template <typename KeyType, typename ValueType>
+class CacheWithTinyLfuPolicy
+    : public Insertable<CacheWithTinyLfuPolicy<KeyType, ValueType>, KeyType,
+                        ValueType, TinyLfuMetadata> {
+ public:
+  using CacheType = Cache<KeyType, ValueType, TinyLfuMetadata>;
+
+  explicit CacheWithTinyLfuPolicy(size_t capacity)
+      : capacity_(capacity),
+        window_capacity_(std::max<size_t>(capacity / 100, 1)),
+        protected_capacity_((capacity - std::min(capacity, window_capacity_)) *
+                            4 / 5),
+        sketch_(capacity),
+        window_(PoolAllocator<SlotIndex>(capacity)),
+        probation_(window_.get_allocator()),
+        protected_(window_.get_allocator()) {}
+
+  CacheWithTinyLfuPolicy(const CacheWithTinyLfuPolicy& other)
+      : CacheWithTinyLfuPolicy(other.capacity_) {}
+
+  CacheWithTinyLfuPolicy& operator=(const CacheWithTinyLfuPolicy& other) {
+    capacity_ = other.capacity_;
+    window_capacity_ = other.window_capacity_;
+    protected_capacity_ = other.protected_capacity_;
+    sketch_ = FrequencySketch(capacity_);
+    window_.clear();
+    probation_.clear();
+    protected_.clear();
+    return *this;
+  }
+
+  bool OnHit(CacheType* cache, SlotIndex slot) {
+    sketch_.Increment(cache->hash(slot));
+    TinyLfuMetadata& metadata = cache->metadata(slot);
+    switch (metadata.region) {
+      case TinyLfuRegion::kWindow:
+        MoveToFront(&window_, metadata.position, &window_);
+        break;
+      case TinyLfuRegion::kProbation:
+        MoveToFront(&protected_, metadata.position, &probation_);
+        metadata.region = TinyLfuRegion::kProtected;
+        if (protected_.size() > protected_capacity_) {
+          SlotIndex demoted = protected_.back();
+          MoveToFront(&probation_, cache->metadata(demoted).position,
+                      &protected_);
+          cache->metadata(demoted).region = TinyLfuRegion::kProbation;
+        }
+        break;
+      case TinyLfuRegion::kProtected:
+        MoveToFront(&protected_, metadata.position, &protected_);
+        break;
+    }
+    return true;
+  }
+
+  void OnInsert(CacheType* cache, SlotIndex slot) {
+    sketch_.Increment(cache->hash(slot));
+    window_.push_front(slot);
+    cache->metadata(slot) =
+        TinyLfuMetadata{TinyLfuRegion::kWindow, window_.begin()};
+  }
+
+  void OnErase(CacheType* cache, SlotIndex slot) {
+    const TinyLfuMetadata& metadata = cache->metadata(slot);
+    ListFor(metadata.region).erase(metadata.position);
+  }
+
+  // The window's least recently used entry (the candidate) moves to
+  // probation to make room for the new key. If the cache is full, the
+  // candidate and probation's least recently used entry compete, and the
+  // less frequent one is evicted; ties go to the incumbent.
+  void Evict(CacheType* cache) {
+    SlotIndex candidate = kNoSlot;
+    if (window_.size() >= window_capacity_ && !window_.empty()) {
+      candidate = window_.back();
+      MoveToFront(&probation_, cache->metadata(candidate).position, &window_);
+      cache->metadata(candidate).region = TinyLfuRegion::kProbation;
+    }
+    while (cache->size() >= capacity_ && !cache->empty()) {
+      SlotIndex victim = Victim();
+      if (candidate != kNoSlot && victim != candidate &&
+          sketch_.Estimate(cache->hash(candidate)) <=
+              sketch_.Estimate(cache->hash(victim))) {
+        victim = candidate;
+      }
+      if (victim == candidate) {
+        candidate = kNoSlot;
+      }
+      OnErase(cache, victim);
+      this->Discard(cache, victim, RemovalCause::kCapacity);
+    }
+  }
+
+  uint32_t Frequency(const CacheType& cache, const KeyType& key) const {
+    return sketch_.Estimate(CacheType::HashOf(key));
+  }
+
+ private:
+  SlotList& ListFor(TinyLfuRegion region) {
+    switch (region) {
+      case TinyLfuRegion::kWindow:
+        return window_;
+      case TinyLfuRegion::kProbation:
+        return probation_;
+      default:
+        return protected_;
+    }
+  }
+
+  static void MoveToFront(SlotList* to, SlotList::iterator position,
+                          SlotList* from) {
+    to->splice(to->begin(), *from, position);
+  }
+
+  // Probation's least recently used entry; the other segments only give up
+  // entries once probation is empty.
+  SlotIndex Victim() const {
+    if (!probation_.empty()) {
+      return probation_.back();
+    }
+    if (!protected_.empty()) {
+      return protected_.back();
+    }
+    return window_.back();
+  }
+
+  size_t capacity_;
+  size_t window_capacity_;
+  size_t protected_capacity_;
+  FrequencySketch sketch_;
+  SlotList window_;     // Most recently used first.
+  SlotList probation_;  // Most recently used first.
+  SlotList protected_;  // Most recently used first.
+};
+
+}  // namespace cache
+}  // namespace side_effects
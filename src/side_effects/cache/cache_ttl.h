@@ -23,44 +23,227 @@
 #pragma once
 
 #include <chrono>
-#include <memory>
-#include <unordered_map>
+#include <cstdint>
+#include <utility>
+#include <vector>
 
 #include "src/side_effects/cache/cache.h"
+#include "src/side_effects/cache/pool_allocator.h"
 
 namespace side_effects {
 namespace cache {
 
+struct TtlMetadata {
+  std::chrono::steady_clock::time_point deadline;
+  size_t bucket;
+  SlotList::iterator position;
+};
+
+// Expires entries through a hashed timing wheel: every entry sits in the
+// bucket of the tick its deadline falls on, and each insertion only visits
+// the buckets whose ticks have passed since the previous one, so expiry is
+// amortized O(1) per entry. Entries whose deadline lies more than one
+// rotation ahead stay in their bucket until a later pass reaches them.
+//
+// OnHit drops an entry whose deadline has passed even if the wheel has not
+// reached it yet, so a hit never returns an expired value. Hits do not extend
+// the deadline; inserting a new value for a key resets it.
+//
+// A non-zero capacity bounds the entry count (or, with a WeightBudget, the
+// total weight); when full, entries from the wheel's nearest occupied
+// bucket, and so roughly the closest to expiry, are evicted.
 template <typename KeyType, typename ValueType>
-class CacheWithTtlPolicy : public Insertable<KeyType, ValueType> {
+class CacheWithTtlPolicy
+    : public Insertable<CacheWithTtlPolicy<KeyType, ValueType>, KeyType,
+                        ValueType, TtlMetadata> {
  public:
-  explicit CacheWithTtlPolicy(std::chrono::milliseconds ttl) : ttl_(ttl) {}
-
-  void Insert(Cache<KeyType, ValueType>* cache, const KeyType& key,
-              std::shared_ptr<ValueType> value) override {
-    auto now = std::chrono::steady_clock::now();
-    (*cache)[key] = value;
-    timestamps_[key] = now;
-    CleanUp(cache);
+  using Clock = std::chrono::steady_clock;
+  using CacheType = Cache<KeyType, ValueType, TtlMetadata>;
+
+  // A deferred hit could serve an entry past its deadline.
+  static constexpr bool kDeferredHits = false;
+
+  explicit CacheWithTtlPolicy(std::chrono::milliseconds ttl,
+                              size_t capacity = 0)
+      : ttl_(ttl),
+        capacity_(capacity),
+        tick_(TickFor(ttl)),
+        epoch_(Clock::now()),
+        current_tick_(0),
+        wheel_(MakeWheel(PoolAllocator<SlotIndex>(capacity))) {}
+
+  // Bounds the total weight of the entries instead of their count.
+  CacheWithTtlPolicy(
+      std::chrono::milliseconds ttl, WeightBudget budget,
+      Weigher<KeyType, ValueType> weigher = SizeofWeigher<KeyType, ValueType>())
+      : CacheWithTtlPolicy(ttl, budget.limit) {
+    weigher_ = EntryWeigher<KeyType, ValueType>(std::move(weigher));
+  }
+
+  CacheWithTtlPolicy(const CacheWithTtlPolicy& other)
+      : Insertable<CacheWithTtlPolicy, KeyType, ValueType, TtlMetadata>(other),
+        ttl_(other.ttl_),
+        capacity_(other.capacity_),
+        weigher_(other.weigher_),
+        tick_(other.tick_),
+        epoch_(Clock::now()),
+        current_tick_(0),
+        wheel_(MakeWheel(SeparatePool(other.wheel_.front()))) {}
+
+  CacheWithTtlPolicy& operator=(const CacheWithTtlPolicy& other) {
+    ttl_ = other.ttl_;
+    capacity_ = other.capacity_;
+    weigher_ = other.weigher_;
+    tick_ = other.tick_;
+    epoch_ = Clock::now();
+    current_tick_ = 0;
+    for (auto& slots : wheel_) {
+      slots.clear();
+    }
+    return *this;
+  }
+
+  // Inserts with a deadline of now + ttl instead of the policy default.
+  SlotIndex InsertWithTtl(CacheType* cache, KeyType key, ValueType value,
+                          std::chrono::milliseconds ttl) {
+    SlotIndex slot = this->Insert(cache, std::move(key), std::move(value));
+    Unschedule(cache, slot);
+    Schedule(cache, slot, Clock::now() + ttl);
+    return slot;
+  }
+
+  size_t WeightOf(const KeyType& key, const ValueType& value) const {
+    return weigher_(key, value);
+  }
+
+  bool OnHit(CacheType* cache, SlotIndex slot) {
+    if (Clock::now() < cache->metadata(slot).deadline) {
+      return true;
+    }
+    Unschedule(cache, slot);
+    this->Discard(cache, slot, RemovalCause::kExpired);
+    return false;
+  }
+
+  void OnInsert(CacheType* cache, SlotIndex slot) {
+    Schedule(cache, slot, Clock::now() + ttl_);
+  }
+
+  void OnErase(CacheType* cache, SlotIndex slot) { Unschedule(cache, slot); }
+
+  void Evict(CacheType* cache) {
+    Advance(cache, Clock::now());
+    while (capacity_ != 0 && this->NoRoomFor(*cache, capacity_) &&
+           !cache->empty()) {
+      EvictClosestToExpiry(cache);
+    }
   }
 
  private:
-  void CleanUp(Cache<KeyType, ValueType>* cache) {
-    auto now = std::chrono::steady_clock::now();
-    for (auto it = timestamps_.begin(); it != timestamps_.end();) {
-      if (now - it->second > ttl_) {
-        cache->erase(it->first);
-        it = timestamps_.erase(it);
+  static constexpr size_t kBucketCount = 256;
+
+  // Half a rotation covers the default ttl, leaving room for overrides of up
+  // to twice the default before entries wrap around the wheel.
+  static Clock::duration TickFor(std::chrono::milliseconds ttl) {
+    Clock::duration tick = ttl / (kBucketCount / 2);
+    if (tick < std::chrono::milliseconds(1)) {
+      tick = std::chrono::milliseconds(1);
+    }
+    return tick;
+  }
+
+  // The buckets share one pool, sized for the whole cache.
+  static std::vector<SlotList> MakeWheel(
+      const PoolAllocator<SlotIndex>& allocator) {
+    std::vector<SlotList> wheel;
+    wheel.reserve(kBucketCount);
+    for (size_t bucket = 0; bucket < kBucketCount; ++bucket) {
+      wheel.emplace_back(allocator);
+    }
+    return wheel;
+  }
+
+  uint64_t TickOf(Clock::time_point time) const {
+    return time <= epoch_ ? 0 : (time - epoch_) / tick_;
+  }
+
+  void Schedule(CacheType* cache, SlotIndex slot, Clock::time_point deadline) {
+    // Round up so the bucket is only visited once the deadline has passed.
+    uint64_t tick = TickOf(deadline);
+    if (epoch_ + tick * tick_ < deadline) {
+      ++tick;
+    }
+    if (tick <= current_tick_) {
+      tick = current_tick_ + 1;
+    }
+    size_t bucket = tick % kBucketCount;
+    wheel_[bucket].push_front(slot);
+    cache->metadata(slot) = TtlMetadata{deadline, bucket, wheel_[bucket].begin()};
+  }
+
+  void Unschedule(CacheType* cache, SlotIndex slot) {
+    const TtlMetadata& metadata = cache->metadata(slot);
+    wheel_[metadata.bucket].erase(metadata.position);
+  }
+
+  void Advance(CacheType* cache, Clock::time_point now) {
+    uint64_t now_tick = TickOf(now);
+    if (now_tick <= current_tick_) {
+      return;
+    }
+    uint64_t ticks = now_tick - current_tick_;
+    if (ticks > kBucketCount) {
+      ticks = kBucketCount;
+    }
+    for (uint64_t i = 1; i <= ticks; ++i) {
+      ExpireBucket(cache, (current_tick_ + i) % kBucketCount, now);
+    }
+    current_tick_ = now_tick;
+  }
+
+  void ExpireBucket(CacheType* cache, size_t bucket, Clock::time_point now) {
+    SlotList& slots = wheel_[bucket];
+    for (auto slot = slots.begin(); slot != slots.end();) {
+      if (cache->metadata(*slot).deadline <= now) {
+        this->Discard(cache, *slot, RemovalCause::kExpired);
+        slot = slots.erase(slot);
       } else {
-        ++it;
+        ++slot;
+      }
+    }
+  }
+
+  // Walks the wheel from the current tick and evicts the longest-scheduled
+  // entry of the first non-empty bucket. That is within a tick of the
+  // earliest deadline unless the entry is due a rotation or more later;
+  // either way it costs at most one pass over the bucket heads, however
+  // many entries the cache holds.
+  void EvictClosestToExpiry(CacheType* cache) {
+    for (size_t i = 1; i <= kBucketCount; ++i) {
+      SlotList& slots = wheel_[(current_tick_ + i) % kBucketCount];
+      if (!slots.empty()) {
+        SlotIndex victim = slots.back();
+        slots.pop_back();
+        this->Discard(cache, victim, RemovalCause::kCapacity);
+        return;
       }
     }
   }
 
   std::chrono::milliseconds ttl_;
-  std::unordered_map<KeyType, std::chrono::steady_clock::time_point>
-      timestamps_;
+  size_t capacity_;
+  EntryWeigher<KeyType, ValueType> weigher_;
+  Clock::duration tick_;
+  Clock::time_point epoch_;
+  uint64_t current_tick_;
+  std::vector<SlotList> wheel_;
 };
 
+template <typename KeyType, typename ValueType>
+constexpr size_t CacheWithTtlPolicy<KeyType, ValueType>::kBucketCount;
+
+template <typename KeyType, typename ValueType>
+constexpr bool CacheWithTtlPolicy<KeyType, ValueType>::kDeferredHits;
+
 }  // namespace cache
 }  // namespace side_effects
@@ -0,0 +1,119 @@
+/*
+ * Copyright (C) 2024  OverbearingPearl
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ * The above copyright notice and this permission notice shall be included in
+ * all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+ * THE SOFTWARE.
+ */
+
+#pragma once
+
+#include <algorithm>
+
+#include "src/side_effects/cache/cache.h"
+#include "src/side_effects/cache/pool_allocator.h"
+#include "src/side_effects/cache/ghost_list.h"
+
+namespace side_effects {
+namespace cache {
+
+struct TwoQueueMetadata {
+  bool in_main;
+  SlotList::iterator position;
+};
+
+// 2Q (Johnson and Shasha). New keys enter a FIFO holding a quarter of the
+// capacity, and hits there change nothing. Keys it evicts are remembered (by
+// hash) in a ghost FIFO of half the capacity; only a key that misses again
+// while still remembered is admitted to the main LRU. A sweep of keys used
+// once therefore never displaces the main LRU's hot set.
+template <typename KeyType, typename ValueType>
+class CacheWithTwoQueuePolicy
+    : public Insertable<CacheWithTwoQueuePolicy<KeyType, ValueType>, KeyType,
+                        ValueType, TwoQueueMetadata> {
+ public:
+  using CacheType = Cache<KeyType, ValueType, TwoQueueMetadata>;
+
+  explicit CacheWithTwoQueuePolicy(size_t capacity)
+      : capacity_(capacity),
+        in_capacity_(std::max<size_t>(capacity / 4, 1)),
+        ghost_capacity_(std::max<size_t>(capacity / 2, 1)),
+        in_(PoolAllocator<SlotIndex>(capacity)),
+        main_(in_.get_allocator()),
+        ghosts_(ghost_capacity_) {}
+
+  CacheWithTwoQueuePolicy(const CacheWithTwoQueuePolicy& other)
+      : CacheWithTwoQueuePolicy(other.capacity_) {}
+
+  CacheWithTwoQueuePolicy& operator=(const CacheWithTwoQueuePolicy& other) {
+    capacity_ = other.capacity_;
+    in_capacity_ = other.in_capacity_;
+    ghost_capacity_ = other.ghost_capacity_;
+    in_.clear();
+    main_.clear();
+    ghosts_.clear();
+    return *this;
+  }
+
+  bool OnHit(CacheType* cache, SlotIndex slot) {
+    TwoQueueMetadata& metadata = cache->metadata(slot);
+    if (metadata.in_main) {
+      main_.splice(main_.begin(), main_, metadata.position);
+    }
+    return true;
+  }
+
+  void OnInsert(CacheType* cache, SlotIndex slot) {
+    bool in_main = ghosts_.Erase(cache->hash(slot));
+    SlotList& list = in_main ? main_ : in_;
+    list.push_front(slot);
+    cache->metadata(slot) = TwoQueueMetadata{in_main, list.begin()};
+  }
+
+  void OnErase(CacheType* cache, SlotIndex slot) {
+    const TwoQueueMetadata& metadata = cache->metadata(slot);
+    (metadata.in_main ? main_ : in_).erase(metadata.position);
+  }
+
+  void Evict(CacheType* cache) {
+    while (cache->size() >= capacity_ && !cache->empty()) {
+      if (in_.size() > in_capacity_ || main_.empty()) {
+        SlotIndex slot = in_.back();
+        in_.pop_back();
+        ghosts_.Push(cache->hash(slot));
+        if (ghosts_.size() > ghost_capacity_) {
+          ghosts_.PopBack();
+        }
+        this->Discard(cache, slot, RemovalCause::kCapacity);
+      } else {
+        SlotIndex slot = main_.back();
+        main_.pop_back();
+        this->Discard(cache, slot, RemovalCause::kCapacity);
+      }
+    }
+  }
+
+ private:
+  size_t capacity_;
+  size_t in_capacity_;
+  size_t ghost_capacity_;
+  SlotList in_;    // Newest first.
+  SlotList main_;  // Most recently used first.
+  GhostList ghosts_;
+};
+
+}  // namespace cache
+}  // namespace side_effects
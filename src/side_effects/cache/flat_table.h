@@ -0,0 +1,497 @@
+/*
+ * Copyright (C) 2024  OverbearingPearl
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ * The above copyright notice and this permission notice shall be included in
+ * all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+ * THE SOFTWARE.
+ */
+
+#pragma once
+
+#include <algorithm>
+#include <cstddef>
+#include <cstdint>
+#include <new>
+#include <type_traits>
+#include <utility>
+#include <vector>
+
+#if defined(__SSE2__) || defined(_M_X64) || defined(_M_AMD64)
+#include <emmintrin.h>
+#define FLAT_TABLE_SSE2
+#endif
+
+namespace side_effects {
+namespace cache {
+
+// Stable handle to an entry of a FlatTable. It stays valid until the entry is
+// erased, across rehashes, so policies can keep slots instead of key copies.
+using SlotIndex = uint32_t;
+constexpr SlotIndex kNoSlot = 0xFFFFFFFFu;
+
+struct NoMetadata {};
+
+namespace internal {
+
+constexpr size_t kGroupWidth = 16;
+constexpr int8_t kEmpty = -128;
+constexpr int8_t kDeleted = -2;
+
+inline uint32_t MatchByte(const int8_t* group, int8_t byte) {
+#ifdef FLAT_TABLE_SSE2
+  __m128i ctrl = _mm_loadu_si128(reinterpret_cast<const __m128i*>(group));
+  return static_cast<uint32_t>(
+      _mm_movemask_epi8(_mm_cmpeq_epi8(_mm_set1_epi8(byte), ctrl)));
+#else
+  uint32_t mask = 0;
+  for (size_t i = 0; i < kGroupWidth; ++i) {
+    mask |= static_cast<uint32_t>(group[i] == byte) << i;
+  }
+  return mask;
+#endif
+}
+
+// Empty and deleted control bytes are the only negative ones.
+inline uint32_t MatchEmptyOrDeleted(const int8_t* group) {
+#ifdef FLAT_TABLE_SSE2
+  __m128i ctrl = _mm_loadu_si128(reinterpret_cast<const __m128i*>(group));
+  return static_cast<uint32_t>(_mm_movemask_epi8(ctrl));
+#else
+  uint32_t mask = 0;
+  for (size_t i = 0; i < kGroupWidth; ++i) {
+    mask |= static_cast<uint32_t>(group[i] < 0) << i;
+  }
+  return mask;
+#endif
+}
+
+inline uint32_t LowestBit(uint32_t mask) {
+#if defined(__GNUC__) || defined(__clang__)
+  return static_cast<uint32_t>(__builtin_ctz(mask));
+#else
+  uint32_t bit = 0;
+  while ((mask & 1u) == 0) {
+    mask >>= 1;
+    ++bit;
+  }
+  return bit;
+#endif
+}
+
+// Hint that addr will be read soon. No-op where unsupported.
+inline void PrefetchRead(const void* addr) {
+#if defined(__GNUC__) || defined(__clang__)
+  __builtin_prefetch(addr, 0, 3);
+#elif defined(FLAT_TABLE_SSE2)
+  _mm_prefetch(static_cast<const char*>(addr), _MM_HINT_T0);
+#endif
+}
+
+}  // namespace internal
+
+// Open-addressing hash table in the style of Swiss tables. Lookups probe
+// groups of 16 one-byte control tags (7 bits of the hash, or empty/deleted)
+// with a single SIMD compare, and only touch entries whose tag matches.
+//
+// Entries (key, value and per-policy metadata, inline) live in a dense slot
+// array; the control groups map to slot indices. Rehashing only rebuilds the
+// control groups, so a SlotIndex stays valid until its entry is erased.
+//
+// Each entry stores its hash, so growing and erasing never re-hash a key, and
+// its weight (1 unless given), so the total weight is known at all times.
+// Hash must spread well over all 64 bits (the low 7 bits are the tag, the
+// next ones pick the group); utils::immutable::TupleHash does.
+template <typename KeyType, typename ValueType, typename Metadata,
+          typename Hash, typename Equal>
+class FlatTable {
+ public:
+  FlatTable()
+      : slots_(nullptr),
+        slot_capacity_(0),
+        slot_end_(0),
+        size_(0),
+        deleted_(0),
+        weight_(0) {}
+
+  FlatTable(const FlatTable& other) : FlatTable() {
+    ctrl_ = other.ctrl_;
+    index_ = other.index_;
+    free_slots_ = other.free_slots_;
+    slots_ = Allocate(other.slot_capacity_);
+    slot_capacity_ = other.slot_capacity_;
+    slot_end_ = other.slot_end_;
+    deleted_ = other.deleted_;
+    weight_ = other.weight_;
+    other.ForEach([this, &other](SlotIndex slot) {
+      new (&slots_[slot]) Slot(other.slots_[slot].entry);
+      ++size_;
+    });
+  }
+
+  FlatTable(FlatTable&& other) noexcept : FlatTable() { Swap(&other); }
+
+  FlatTable& operator=(FlatTable other) {
+    Swap(&other);
+    return *this;
+  }
+
+  ~FlatTable() {
+    DestroyAll();
+    Deallocate(slots_);
+  }
+
+  // probe may be any type that Hash and Equal accept alongside KeyType (for
+  // instance a tuple of references), so a lookup does not have to build a key.
+  template <typename Probe>
+  SlotIndex Find(const Probe& probe) const {
+    return Find(probe, HashOf(probe));
+  }
+
+  // As above, with hash already computed by HashOf(probe).
+  template <typename Probe>
+  SlotIndex Find(const Probe& probe, uint64_t hash) const {
+    if (ctrl_.empty()) {
+      return kNoSlot;
+    }
+    int8_t tag = Tag(hash);
+    size_t group = GroupOf(hash);
+    for (size_t step = 1;; ++step) {
+      const int8_t* ctrl = &ctrl_[group * internal::kGroupWidth];
+      for (uint32_t match = internal::MatchByte(ctrl, tag); match != 0;
+           match &= match - 1) {
+        size_t bucket =
+            group * internal::kGroupWidth + internal::LowestBit(match);
+        SlotIndex slot = index_[bucket];
+        if (Equal()(slots_[slot].entry.key, probe)) {
+          return slot;
+        }
+      }
+      if (internal::MatchByte(ctrl, internal::kEmpty) != 0) {
+        return kNoSlot;
+      }
+      group = (group + step) & GroupMask();
+    }
+  }
+
+  // Pulls the first control group Find(probe, hash) would read, and its slot
+  // indices, into cache. Issued a few keys ahead, it overlaps the misses of
+  // a run of lookups.
+  void Prefetch(uint64_t hash) const {
+    if (ctrl_.empty()) {
+      return;
+    }
+    size_t bucket = GroupOf(hash) * internal::kGroupWidth;
+    internal::PrefetchRead(&ctrl_[bucket]);
+    internal::PrefetchRead(&index_[bucket]);
+  }
+
+  // key must not be present yet.
+  SlotIndex Emplace(KeyType key, ValueType value) {
+    uint64_t hash = HashOf(key);
+    return Emplace(std::move(key), std::move(value), hash);
+  }
+
+  // As above, with hash already computed by HashOf(key).
+  SlotIndex Emplace(KeyType key, ValueType value, uint64_t hash,
+                    size_t weight = 1) {
+    if (size_ + deleted_ + 1 > MaxLoad(ctrl_.size())) {
+      Grow();
+    }
+    size_t bucket = FindInsertBucket(hash);
+    SlotIndex slot = AcquireSlot();
+    new (&slots_[slot]) Slot(std::move(key), std::move(value), hash, weight);
+    if (ctrl_[bucket] == internal::kDeleted) {
+      --deleted_;
+    }
+    ctrl_[bucket] = Tag(hash);
+    index_[bucket] = slot;
+    ++size_;
+    weight_ += weight;
+    return slot;
+  }
+
+  void Erase(SlotIndex slot) {
+    size_t bucket = BucketOf(slot);
+    size_t group = bucket / internal::kGroupWidth;
+    // A group that still has an empty tag ends every probe passing through
+    // it, so the bucket can become empty instead of a tombstone.
+    if (internal::MatchByte(&ctrl_[group * internal::kGroupWidth],
+                            internal::kEmpty) != 0) {
+      ctrl_[bucket] = internal::kEmpty;
+    } else {
+      ctrl_[bucket] = internal::kDeleted;
+      ++deleted_;
+    }
+    weight_ -= slots_[slot].entry.weight;
+    slots_[slot].~Slot();
+    free_slots_.push_back(slot);
+    --size_;
+  }
+
+  void Reserve(size_t size) {
+    size_t groups = ctrl_.size() / internal::kGroupWidth;
+    size_t new_groups = groups == 0 ? 1 : groups;
+    while (MaxLoad(new_groups * internal::kGroupWidth) < size) {
+      new_groups *= 2;
+    }
+    if (new_groups != groups) {
+      Rehash(new_groups);
+    }
+  }
+
+  // Whether slot holds a live entry with this hash. Only the control groups
+  // are read, so unlike hash(slot) this may be asked of an erased slot.
+  bool Holds(SlotIndex slot, uint64_t hash) const {
+    return slot < slot_end_ && !ctrl_.empty() &&
+           FindBucket(slot, hash) != ctrl_.size();
+  }
+
+  const KeyType& key(SlotIndex slot) const { return slots_[slot].entry.key; }
+  uint64_t hash(SlotIndex slot) const { return slots_[slot].entry.hash; }
+  size_t weight(SlotIndex slot) const { return slots_[slot].entry.weight; }
+  ValueType& value(SlotIndex slot) { return slots_[slot].entry.value; }
+  const ValueType& value(SlotIndex slot) const {
+    return slots_[slot].entry.value;
+  }
+  Metadata& metadata(SlotIndex slot) { return slots_[slot].entry.metadata; }
+  const Metadata& metadata(SlotIndex slot) const {
+    return slots_[slot].entry.metadata;
+  }
+
+  size_t size() const { return size_; }
+  bool empty() const { return size_ == 0; }
+  // Sum of the entries' weights; equals size() unless weights were given.
+  size_t weight() const { return weight_; }
+  size_t count(const KeyType& key) const {
+    return Find(key) == kNoSlot ? 0 : 1;
+  }
+
+  void clear() {
+    DestroyAll();
+    ctrl_.assign(ctrl_.size(), internal::kEmpty);
+    free_slots_.clear();
+    slot_end_ = 0;
+    size_ = 0;
+    deleted_ = 0;
+    weight_ = 0;
+  }
+
+  // Calls visit(slot) for every live entry.
+  template <typename Visitor>
+  void ForEach(Visitor visit) const {
+    for (size_t bucket = 0; bucket < ctrl_.size(); ++bucket) {
+      if (ctrl_[bucket] >= 0) {
+        visit(index_[bucket]);
+      }
+    }
+  }
+
+  template <typename Probe>
+  static uint64_t HashOf(const Probe& probe) {
+    return static_cast<uint64_t>(Hash()(probe));
+  }
+
+ private:
+  struct Entry {
+    Entry(KeyType k, ValueType v, uint64_t h, size_t w)
+        : key(std::move(k)),
+          value(std::move(v)),
+          metadata(),
+          hash(h),
+          weight(w) {}
+
+    KeyType key;
+    ValueType value;
+    Metadata metadata;
+    uint64_t hash;
+    size_t weight;
+  };
+
+  // Raw storage, so unused slots hold no constructed key or value.
+  union Slot {
+    Slot(KeyType key, ValueType value, uint64_t hash, size_t weight)
+        : entry(std::move(key), std::move(value), hash, weight) {}
+    explicit Slot(const Entry& other) : entry(other) {}
+    explicit Slot(Entry&& other) : entry(std::move(other)) {}
+    ~Slot() {}
+
+    Entry entry;
+  };
+
+  static size_t MaxLoad(size_t buckets) { return buckets - buckets / 8; }
+
+  static int8_t Tag(uint64_t hash) { return static_cast<int8_t>(hash & 0x7F); }
+
+  static Slot* Allocate(size_t count) {
+    if (count == 0) {
+      return nullptr;
+    }
+    return static_cast<Slot*>(::operator new(count * sizeof(Slot)));
+  }
+
+  static void Deallocate(Slot* slots) { ::operator delete(slots); }
+
+  size_t GroupMask() const { return ctrl_.size() / internal::kGroupWidth - 1; }
+
+  size_t GroupOf(uint64_t hash) const { return (hash >> 7) & GroupMask(); }
+
+  size_t FindInsertBucket(uint64_t hash) const {
+    size_t group = GroupOf(hash);
+    for (size_t step = 1;; ++step) {
+      uint32_t free_mask = internal::MatchEmptyOrDeleted(
+          &ctrl_[group * internal::kGroupWidth]);
+      if (free_mask != 0) {
+        return group * internal::kGroupWidth + internal::LowestBit(free_mask);
+      }
+      group = (group + step) & GroupMask();
+    }
+  }
+
+  size_t BucketOf(SlotIndex slot) const {
+    return FindBucket(slot, slots_[slot].entry.hash);
+  }
+
+  // The bucket indexing slot along hash's probe sequence, or ctrl_.size()
+  // if there is none.
+  size_t FindBucket(SlotIndex slot, uint64_t hash) const {
+    int8_t tag = Tag(hash);
+    size_t group = GroupOf(hash);
+    for (size_t step = 1;; ++step) {
+      const int8_t* ctrl = &ctrl_[group * internal::kGroupWidth];
+      for (uint32_t match = internal::MatchByte(ctrl, tag); match != 0;
+           match &= match - 1) {
+        size_t bucket =
+            group * internal::kGroupWidth + internal::LowestBit(match);
+        if (index_[bucket] == slot) {
+          return bucket;
+        }
+      }
+      if (internal::MatchByte(ctrl, internal::kEmpty) != 0) {
+        return ctrl_.size();
+      }
+      group = (group + step) & GroupMask();
+    }
+  }
+
+  SlotIndex AcquireSlot() {
+    if (!free_slots_.empty()) {
+      SlotIndex slot = free_slots_.back();
+      free_slots_.pop_back();
+      return slot;
+    }
+    return static_cast<SlotIndex>(slot_end_++);
+  }
+
+  // Doubles the control groups, or rebuilds them at the same size when most
+  // of the load is tombstones.
+  void Grow() {
+    size_t groups = ctrl_.size() / internal::kGroupWidth;
+    if (groups == 0) {
+      Rehash(1);
+    } else if (size_ + 1 > MaxLoad(ctrl_.size()) / 2) {
+      Rehash(groups * 2);
+    } else {
+      Rehash(groups);
+    }
+  }
+
+  void Rehash(size_t groups) {
+    size_t buckets = groups * internal::kGroupWidth;
+    if (buckets == ctrl_.size()) {
+      ClearTombstones();
+      return;
+    }
+    std::vector<int8_t> ctrl(buckets, internal::kEmpty);
+    std::vector<SlotIndex> index(buckets, kNoSlot);
+
+    size_t slot_capacity = MaxLoad(buckets);
+    if (slot_capacity > slot_capacity_) {
+      Slot* slots = Allocate(slot_capacity);
+      ForEach([this, slots](SlotIndex slot) {
+        new (&slots[slot]) Slot(std::move(slots_[slot].entry));
+        slots_[slot].~Slot();
+      });
+      Deallocate(slots_);
+      slots_ = slots;
+      slot_capacity_ = slot_capacity;
+      live_slots_.reserve(slot_capacity);
+    }
+
+    std::vector<int8_t> old_ctrl;
+    std::vector<SlotIndex> old_index;
+    old_ctrl.swap(ctrl_);
+    old_index.swap(index_);
+    ctrl_.swap(ctrl);
+    index_.swap(index);
+    deleted_ = 0;
+    for (size_t bucket = 0; bucket < old_ctrl.size(); ++bucket) {
+      if (old_ctrl[bucket] >= 0) {
+        SlotIndex slot = old_index[bucket];
+        uint64_t hash = slots_[slot].entry.hash;
+        size_t target = FindInsertBucket(hash);
+        ctrl_[target] = Tag(hash);
+        index_[target] = slot;
+      }
+    }
+  }
+
+  // Rebuilds the control groups at their current size, reusing every
+  // buffer, so a table whose size has levelled off stops allocating even
+  // when erasures leave tombstones behind.
+  void ClearTombstones() {
+    live_slots_.clear();
+    ForEach([this](SlotIndex slot) { live_slots_.push_back(slot); });
+    std::fill(ctrl_.begin(), ctrl_.end(), internal::kEmpty);
+    deleted_ = 0;
+    for (SlotIndex slot : live_slots_) {
+      uint64_t hash = slots_[slot].entry.hash;
+      size_t target = FindInsertBucket(hash);
+      ctrl_[target] = Tag(hash);
+      index_[target] = slot;
+    }
+  }
+
+  void DestroyAll() {
+    ForEach([this](SlotIndex slot) { slots_[slot].~Slot(); });
+  }
+
+  void Swap(FlatTable* other) {
+    std::swap(slots_, other->slots_);
+    std::swap(slot_capacity_, other->slot_capacity_);
+    std::swap(slot_end_, other->slot_end_);
+    std::swap(size_, other->size_);
+    std::swap(deleted_, other->deleted_);
+    std::swap(weight_, other->weight_);
+    ctrl_.swap(other->ctrl_);
+    index_.swap(other->index_);
+    free_slots_.swap(other->free_slots_);
+    live_slots_.swap(other->live_slots_);
+  }
+
+  std::vector<int8_t> ctrl_;      // One tag per bucket, in groups of 16.
+  std::vector<SlotIndex> index_;  // Slot of each full bucket.
+  Slot* slots_;
+  size_t slot_capacity_;
+  size_t slot_end_;  // Slots at or past this index were never used.
+  std::vector<SlotIndex> free_slots_;
+  std::vector<SlotIndex> live_slots_;  // Scratch for ClearTombstones.
+  size_t size_;
+  size_t deleted_;
+  size_t weight_;
+};
+
+}  // namespace cache
+}  // namespace side_effects
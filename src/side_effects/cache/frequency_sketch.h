@@ -0,0 +1,160 @@
+/*
+ * Copyright (C) 2024  OverbearingPearl
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ * The above copyright notice and this permission notice shall be included in
+ * all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+ * THE SOFTWARE.
+ */
+
+#pragma once
+
+#include <algorithm>
+#include <cstddef>
+#include <cstdint>
+#include <vector>
+
+namespace side_effects {
+namespace cache {
+
+// Approximate access counts for admission decisions, in about 9 bytes per
+// cached entry whatever the key type.
+//
+// A count-min sketch of 4-bit counters (16 per word, 4 probes per key)
+// saturating at 15. In front of it a one-bit-per-probe doorkeeper bloom
+// filter absorbs the first access of each key, so the many keys seen only
+// once never reach the counters. After 10 * capacity recorded accesses all
+// counters are halved and the doorkeeper is cleared, so old popularity
+// fades.
+//
+// Keys are identified by their 64-bit hash (FlatTable::hash), which must be
+// well mixed.
+class FrequencySketch {
+ public:
+  explicit FrequencySketch(size_t capacity)
+      : counters_(RoundUpToPowerOfTwo(capacity)),
+        doorkeeper_(std::max<size_t>(RoundUpToPowerOfTwo(capacity) / 8, 1)),
+        sample_size_(10 * std::max<size_t>(capacity, 1)),
+        additions_(0) {}
+
+  void Increment(uint64_t hash) {
+    if (doorkeeper_.Put(hash)) {
+      uint32_t low = static_cast<uint32_t>(hash);
+      uint32_t high = static_cast<uint32_t>(hash >> 32);
+      for (uint32_t probe = 0; probe < kDepth; ++probe) {
+        size_t index = CounterIndex(low, high, probe);
+        uint64_t& word = counters_[index >> 4];
+        uint32_t shift = (index & 15) << 2;
+        if (((word >> shift) & 0xF) != 0xF) {
+          word += uint64_t{1} << shift;
+        }
+      }
+    }
+    if (++additions_ >= sample_size_) {
+      Reset();
+    }
+  }
+
+  // At most 16: 15 from the counters plus one from the doorkeeper.
+  uint32_t Estimate(uint64_t hash) const {
+    uint32_t low = static_cast<uint32_t>(hash);
+    uint32_t high = static_cast<uint32_t>(hash >> 32);
+    uint32_t count = 0xF;
+    for (uint32_t probe = 0; probe < kDepth; ++probe) {
+      size_t index = CounterIndex(low, high, probe);
+      uint32_t counter = static_cast<uint32_t>(
+          (counters_[index >> 4] >> ((index & 15) << 2)) & 0xF);
+      count = std::min(count, counter);
+    }
+    return count + (doorkeeper_.Contains(hash) ? 1 : 0);
+  }
+
+  // Halves every counter and clears the doorkeeper.
+  void Reset() {
+    for (auto& word : counters_) {
+      word = (word >> 1) & 0x7777777777777777ULL;
+    }
+    doorkeeper_.Clear();
+    additions_ /= 2;
+  }
+
+ private:
+  static constexpr uint32_t kDepth = 4;
+
+  // Bloom filter with two probes from the hash's two 32-bit halves.
+  class Doorkeeper {
+   public:
+    explicit Doorkeeper(size_t words) : bits_(words) {}
+
+    // Returns true if hash was (probably) present already.
+    bool Put(uint64_t hash) {
+      bool present = true;
+      for (uint32_t probe = 0; probe < 2; ++probe) {
+        size_t bit = BitIndex(hash, probe);
+        uint64_t mask = uint64_t{1} << (bit & 63);
+        if ((bits_[bit >> 6] & mask) == 0) {
+          bits_[bit >> 6] |= mask;
+          present = false;
+        }
+      }
+      return present;
+    }
+
+    bool Contains(uint64_t hash) const {
+      for (uint32_t probe = 0; probe < 2; ++probe) {
+        size_t bit = BitIndex(hash, probe);
+        if ((bits_[bit >> 6] & (uint64_t{1} << (bit & 63))) == 0) {
+          return false;
+        }
+      }
+      return true;
+    }
+
+    void Clear() { std::fill(bits_.begin(), bits_.end(), 0); }
+
+   private:
+    size_t BitIndex(uint64_t hash, uint32_t probe) const {
+      uint32_t part = static_cast<uint32_t>(hash >> (probe * 32));
+      // Rotate so the bits differ from the ones the cache's table indexes by.
+      part = (part >> 17) | (part << 15);
+      return part & (bits_.size() * 64 - 1);
+    }
+
+    std::vector<uint64_t> bits_;
+  };
+
+  static size_t RoundUpToPowerOfTwo(size_t value) {
+    size_t result = 1;
+    while (result < value) {
+      result <<= 1;
+    }
+    return result;
+  }
+
+  // Double hashing: probe i uses low + i * high, over all counters.
+  size_t CounterIndex(uint32_t low, uint32_t high, uint32_t probe) const {
+    uint32_t mixed = low + probe * (high | 1);
+    mixed ^= mixed >> 15;
+    return mixed & (counters_.size() * 16 - 1);
+  }
+
+  std::vector<uint64_t> counters_;
+  Doorkeeper doorkeeper_;
+  size_t sample_size_;
+  size_t additions_;
+};
+
+}  // namespace cache
+}  // namespace side_effects
@@ -0,0 +1,93 @@
+/*
+ * Copyright (C) 2024  OverbearingPearl
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ * The above copyright notice and this permission notice shall be included in
+ * all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+ * THE SOFTWARE.
+ */
+
+#pragma once
+
+#include <cstdint>
+#include <functional>
+#include <list>
+#include <unordered_map>
+#include <utility>
+
+#include "src/side_effects/cache/pool_allocator.h"
+
+namespace side_effects {
+namespace cache {
+
+// Recently evicted keys, remembered by hash only (FlatTable::hash), for
+// policies that adapt when a key comes back soon after eviction. Oldest at
+// the back; every operation is O(1).
+class GhostList {
+ public:
+  // capacity is how many hashes the owner keeps at most; it sizes the
+  // node pools and the index up front. 0 if unknown.
+  explicit GhostList(size_t capacity = 0)
+      : order_(PoolAllocator<uint64_t>(capacity)),
+        index_(capacity, std::hash<uint64_t>(), std::equal_to<uint64_t>(),
+               order_.get_allocator()) {}
+
+  GhostList(const GhostList&) = delete;
+  GhostList& operator=(const GhostList&) = delete;
+
+  bool Contains(uint64_t hash) const { return index_.count(hash) != 0; }
+
+  // A hash that is already remembered moves to the front.
+  void Push(uint64_t hash) {
+    Erase(hash);
+    order_.push_front(hash);
+    index_[hash] = order_.begin();
+  }
+
+  bool Erase(uint64_t hash) {
+    auto entry = index_.find(hash);
+    if (entry == index_.end()) {
+      return false;
+    }
+    order_.erase(entry->second);
+    index_.erase(entry);
+    return true;
+  }
+
+  void PopBack() {
+    index_.erase(order_.back());
+    order_.pop_back();
+  }
+
+  size_t size() const { return order_.size(); }
+  bool empty() const { return order_.empty(); }
+
+  void clear() {
+    order_.clear();
+    index_.clear();
+  }
+
+ private:
+  using Order = std::list<uint64_t, PoolAllocator<uint64_t>>;
+  using Index = std::unordered_map<
+      uint64_t, Order::iterator, std::hash<uint64_t>, std::equal_to<uint64_t>,
+      PoolAllocator<std::pair<const uint64_t, Order::iterator>>>;
+
+  Order order_;  // Most recently evicted first.
+  Index index_;
+};
+
+}  // namespace cache
+}  // namespace side_effects
@@ -0,0 +1,252 @@
+/*
+ * Copyright (C) 2024  OverbearingPearl
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ * The above copyright notice and this permission notice shall be included in
+ * all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+ * THE SOFTWARE.
+ */
+
+#pragma once
+
+#include <algorithm>
+#include <cstddef>
+#include <list>
+#include <memory>
+#include <new>
+#include <type_traits>
+#include <vector>
+
+#include "src/side_effects/cache/flat_table.h"
+
+namespace side_effects {
+namespace cache {
+
+namespace internal {
+
+// Fixed-size blocks carved from slabs of slab_blocks blocks each. Freed
+// blocks are kept on a free list and handed out again before any new slab
+// is taken, so a population that stops growing stops allocating. Slabs are
+// only released with the pool.
+class NodePool {
+ public:
+  NodePool(size_t size, size_t align, size_t slab_blocks)
+      : block_size_(RoundUp(std::max(size, sizeof(FreeBlock)),
+                            std::max(align, alignof(FreeBlock)))),
+        align_(align),
+        slab_blocks_(slab_blocks),
+        free_(nullptr),
+        next_(nullptr),
+        end_(nullptr),
+        slabs_(nullptr) {}
+
+  NodePool(const NodePool&) = delete;
+  NodePool& operator=(const NodePool&) = delete;
+
+  ~NodePool() {
+    while (slabs_ != nullptr) {
+      Slab* next = slabs_->next;
+      ::operator delete(slabs_);
+      slabs_ = next;
+    }
+  }
+
+  void* Allocate() {
+    if (free_ != nullptr) {
+      FreeBlock* block = free_;
+      free_ = block->next;
+      return block;
+    }
+    if (next_ == end_) {
+      AddSlab();
+    }
+    void* block = next_;
+    next_ += block_size_;
+    return block;
+  }
+
+  void Deallocate(void* block) {
+    FreeBlock* freed = static_cast<FreeBlock*>(block);
+    freed->next = free_;
+    free_ = freed;
+  }
+
+  // Whether this pool serves objects of size and align.
+  bool Serves(size_t size, size_t align) const {
+    return align == align_ &&
+           block_size_ == RoundUp(std::max(size, sizeof(FreeBlock)),
+                                  std::max(align, alignof(FreeBlock)));
+  }
+
+ private:
+  struct FreeBlock {
+    FreeBlock* next;
+  };
+
+  // Header of each slab; the blocks follow it.
+  struct Slab {
+    Slab* next;
+  };
+
+  static size_t RoundUp(size_t size, size_t align) {
+    return (size + align - 1) / align * align;
+  }
+
+  void AddSlab() {
+    size_t header = RoundUp(sizeof(Slab), align_);
+    char* memory = static_cast<char*>(
+        ::operator new(header + block_size_ * slab_blocks_));
+    Slab* slab = reinterpret_cast<Slab*>(memory);
+    slab->next = slabs_;
+    slabs_ = slab;
+    next_ = memory + header;
+    end_ = next_ + block_size_ * slab_blocks_;
+  }
+
+  size_t block_size_;
+  size_t align_;
+  size_t slab_blocks_;
+  FreeBlock* free_;
+  char* next_;  // Unused part of the newest slab.
+  char* end_;
+  Slab* slabs_;
+};
+
+// The pools behind one family of PoolAllocators, one per node size.
+class NodePools {
+ public:
+  explicit NodePools(size_t slab_blocks) : slab_blocks_(slab_blocks) {}
+
+  NodePool* PoolFor(size_t size, size_t align) {
+    for (auto& pool : pools_) {
+      if (pool->Serves(size, align)) {
+        return pool.get();
+      }
+    }
+    pools_.emplace_back(new NodePool(size, align, slab_blocks_));
+    return pools_.back().get();
+  }
+
+  size_t slab_blocks() const { return slab_blocks_; }
+
+ private:
+  size_t slab_blocks_;
+  std::vector<std::unique_ptr<NodePool>> pools_;
+};
+
+}  // namespace internal
+
+// Allocator for the node-based containers inside policies. Single nodes come
+// from slabs sized to the expected number of nodes (a policy's capacity),
+// and freed nodes are reused, so a container whose size has levelled off,
+// as it does in a full cache, no longer touches the heap. Arrays, such as a
+// hash map's buckets, go to operator new.
+//
+// Copies share their pools, which lets a policy splice between containers
+// built from one allocator; a container copy-constructed from another gets
+// pools of its own. Like the policies, it is not thread-safe.
+template <typename T>
+class PoolAllocator {
+ public:
+  using value_type = T;
+  using propagate_on_container_move_assignment = std::true_type;
+  using propagate_on_container_swap = std::true_type;
+
+  template <typename U>
+  struct rebind {
+    using other = PoolAllocator<U>;
+  };
+
+  // expected_nodes of 0 means unknown.
+  explicit PoolAllocator(size_t expected_nodes = 0)
+      : pools_(std::make_shared<internal::NodePools>(
+            SlabBlocksFor(expected_nodes))),
+        pool_(nullptr) {}
+
+  // Declared so that moving an allocator copies it: a moved-from container
+  // must still be able to allocate.
+  PoolAllocator(const PoolAllocator& other) = default;
+
+  template <typename U>
+  PoolAllocator(const PoolAllocator<U>& other)
+      : pools_(other.pools_), pool_(nullptr) {}
+
+  T* allocate(size_t count) {
+    static_assert(alignof(T) <= alignof(std::max_align_t),
+                  "PoolAllocator does not over-align");
+    if (count != 1) {
+      return static_cast<T*>(::operator new(count * sizeof(T)));
+    }
+    return static_cast<T*>(Pool()->Allocate());
+  }
+
+  void deallocate(T* pointer, size_t count) {
+    if (count != 1) {
+      ::operator delete(pointer);
+    } else {
+      Pool()->Deallocate(pointer);
+    }
+  }
+
+  PoolAllocator select_on_container_copy_construction() const {
+    return PoolAllocator(pools_->slab_blocks());
+  }
+
+  template <typename U>
+  bool operator==(const PoolAllocator<U>& other) const {
+    return pools_ == other.pools_;
+  }
+
+  template <typename U>
+  bool operator!=(const PoolAllocator<U>& other) const {
+    return pools_ != other.pools_;
+  }
+
+ private:
+  template <typename U>
+  friend class PoolAllocator;
+
+  // Looked up on first use, so allocators that are only ever rebound, like
+  // the one a std::list is given, add no pool.
+  internal::NodePool* Pool() {
+    if (pool_ == nullptr) {
+      pool_ = pools_->PoolFor(sizeof(T), alignof(T));
+    }
+    return pool_;
+  }
+
+  static size_t SlabBlocksFor(size_t expected_nodes) {
+    if (expected_nodes == 0) {
+      return 256;
+    }
+    return std::min<size_t>(std::max<size_t>(expected_nodes, 16), 4096);
+  }
+
+  std::shared_ptr<internal::NodePools> pools_;
+  internal::NodePool* pool_;
+};
+
+// The slot lists policies keep their order in.
+using SlotList = std::list<SlotIndex, PoolAllocator<SlotIndex>>;
+
+// For a policy's copy constructor: an allocator with pools of its own,
+// sized like those of container.
+template <typename Container>
+typename Container::allocator_type SeparatePool(const Container& container) {
+  return container.get_allocator().select_on_container_copy_construction();
+}
+
+}  // namespace cache
+}  // namespace side_effects
@@ -0,0 +1,120 @@
+/*
+ * Copyright (C) 2024  OverbearingPearl
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ * The above copyright notice and this permission notice shall be included in
+ * all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+ * THE SOFTWARE.
+ */
+
+#pragma once
+
+#include <atomic>
+#include <cstddef>
+#include <cstdint>
+
+#include "src/side_effects/cache/flat_table.h"
+#include "src/side_effects/concurrency/striped.h"
+
+namespace side_effects {
+namespace cache {
+
+// Hits that readers served under a shared lock, kept until a writer holding
+// the exclusive lock applies them to the policy (see
+// Insertable::ReplayHit). Each thread records into one of several rings,
+// so readers do not contend. A ring that fills up before it is drained
+// overwrites its oldest hits: the policy's view of recency gets a little
+// less precise, but a reader never waits.
+class ReadBuffer {
+ public:
+  ReadBuffer() {
+    for (auto& ring : rings_) {
+      ring.counts.value.writes.store(0, std::memory_order_relaxed);
+      ring.counts.value.drained.store(0, std::memory_order_relaxed);
+    }
+  }
+
+  ReadBuffer(const ReadBuffer&) = delete;
+  ReadBuffer& operator=(const ReadBuffer&) = delete;
+
+  // Called with the lock held shared.
+  void Record(SlotIndex slot, uint64_t hash) {
+    Ring& ring = rings_[concurrency::internal::ThreadStripe<kStripes>()];
+    uint32_t position =
+        ring.counts.value.writes.fetch_add(1, std::memory_order_relaxed);
+    Hit& hit = ring.hits[position & (kRingSize - 1)];
+    hit.hash.store(hash, std::memory_order_relaxed);
+    hit.slot.store(slot, std::memory_order_relaxed);
+  }
+
+  // Whether the calling thread's ring has filled up since the last Drain,
+  // so further hits would overwrite undrained ones.
+  bool Full() const {
+    const Counts& counts =
+        rings_[concurrency::internal::ThreadStripe<kStripes>()].counts.value;
+    return counts.writes.load(std::memory_order_relaxed) -
+               counts.drained.load(std::memory_order_relaxed) >=
+           kRingSize;
+  }
+
+  // Calls replay(slot, hash) for each hit recorded since the last Drain
+  // and still held, oldest first within each ring. Called with the lock
+  // held exclusively, so no Record runs meanwhile.
+  template <typename Replay>
+  void Drain(Replay replay) {
+    for (auto& ring : rings_) {
+      Counts& counts = ring.counts.value;
+      uint32_t writes = counts.writes.load(std::memory_order_relaxed);
+      uint32_t pending =
+          writes - counts.drained.load(std::memory_order_relaxed);
+      if (pending > kRingSize) {
+        pending = kRingSize;
+      }
+      for (uint32_t position = writes - pending; position != writes;
+           ++position) {
+        const Hit& hit = ring.hits[position & (kRingSize - 1)];
+        replay(hit.slot.load(std::memory_order_relaxed),
+               hit.hash.load(std::memory_order_relaxed));
+      }
+      counts.drained.store(writes, std::memory_order_relaxed);
+    }
+  }
+
+ private:
+  static constexpr size_t kStripes = 16;
+  static constexpr uint32_t kRingSize = 32;  // A power of two.
+
+  struct Hit {
+    std::atomic<uint64_t> hash;
+    std::atomic<SlotIndex> slot;
+  };
+
+  struct Counts {
+    std::atomic<uint32_t> writes;
+    std::atomic<uint32_t> drained;
+  };
+
+  // The counters get a cache line of their own; the hits of one ring are
+  // only written by the threads of its stripe.
+  struct Ring {
+    concurrency::internal::Padded<Counts> counts;
+    Hit hits[kRingSize];
+  };
+
+  Ring rings_[kStripes];
+};
+
+}  // namespace cache
+}  // namespace side_effects
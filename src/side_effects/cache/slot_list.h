@@ -0,0 +1,109 @@
+/*
+ * Copyright (C) 2024  OverbearingPearl
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ * The above copyright notice and this permission notice shall be included in
+ * all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+ * THE SOFTWARE.
+ */
+
+#pragma once
+
+#include <cstddef>
+
+#include "src/side_effects/cache/flat_table.h"
+
+namespace side_effects {
+namespace cache {
+
+// Neighbours of a slot in an IntrusiveSlotList, kept in the slot's metadata.
+struct SlotLinks {
+  SlotIndex prev = kNoSlot;
+  SlotIndex next = kNoSlot;
+};
+
+// Doubly linked list of slots threaded through the cache itself: each
+// entry's metadata holds its SlotLinks as a member named links, so the list
+// allocates nothing, and relinking a slot only writes to its own entry and
+// its neighbours'. A slot is in at most one such list at a time.
+template <typename CacheType>
+class IntrusiveSlotList {
+ public:
+  IntrusiveSlotList() : head_(kNoSlot), tail_(kNoSlot), size_(0) {}
+
+  void PushFront(CacheType* cache, SlotIndex slot) {
+    SlotLinks& links = LinksOf(cache, slot);
+    links.prev = kNoSlot;
+    links.next = head_;
+    if (head_ != kNoSlot) {
+      LinksOf(cache, head_).prev = slot;
+    } else {
+      tail_ = slot;
+    }
+    head_ = slot;
+    ++size_;
+  }
+
+  void Remove(CacheType* cache, SlotIndex slot) {
+    SlotLinks& links = LinksOf(cache, slot);
+    if (links.prev != kNoSlot) {
+      LinksOf(cache, links.prev).next = links.next;
+    } else {
+      head_ = links.next;
+    }
+    if (links.next != kNoSlot) {
+      LinksOf(cache, links.next).prev = links.prev;
+    } else {
+      tail_ = links.prev;
+    }
+    links.prev = kNoSlot;
+    links.next = kNoSlot;
+    --size_;
+  }
+
+  void MoveToFront(CacheType* cache, SlotIndex slot) {
+    if (slot != head_) {
+      Remove(cache, slot);
+      PushFront(cache, slot);
+    }
+  }
+
+  // kNoSlot when empty.
+  SlotIndex front() const { return head_; }
+  SlotIndex back() const { return tail_; }
+
+  size_t size() const { return size_; }
+  bool empty() const { return size_ == 0; }
+
+  // Forgets every slot without touching the cache, for when the entries are
+  // gone (or about to be) anyway.
+  void clear() {
+    head_ = kNoSlot;
+    tail_ = kNoSlot;
+    size_ = 0;
+  }
+
+ private:
+  static SlotLinks& LinksOf(CacheType* cache, SlotIndex slot) {
+    return cache->metadata(slot).links;
+  }
+
+  SlotIndex head_;
+  SlotIndex tail_;
+  size_t size_;
+};
+
+}  // namespace cache
+}  // namespace side_effects
@@ -0,0 +1,92 @@
+/*
+ * Copyright (C) 2024  OverbearingPearl
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ * The above copyright notice and this permission notice shall be included in
+ * all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+ * THE SOFTWARE.
+ */
+
+#pragma once
+
+#include <cstddef>
+#include <functional>
+#include <string>
+#include <utility>
+#include <vector>
+
+namespace side_effects {
+namespace cache {
+
+// Weight of one cache entry, e.g. its size in bytes.
+template <typename KeyType, typename ValueType>
+using Weigher = std::function<size_t(const KeyType&, const ValueType&)>;
+
+// Capacity given as a total weight (see Weigher) rather than an entry count.
+struct WeightBudget {
+  explicit WeightBudget(size_t limit) : limit(limit) {}
+
+  size_t limit;
+};
+
+// Bytes a value owns on the heap, for SizeofWeigher. Overload it in the
+// namespace of your own types to have them weighed by more than their sizeof.
+template <typename T>
+size_t HeapBytes(const T&) {
+  return 0;
+}
+
+template <typename CharT, typename Traits, typename Allocator>
+size_t HeapBytes(const std::basic_string<CharT, Traits, Allocator>& value) {
+  return value.size() * sizeof(CharT);
+}
+
+template <typename T, typename Allocator>
+size_t HeapBytes(const std::vector<T, Allocator>& value) {
+  size_t bytes = value.size() * sizeof(T);
+  for (const auto& element : value) {
+    bytes += HeapBytes(element);
+  }
+  return bytes;
+}
+
+// Default weigher for a WeightBudget: the approximate bytes an entry takes,
+// sizeof key and value plus what the value owns on the heap.
+template <typename KeyType, typename ValueType>
+struct SizeofWeigher {
+  size_t operator()(const KeyType&, const ValueType& value) const {
+    return sizeof(KeyType) + sizeof(ValueType) + HeapBytes(value);
+  }
+};
+
+// Weighs entries with weigher, or as 1 each when it is empty, so a policy
+// bounded by an entry count and one bounded by a budget share the same code.
+template <typename KeyType, typename ValueType>
+class EntryWeigher {
+ public:
+  EntryWeigher() {}
+  explicit EntryWeigher(Weigher<KeyType, ValueType> weigher)
+      : weigher_(std::move(weigher)) {}
+
+  size_t operator()(const KeyType& key, const ValueType& value) const {
+    return weigher_ ? weigher_(key, value) : 1;
+  }
+
+ private:
+  Weigher<KeyType, ValueType> weigher_;
+};
+
+}  // namespace cache
+}  // namespace side_effects
@@ -0,0 +1,178 @@
+/*
+ * Copyright (C) 2024  OverbearingPearl
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ * The above copyright notice and this permission notice shall be included in
+ * all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+ * THE SOFTWARE.
+ */
+
+#pragma once
+
+#include <atomic>
+#include <cstddef>
+#include <cstdint>
+#include <thread>
+
+#include "src/side_effects/concurrency/striped.h"
+
+namespace side_effects {
+namespace concurrency {
+
+// Reader/writer spin lock (C++11 has no std::shared_mutex). Meant for short
+// critical sections such as a cache lookup: readers share the lock, and a
+// waiting writer blocks new readers so it cannot be starved.
+class SharedMutex {
+ public:
+  SharedMutex() : state_(0) {}
+
+  SharedMutex(const SharedMutex&) = delete;
+  SharedMutex& operator=(const SharedMutex&) = delete;
+
+  void lock() {
+    uint32_t state = state_.load(std::memory_order_relaxed);
+    while ((state & kWriter) != 0 ||
+           !state_.compare_exchange_weak(state, state | kWriter,
+                                         std::memory_order_acquire)) {
+      std::this_thread::yield();
+      state = state_.load(std::memory_order_relaxed);
+    }
+    while (state_.load(std::memory_order_acquire) != kWriter) {
+      std::this_thread::yield();
+    }
+  }
+
+  void unlock() { state_.fetch_and(~kWriter, std::memory_order_release); }
+
+  void lock_shared() {
+    uint32_t state = state_.load(std::memory_order_relaxed);
+    while ((state & kWriter) != 0 ||
+           !state_.compare_exchange_weak(state, state + kReader,
+                                         std::memory_order_acquire)) {
+      std::this_thread::yield();
+      state = state_.load(std::memory_order_relaxed);
+    }
+  }
+
+  void unlock_shared() {
+    state_.fetch_sub(kReader, std::memory_order_release);
+  }
+
+ private:
+  static constexpr uint32_t kWriter = 1;
+  static constexpr uint32_t kReader = 2;
+
+  std::atomic<uint32_t> state_;  // Reader count times kReader, plus kWriter.
+};
+
+// Reader/writer lock for data read far more often than it is written.
+// Each reader announces itself on one of several counters, picked per
+// thread and kept on separate cache lines, so while no writer is active a
+// shared lock is one uncontended atomic add and readers never touch each
+// other's lines. Writers serialize among themselves and then wait for every
+// counter to drain, which makes them slower than with SharedMutex; readers
+// step aside while a writer is waiting, so writers are not starved.
+class ReadMostlyMutex {
+ public:
+  ReadMostlyMutex() : writer_(false) {
+    for (auto& stripe : readers_) {
+      stripe.value.store(0, std::memory_order_relaxed);
+    }
+  }
+
+  ReadMostlyMutex(const ReadMostlyMutex&) = delete;
+  ReadMostlyMutex& operator=(const ReadMostlyMutex&) = delete;
+
+  void lock() {
+    bool expected = false;
+    while (!writer_.compare_exchange_weak(expected, true)) {
+      expected = false;
+      std::this_thread::yield();
+    }
+    WaitForReaders();
+  }
+
+  // Fails rather than wait, whether for another writer or for readers.
+  bool try_lock() {
+    bool expected = false;
+    if (!writer_.compare_exchange_strong(expected, true)) {
+      return false;
+    }
+    for (auto& stripe : readers_) {
+      if (stripe.value.load() != 0) {
+        writer_.store(false, std::memory_order_release);
+        return false;
+      }
+    }
+    return true;
+  }
+
+  void unlock() { writer_.store(false, std::memory_order_release); }
+
+  // The counter add and the writer check are sequentially consistent, as
+  // are the writer's flag and counter reads: either the writer sees this
+  // reader, or the reader sees the writer and backs off.
+  void lock_shared() {
+    std::atomic<uint32_t>& readers =
+        readers_[internal::ThreadStripe<kStripes>()].value;
+    for (;;) {
+      readers.fetch_add(1);
+      if (!writer_.load()) {
+        return;
+      }
+      readers.fetch_sub(1, std::memory_order_release);
+      while (writer_.load(std::memory_order_relaxed)) {
+        std::this_thread::yield();
+      }
+    }
+  }
+
+  void unlock_shared() {
+    readers_[internal::ThreadStripe<kStripes>()].value.fetch_sub(
+        1, std::memory_order_release);
+  }
+
+ private:
+  static constexpr size_t kStripes = 16;
+
+  void WaitForReaders() {
+    for (auto& stripe : readers_) {
+      while (stripe.value.load() != 0) {
+        std::this_thread::yield();
+      }
+    }
+  }
+
+  internal::Padded<std::atomic<uint32_t>> readers_[kStripes];
+  std::atomic<bool> writer_;
+};
+
+// Scoped shared ownership of a SharedMutex or ReadMostlyMutex, like C++14's
+// std::shared_lock.
+template <typename Mutex>
+class SharedLock {
+ public:
+  explicit SharedLock(Mutex& mutex) : mutex_(mutex) { mutex_.lock_shared(); }
+  ~SharedLock() { mutex_.unlock_shared(); }
+
+  SharedLock(const SharedLock&) = delete;
+  SharedLock& operator=(const SharedLock&) = delete;
+
+ private:
+  Mutex& mutex_;
+};
+
+}  // namespace concurrency
+}  // namespace side_effects
@@ -0,0 +1,58 @@
+/*
+ * Copyright (C) 2024  OverbearingPearl
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ * The above copyright notice and this permission notice shall be included in
+ * all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+ * THE SOFTWARE.
+ */
+
+#pragma once
+
+#include <atomic>
+#include <cstddef>
+
+namespace side_effects {
+namespace concurrency {
+namespace internal {
+
+// Size assumed for a cache line when keeping data apart.
+constexpr size_t kCacheLineSize = 64;
+
+// The calling thread's stripe out of Stripes. Threads are dealt stripes in
+// turn the first time they ask, then keep theirs, so structures split into
+// Stripes parts let each thread work on its own part most of the time.
+template <size_t Stripes>
+size_t ThreadStripe() {
+  static std::atomic<size_t> next_stripe(0);
+  static thread_local size_t stripe =
+      next_stripe.fetch_add(1, std::memory_order_relaxed) % Stripes;
+  return stripe;
+}
+
+// value followed by enough padding that, in an array of Padded, no two
+// values share a cache line. Padded rather than aligned, since C++11
+// operator new does not honour alignment beyond max_align_t.
+template <typename T>
+struct Padded {
+  static_assert(sizeof(T) < kCacheLineSize, "Padded needs a small T");
+
+  T value;
+  char padding[kCacheLineSize - sizeof(T)];
+};
+
+}  // namespace internal
+}  // namespace concurrency
+}  // namespace side_effects
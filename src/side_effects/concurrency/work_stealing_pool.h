@@ -0,0 +1,193 @@
+/*
+ * Copyright (C) 2024  OverbearingPearl
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ * The above copyright notice and this permission notice shall be included in
+ * all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+ * THE SOFTWARE.
+ */
+
+#pragma once
+
+#include <algorithm>
+#include <atomic>
+#include <condition_variable>
+#include <cstddef>
+#include <deque>
+#include <functional>
+#include <memory>
+#include <mutex>
+#include <thread>
+#include <utility>
+#include <vector>
+
+#include "src/side_effects/concurrency/executor.h"
+
+namespace side_effects {
+namespace concurrency {
+
+// Fixed set of worker threads, each with its own task deque. A worker runs
+// its newest task first (LIFO, warm caches) and, when it has none, steals
+// the oldest task of another worker. Tasks submitted from a worker go to its
+// own deque; others are dealt round-robin.
+//
+// Tasks must not throw. The destructor runs every queued task before it
+// joins the workers.
+class WorkStealingPool {
+ public:
+  explicit WorkStealingPool(size_t threads = DefaultThreadCount())
+      : queues_(std::max<size_t>(threads, 1)),
+        pending_(0),
+        next_queue_(0),
+        stopping_(false) {
+    for (auto& queue : queues_) {
+      queue.reset(new Queue());
+    }
+    for (size_t index = 0; index < queues_.size(); ++index) {
+      workers_.emplace_back(&WorkStealingPool::Work, this, index);
+    }
+  }
+
+  WorkStealingPool(const WorkStealingPool&) = delete;
+  WorkStealingPool& operator=(const WorkStealingPool&) = delete;
+
+  ~WorkStealingPool() {
+    {
+      std::lock_guard<std::mutex> lock(mutex_);
+      stopping_ = true;
+    }
+    wake_.notify_all();
+    for (auto& worker : workers_) {
+      worker.join();
+    }
+  }
+
+  // Process-wide pool with DefaultThreadCount workers, started on first use.
+  static WorkStealingPool& Default() {
+    static WorkStealingPool pool;
+    return pool;
+  }
+
+  static size_t DefaultThreadCount() {
+    return std::max(1u, std::thread::hardware_concurrency());
+  }
+
+  void Submit(std::function<void()> task) {
+    size_t index = WorkerIndex();
+    if (index == kNotAWorker) {
+      index = next_queue_.fetch_add(1, std::memory_order_relaxed) %
+              queues_.size();
+    }
+    // Counted before it is queued, so pending_ never drops below the number
+    // of queued tasks; a worker that wakes early just retries.
+    {
+      std::lock_guard<std::mutex> lock(mutex_);
+      ++pending_;
+    }
+    {
+      std::lock_guard<std::mutex> lock(queues_[index]->mutex);
+      queues_[index]->tasks.push_back(std::move(task));
+    }
+    wake_.notify_one();
+  }
+
+  // This pool as an Executor. The pool must outlive every use of it.
+  Executor AsExecutor() {
+    return [this](std::function<void()> task) { Submit(std::move(task)); };
+  }
+
+  size_t ThreadCount() const { return workers_.size(); }
+
+ private:
+  static constexpr size_t kNotAWorker = static_cast<size_t>(-1);
+
+  struct Queue {
+    std::mutex mutex;
+    std::deque<std::function<void()>> tasks;
+  };
+
+  struct Worker {
+    const WorkStealingPool* pool;
+    size_t index;
+  };
+
+  static Worker& CurrentWorker() {
+    static thread_local Worker worker = {nullptr, kNotAWorker};
+    return worker;
+  }
+
+  // The calling thread's queue if it is one of this pool's workers.
+  size_t WorkerIndex() const {
+    const Worker& worker = CurrentWorker();
+    if (worker.pool != this) {
+      return kNotAWorker;
+    }
+    return worker.index;
+  }
+
+  // Own deque from the back, then the others from the front.
+  bool TryTake(size_t self, std::function<void()>* task) {
+    for (size_t offset = 0; offset < queues_.size(); ++offset) {
+      Queue& queue = *queues_[(self + offset) % queues_.size()];
+      std::lock_guard<std::mutex> lock(queue.mutex);
+      if (queue.tasks.empty()) {
+        continue;
+      }
+      if (offset == 0) {
+        *task = std::move(queue.tasks.back());
+        queue.tasks.pop_back();
+      } else {
+        *task = std::move(queue.tasks.front());
+        queue.tasks.pop_front();
+      }
+      return true;
+    }
+    return false;
+  }
+
+  void Work(size_t index) {
+    CurrentWorker() = Worker{this, index};
+    std::function<void()> task;
+    while (true) {
+      if (TryTake(index, &task)) {
+        {
+          std::lock_guard<std::mutex> lock(mutex_);
+          --pending_;
+        }
+        task();
+        task = nullptr;
+        continue;
+      }
+      std::unique_lock<std::mutex> lock(mutex_);
+      if (pending_ == 0) {
+        if (stopping_) {
+          return;
+        }
+        wake_.wait(lock, [this]() { return pending_ != 0 || stopping_; });
+      }
+    }
+  }
+
+  std::vector<std::unique_ptr<Queue>> queues_;
+  std::vector<std::thread> workers_;
+  std::mutex mutex_;  // Guards pending_ and stopping_.
+  std::condition_variable wake_;
+  size_t pending_;  // Submitted tasks not yet taken.
+  std::atomic<size_t> next_queue_;
+  bool stopping_;
+};
+
+}  // namespace concurrency
+}  // namespace side_effects
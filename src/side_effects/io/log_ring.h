@@ -0,0 +1,192 @@
+/*
+ * Copyright (C) 2024  OverbearingPearl
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ * The above copyright notice and this permission notice shall be included in
+ * all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+ * THE SOFTWARE.
+ */
+
+#pragma once
+
+#include <atomic>
+#include <cstddef>
+#include <cstdint>
+#include <new>
+#include <ostream>
+#include <sstream>
+#include <string>
+#include <tuple>
+#include <type_traits>
+#include <utility>
+
+namespace side_effects {
+namespace io {
+
+enum class LogLevel { kDebug, kInfo, kWarning, kError };
+
+// How a logged argument is captured until the writer formats it: by value,
+// except C strings, which are copied since the caller's buffer may not
+// outlive the record.
+template <typename T>
+struct LogCapture {
+  using type = typename std::decay<T>::type;
+};
+
+template <>
+struct LogCapture<char*> {
+  using type = std::string;
+};
+
+template <>
+struct LogCapture<const char*> {
+  using type = std::string;
+};
+
+template <typename... Args>
+using LogArgs =
+    std::tuple<typename LogCapture<typename std::decay<Args>::type>::type...>;
+
+template <size_t Index, size_t Size>
+struct LogArgsWriter {
+  template <typename Tuple>
+  static void Write(const Tuple& args, std::ostream& out) {
+    out << std::get<Index>(args);
+    LogArgsWriter<Index + 1, Size>::Write(args, out);
+  }
+};
+
+template <size_t Size>
+struct LogArgsWriter<Size, Size> {
+  template <typename Tuple>
+  static void Write(const Tuple& /*args*/, std::ostream& /*out*/) {}
+};
+
+// One log call whose arguments have been captured but not yet formatted.
+// render streams them to out, or only destroys them when out is null.
+struct LogRecord {
+  static constexpr size_t kArgsSize = 96;
+
+  using Render = void (*)(void* args, std::ostream* out);
+
+  LogLevel level;
+  Render render;
+  typename std::aligned_storage<kArgsSize>::type args;
+};
+
+template <typename Tuple>
+void RenderLogArgs(void* storage, std::ostream* out) {
+  Tuple* args = static_cast<Tuple*>(storage);
+  if (out != nullptr) {
+    LogArgsWriter<0, std::tuple_size<Tuple>::value>::Write(*args, *out);
+  }
+  args->~Tuple();
+}
+
+// Single-producer, single-consumer queue of LogRecords. The owning thread
+// pushes and the log writer pops; neither takes a lock.
+class LogRing {
+ public:
+  static constexpr size_t kSlots = 256;
+
+  LogRing() : head_(0), tail_(0), abandoned_(false) {}
+
+  LogRing(const LogRing&) = delete;
+  LogRing& operator=(const LogRing&) = delete;
+
+  ~LogRing() {
+    while (Front() != nullptr) {
+      Pop(nullptr);
+    }
+  }
+
+  // Captures args into the next free slot, or returns false without
+  // touching them when the ring is full. Arguments too large for a slot are
+  // formatted here instead, and the resulting string is queued.
+  template <typename... Args>
+  bool TryPush(LogLevel level, Args&&... args) {
+    uint64_t tail = tail_.load(std::memory_order_relaxed);
+    if (tail - head_.load(std::memory_order_acquire) == kSlots) {
+      return false;
+    }
+    LogRecord& record = slots_[tail % kSlots];
+    record.level = level;
+    Capture(&record, FitsInRecord<LogArgs<Args...>>(),
+            std::forward<Args>(args)...);
+    tail_.store(tail + 1, std::memory_order_release);
+    return true;
+  }
+
+  // The oldest record, or nullptr when the ring is empty. Consumer only.
+  const LogRecord* Front() const {
+    uint64_t head = head_.load(std::memory_order_relaxed);
+    if (head == tail_.load(std::memory_order_acquire)) {
+      return nullptr;
+    }
+    return &slots_[head % kSlots];
+  }
+
+  // Formats the record Front returned into out (or discards it when out is
+  // null) and frees its slot.
+  void Pop(std::ostream* out) {
+    uint64_t head = head_.load(std::memory_order_relaxed);
+    LogRecord& record = slots_[head % kSlots];
+    record.render(&record.args, out);
+    head_.store(head + 1, std::memory_order_release);
+  }
+
+  bool Empty() const {
+    return head_.load(std::memory_order_acquire) ==
+           tail_.load(std::memory_order_acquire);
+  }
+
+  // Set when the owning thread exits; the writer drops the ring once it has
+  // drained it.
+  void Abandon() { abandoned_.store(true, std::memory_order_release); }
+  bool Abandoned() const { return abandoned_.load(std::memory_order_acquire); }
+
+ private:
+  template <typename Tuple>
+  using FitsInRecord = std::integral_constant<
+      bool, sizeof(Tuple) <= LogRecord::kArgsSize &&
+                alignof(Tuple) <= alignof(decltype(LogRecord::args))>;
+
+  template <typename... Args>
+  static void Capture(LogRecord* record, std::true_type, Args&&... args) {
+    using Tuple = LogArgs<Args...>;
+    new (&record->args) Tuple(std::forward<Args>(args)...);
+    record->render = &RenderLogArgs<Tuple>;
+  }
+
+  template <typename... Args>
+  static void Capture(LogRecord* record, std::false_type, Args&&... args) {
+    std::ostringstream out;
+    LogArgs<Args...> captured(std::forward<Args>(args)...);
+    LogArgsWriter<0, sizeof...(Args)>::Write(captured, out);
+    Capture(record, std::true_type(), out.str());
+  }
+
+  // Padding keeps the consumer's and producer's positions on separate cache
+  // lines (C++11 operator new does not honour alignas beyond max_align_t).
+  std::atomic<uint64_t> head_;
+  char head_padding_[64 - sizeof(std::atomic<uint64_t>)];
+  std::atomic<uint64_t> tail_;
+  char tail_padding_[64 - sizeof(std::atomic<uint64_t>)];
+  std::atomic<bool> abandoned_;
+  LogRecord slots_[kSlots];
+};
+
+}  // namespace io
+}  // namespace side_effects
@@ -21,30 +21,329 @@
 
 #pragma once
 
-#include <iostream>
+#include <algorithm>
+#include <atomic>
+#include <cerrno>
+#include <chrono>
+#include <condition_variable>
+#include <cstdint>
+#include <memory>
+#include <mutex>
 #include <sstream>
+#include <string>
+#include <thread>
+#include <tuple>
 #include <utility>
+#include <vector>
 
-template <typename T>
-void log_helper(std::ostringstream& oss, T&& arg) {
-  oss << std::forward<T>(arg);
-}
+#ifdef PLATFORM_WINDOWS
+#include <io.h>
+#else
+#include <unistd.h>
+#endif
+
+#include "src/side_effects/concurrency/striped.h"
+#include "src/side_effects/io/log_ring.h"
+
+// Lowest severity compiled in, as the numeric value of a LogLevel. Calls
+// below it expand to nothing, so their arguments are never evaluated.
+#define LOG_LEVEL_DEBUG 0
+#define LOG_LEVEL_INFO 1
+#define LOG_LEVEL_WARNING 2
+#define LOG_LEVEL_ERROR 3
+
+#ifndef LOGGING_MIN_LEVEL
+#define LOGGING_MIN_LEVEL LOG_LEVEL_INFO
+#endif
 
-template <typename T, typename... Args>
-void log_helper(std::ostringstream& oss, T&& arg, Args&&... args) {
-  oss << std::forward<T>(arg);
-  log_helper(oss, std::forward<Args>(args)...);
+namespace side_effects {
+namespace io {
+
+// Whether LOG_* calls at level are compiled in.
+constexpr bool LogLevelEnabled(LogLevel level) {
+#ifdef LOGGING_ENABLED
+  return static_cast<int>(level) >= LOGGING_MIN_LEVEL;
+#else
+  return false;
+#endif
 }
 
-template <typename... Args>
-void log_impl(Args&&... args) {
-  std::ostringstream oss;
-  log_helper(oss, std::forward<Args>(args)...);
-  std::cout << oss.str() << std::endl;
+inline const char* LogLevelName(LogLevel level) {
+  switch (level) {
+    case LogLevel::kDebug:
+      return "DEBUG";
+    case LogLevel::kInfo:
+      return "INFO";
+    case LogLevel::kWarning:
+      return "WARNING";
+    case LogLevel::kError:
+      return "ERROR";
+  }
+  return "";
 }
 
-#ifdef LOGGING_ENABLED
-#define LOG(...) log_impl(__VA_ARGS__)
+// Asynchronous logger. A call captures its arguments into the calling
+// thread's LogRing and returns; a background thread formats the records and
+// writes them to a file descriptor in batches. Lines from one thread keep
+// their order, lines from different threads may interleave.
+//
+// Once the logger has been destroyed at exit, calls that still come in
+// (from later static destructors or threads still running) write their
+// line directly instead. The destructor waits for calls already past that
+// check, so none of them queues a line after the last drain.
+class Logger {
+ public:
+  static Logger& Instance() {
+    static Logger logger;
+    return logger;
+  }
+
+  Logger(const Logger&) = delete;
+  Logger& operator=(const Logger&) = delete;
+
+  // Drains every ring before the writer stops.
+  ~Logger() {
+    {
+      std::lock_guard<std::mutex> lock(mutex_);
+      ClosedFd().store(fd_, std::memory_order_relaxed);
+    }
+    Closed().store(true);
+    // The writer keeps draining meanwhile, so a call waiting on a full
+    // ring gets through.
+    for (size_t stripe = 0; stripe < kCallStripes; ++stripe) {
+      while (ActiveCalls()[stripe].value.load() != 0) {
+        std::this_thread::yield();
+      }
+    }
+    {
+      std::lock_guard<std::mutex> lock(mutex_);
+      stopping_ = true;
+    }
+    wake_.notify_one();
+    writer_.join();
+  }
+
+  // Queues one line made of args streamed in order. When this thread's ring
+  // is full, waits for the writer to catch up rather than drop the line.
+  template <typename... Args>
+  void Log(LogLevel level, Args&&... args) {
+    // Only statics are touched until the logger is known to be alive. The
+    // call announces itself before checking, as a reader of
+    // concurrency::ReadMostlyMutex does: either the destructor sees it and
+    // waits, or it sees the logger closed.
+    ActiveCall call;
+    if (Closed().load()) {
+      WriteNow(level, std::forward<Args>(args)...);
+      return;
+    }
+    LogRing& ring = LocalRing();
+    while (!ring.TryPush(level, std::forward<Args>(args)...)) {
+      wake_.notify_one();
+      std::this_thread::yield();
+    }
+  }
+
+  // Returns once everything logged before the call has been written.
+  void Flush() {
+    std::unique_lock<std::mutex> lock(mutex_);
+    uint64_t target = ++flush_requested_;
+    wake_.notify_one();
+    flushed_cv_.wait(lock, [this, target]() { return flushed_ >= target; });
+  }
+
+  // Sends later output to fd (1, standard output, by default). Pending
+  // lines are flushed to the previous descriptor first; the caller keeps
+  // ownership of both.
+  void SetOutput(int fd) {
+    Flush();
+    std::lock_guard<std::mutex> lock(mutex_);
+    fd_ = fd;
+  }
+
+ private:
+  // Keeps the calling thread's ring registered with the logger, and marks
+  // it abandoned when the thread exits.
+  class RingHandle {
+   public:
+    explicit RingHandle(Logger* logger) : ring_(std::make_shared<LogRing>()) {
+      std::lock_guard<std::mutex> lock(logger->mutex_);
+      logger->rings_.push_back(ring_);
+    }
+
+    ~RingHandle() { ring_->Abandon(); }
+
+    LogRing& ring() { return *ring_; }
+
+   private:
+    std::shared_ptr<LogRing> ring_;
+  };
+
+  Logger()
+      : fd_(1),
+        stopping_(false),
+        flush_requested_(0),
+        flushed_(0),
+        writer_(&Logger::Write, this) {}
+
+  static constexpr size_t kCallStripes = 16;
+
+  using CallCounter = concurrency::internal::Padded<std::atomic<uint32_t>>;
+
+  // Marks a Log call in progress for its lifetime, on one of
+  // ActiveCalls()'s counters.
+  class ActiveCall {
+   public:
+    ActiveCall()
+        : calls_(ActiveCalls()[concurrency::internal::ThreadStripe<
+                                   kCallStripes>()]
+                     .value) {
+      calls_.fetch_add(1);
+    }
+
+    ~ActiveCall() { calls_.fetch_sub(1, std::memory_order_release); }
+
+    ActiveCall(const ActiveCall&) = delete;
+    ActiveCall& operator=(const ActiveCall&) = delete;
+
+   private:
+    std::atomic<uint32_t>& calls_;
+  };
+
+  // Log calls in progress, split as in concurrency::ReadMostlyMutex.
+  static CallCounter* ActiveCalls() {
+    static CallCounter calls[kCallStripes];
+    return calls;
+  }
+
+  // Set by the destructor, with the descriptor in use then. These and
+  // ActiveCalls() are trivially destructible statics, so they can still be
+  // read after the Logger itself is gone.
+  static std::atomic<bool>& Closed() {
+    static std::atomic<bool> closed(false);
+    return closed;
+  }
+
+  static std::atomic<int>& ClosedFd() {
+    static std::atomic<int> fd(1);
+    return fd;
+  }
+
+  // Formats and writes one line on the calling thread, once the writer is
+  // gone.
+  template <typename... Args>
+  static void WriteNow(LogLevel level, Args&&... args) {
+    std::ostringstream line;
+    line << '[' << LogLevelName(level) << "] ";
+    LogArgsWriter<0, sizeof...(Args)>::Write(std::forward_as_tuple(args...),
+                                             line);
+    line << '\n';
+    WriteAll(ClosedFd().load(std::memory_order_relaxed), line.str());
+  }
+
+  LogRing& LocalRing() {
+    static thread_local RingHandle handle(this);
+    return handle.ring();
+  }
+
+  void Write() {
+    std::ostringstream batch;
+    std::unique_lock<std::mutex> lock(mutex_);
+    while (true) {
+      uint64_t target = flush_requested_;
+      bool stopping = stopping_;
+      std::vector<std::shared_ptr<LogRing>> rings = rings_;
+      int fd = fd_;
+      lock.unlock();
+
+      for (const auto& ring : rings) {
+        while (const LogRecord* record = ring->Front()) {
+          batch << '[' << LogLevelName(record->level) << "] ";
+          ring->Pop(&batch);
+          batch << '\n';
+        }
+      }
+      std::string text = batch.str();
+      batch.str(std::string());
+      WriteAll(fd, text);
+
+      lock.lock();
+      rings_.erase(std::remove_if(rings_.begin(), rings_.end(),
+                                  [](const std::shared_ptr<LogRing>& ring) {
+                                    return ring->Abandoned() && ring->Empty();
+                                  }),
+                   rings_.end());
+      flushed_ = target;
+      flushed_cv_.notify_all();
+      if (stopping) {
+        return;
+      }
+      if (flush_requested_ == target && !stopping_) {
+        wake_.wait_for(lock, std::chrono::milliseconds(50));
+      }
+    }
+  }
+
+  static void WriteAll(int fd, const std::string& text) {
+    const char* data = text.data();
+    size_t left = text.size();
+    while (left > 0) {
+#ifdef PLATFORM_WINDOWS
+      int written = _write(fd, data, static_cast<unsigned int>(left));
+#else
+      ssize_t written = ::write(fd, data, left);
+#endif
+      if (written < 0 && errno == EINTR) {
+        continue;
+      }
+      if (written <= 0) {
+        return;
+      }
+      data += written;
+      left -= static_cast<size_t>(written);
+    }
+  }
+
+  std::mutex mutex_;  // Guards everything below except writer_.
+  std::condition_variable wake_;
+  std::condition_variable flushed_cv_;
+  std::vector<std::shared_ptr<LogRing>> rings_;
+  int fd_;
+  bool stopping_;
+  uint64_t flush_requested_;
+  uint64_t flushed_;
+  std::thread writer_;
+};
+
+}  // namespace io
+}  // namespace side_effects
+
+#define LOG_AT(level, ...) \
+  ::side_effects::io::Logger::Instance().Log(level, __VA_ARGS__)
+
+#if defined(LOGGING_ENABLED) && LOGGING_MIN_LEVEL <= LOG_LEVEL_DEBUG
+#define LOG_DEBUG(...) LOG_AT(::side_effects::io::LogLevel::kDebug, __VA_ARGS__)
 #else
-#define LOG(...)
+#define LOG_DEBUG(...) static_cast<void>(0)
 #endif
+
+#if defined(LOGGING_ENABLED) && LOGGING_MIN_LEVEL <= LOG_LEVEL_INFO
+#define LOG_INFO(...) LOG_AT(::side_effects::io::LogLevel::kInfo, __VA_ARGS__)
+#else
+#define LOG_INFO(...) static_cast<void>(0)
+#endif
+
+#if defined(LOGGING_ENABLED) && LOGGING_MIN_LEVEL <= LOG_LEVEL_WARNING
+#define LOG_WARNING(...) \
+  LOG_AT(::side_effects::io::LogLevel::kWarning, __VA_ARGS__)
+#else
+#define LOG_WARNING(...) static_cast<void>(0)
+#endif
+
+#if defined(LOGGING_ENABLED) && LOGGING_MIN_LEVEL <= LOG_LEVEL_ERROR
+#define LOG_ERROR(...) LOG_AT(::side_effects::io::LogLevel::kError, __VA_ARGS__)
+#else
+#define LOG_ERROR(...) static_cast<void>(0)
+#endif
+
+// Kept for existing callers; logs at INFO.
+#define LOG(...) LOG_INFO(__VA_ARGS__)
@@ -0,0 +1,424 @@
+/*
+ * Copyright (C) 2024  OverbearingPearl
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ * The above copyright notice and this permission notice shall be included in
+ * all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+ * THE SOFTWARE.
+ */
+
+#pragma once
+
+#include <atomic>
+#include <cstddef>
+#include <cstdint>
+#include <exception>
+#include <future>
+#include <mutex>
+#include <new>
+#include <stdexcept>
+#include <thread>
+#include <tuple>
+#include <type_traits>
+#include <unordered_map>
+#include <utility>
+#include <vector>
+
+#include "src/side_effects/cache/cache_stats.h"
+#include "src/side_effects/concurrency/executor.h"
+#include "src/side_effects/io/logging.h"
+#include "src/side_effects/memoization/latency_histogram.h"
+#include "src/utils/immutable/tuple.h"
+
+namespace side_effects {
+namespace memoization {
+
+// Declares that an argument of integral or enum type Key only takes values
+// in [Min, Max].
+template <typename Key, Key Min, Key Max>
+struct DenseRange {
+  static_assert(std::is_integral<Key>::value || std::is_enum<Key>::value,
+                "DenseRange needs an integral or enum key");
+  static_assert(!(Max < Min), "DenseRange is empty");
+
+  using KeyType = Key;
+
+  static constexpr size_t kSize =
+      static_cast<size_t>(static_cast<intmax_t>(Max) -
+                          static_cast<intmax_t>(Min)) +
+      1;
+
+  // value's position in the range, or kSize if it falls outside.
+  template <typename Arg>
+  static size_t Offset(const Arg& arg) {
+    intmax_t offset =
+        static_cast<intmax_t>(arg) - static_cast<intmax_t>(Min);
+    return offset < 0 || static_cast<uintmax_t>(offset) >= kSize
+               ? kSize
+               : static_cast<size_t>(offset);
+  }
+};
+
+template <typename Key, Key Min, Key Max>
+constexpr size_t DenseRange<Key, Min, Max>::kSize;
+
+// Passed to Memoization::Memoize or MemoizeRecursive in place of a cache
+// policy, with one DenseRange per argument, it stores every result in a
+// DenseTable instead of a MemoTable.
+template <typename... Ranges>
+struct DenseBounds {};
+
+// Specialize with a `type` naming the DenseRange of a key type whose values
+// are always few, e.g. an enum:
+//
+//   template <>
+//   struct DenseKeyRange<Color> {
+//     using type = DenseRange<Color, Color::kRed, Color::kBlue>;
+//   };
+//
+// Memoize then picks a DenseTable for functions taking only such types.
+template <typename Key>
+struct DenseKeyRange {};
+
+template <>
+struct DenseKeyRange<bool> {
+  using type = DenseRange<bool, false, true>;
+};
+
+namespace internal {
+
+template <typename T>
+struct Void {
+  using type = void;
+};
+
+template <typename Key, typename = void>
+struct HasDenseKeyRange : std::false_type {};
+
+template <typename Key>
+struct HasDenseKeyRange<Key, typename Void<typename DenseKeyRange<
+                                 Key>::type>::type> : std::true_type {};
+
+// Whether every element type of KeyTuple, of which there is at least one,
+// has a DenseKeyRange.
+template <typename KeyTuple>
+struct AllDenseKeys;
+
+template <>
+struct AllDenseKeys<std::tuple<>> : std::false_type {};
+
+template <typename Key>
+struct AllDenseKeys<std::tuple<Key>> : HasDenseKeyRange<Key> {};
+
+template <typename Key, typename Next, typename... Keys>
+struct AllDenseKeys<std::tuple<Key, Next, Keys...>>
+    : std::integral_constant<
+          bool, HasDenseKeyRange<Key>::value &&
+                    AllDenseKeys<std::tuple<Next, Keys...>>::value> {};
+
+// Row-major position of a tuple of arguments in the product of Ranges.
+template <typename... Ranges>
+struct DenseIndexer {
+  static constexpr size_t kSize = 1;
+
+  static bool Index(size_t* /*index*/) { return true; }
+};
+
+template <typename... Ranges>
+constexpr size_t DenseIndexer<Ranges...>::kSize;
+
+template <typename Range, typename... Ranges>
+struct DenseIndexer<Range, Ranges...> {
+  static constexpr size_t kSize =
+      Range::kSize * DenseIndexer<Ranges...>::kSize;
+
+  template <typename Arg, typename... Args>
+  static bool Index(size_t* index, const Arg& arg, const Args&... args) {
+    size_t offset = Range::Offset(arg);
+    if (offset == Range::kSize) {
+      return false;
+    }
+    *index = *index * Range::kSize + offset;
+    return DenseIndexer<Ranges...>::Index(index, args...);
+  }
+};
+
+template <typename Range, typename... Ranges>
+constexpr size_t DenseIndexer<Range, Ranges...>::kSize;
+
+}  // namespace internal
+
+// Memo table for arguments confined to small ranges: one cell per possible
+// argument tuple, holding a ready flag and the value inline, so a hit is an
+// index computation and one load. Cells are never evicted, and all of them
+// are allocated up front, so the product of the ranges must stay small.
+//
+// Misses follow MemoTable::GetOrCompute: compute runs without the lock,
+// concurrent misses on one cell share a single computation, an exception
+// reaches every waiter without being cached, and a computation that
+// depends on itself throws std::logic_error. Stats, load latency and
+// batches mirror MemoTable's too, so Memoize's result offers the same
+// calls whichever table it picked.
+template <typename ValueType, typename... Ranges>
+class DenseTable {
+  using Indexer = internal::DenseIndexer<Ranges...>;
+
+ public:
+  using KeyType = std::tuple<typename Ranges::KeyType...>;
+
+  explicit DenseTable(DenseBounds<Ranges...> = DenseBounds<Ranges...>())
+      : size_(0) {}
+
+  DenseTable(const DenseTable&) = delete;
+  DenseTable& operator=(const DenseTable&) = delete;
+
+  ~DenseTable() {
+    for (auto& cell : cells_) {
+      if (cell.ready.load(std::memory_order_relaxed)) {
+        cell.value().~ValueType();
+      }
+    }
+  }
+
+  // Cell of the arguments, one per range. Throws std::out_of_range if one
+  // falls outside its range.
+  template <typename... Args>
+  static size_t IndexOf(const Args&... args) {
+    static_assert(sizeof...(Args) == sizeof...(Ranges),
+                  "DenseTable needs one argument per range");
+    size_t index = 0;
+    if (!Indexer::Index(&index, args...)) {
+      throw std::out_of_range("Argument outside its DenseRange");
+    }
+    return index;
+  }
+
+  // The value in cell index, or nullptr if it has not been computed. Safe
+  // to call from any thread at any time; a value found counts as a hit.
+  const ValueType* Find(size_t index) {
+    const ValueType* cached = Peek(index);
+    if (cached != nullptr) {
+      hits_.Add();
+    }
+    return cached;
+  }
+
+  // Fills cell index with compute() unless another caller got there first.
+  // Counts a miss either way, as joining a computation does in MemoTable.
+  template <typename Compute>
+  ValueType Load(size_t index, Compute compute) {
+    misses_.Add();
+    std::unique_lock<std::mutex> lock(mutex_);
+    const ValueType* cached = Peek(index);
+    if (cached != nullptr) {
+      return *cached;
+    }
+    auto flight = in_flight_.find(index);
+    if (flight != in_flight_.end()) {
+      if (flight->second.owner == std::this_thread::get_id()) {
+        throw std::logic_error("Memoized function depends on itself");
+      }
+      std::shared_future<void> pending = flight->second.future;
+      lock.unlock();
+      pending.get();
+      return *Peek(index);
+    }
+    std::promise<void> promise;
+    in_flight_.emplace(index, Flight(promise.get_future().share()));
+    lock.unlock();
+
+    bool computed = false;
+    LoadRecorder::Clock::time_point start = LoadRecorder::Clock::now();
+    try {
+      ValueType result = compute();
+      computed = true;
+      loads_.Record(start, true);
+      lock.lock();
+      Cell& cell = cells_[index];
+      new (&cell.storage) ValueType(result);
+      cell.ready.store(true, std::memory_order_release);
+      ++size_;
+      inserts_.Add();
+      in_flight_.erase(index);
+      lock.unlock();
+      promise.set_value();
+      return result;
+    } catch (...) {
+      if (!computed) {
+        loads_.Record(start, false);
+      }
+      if (!lock.owns_lock()) {
+        lock.lock();
+      }
+      in_flight_.erase(index);
+      lock.unlock();
+      promise.set_exception(std::current_exception());
+      throw;
+    }
+  }
+
+  // MemoTable's interface, for internal::RecursiveBody.
+  template <typename Probe, typename Compute>
+  ValueType GetOrCompute(const Probe& probe, Compute compute) {
+    size_t index = IndexOfTuple(
+        probe, typename utils::immutable::MakeIndexSequence<
+                   sizeof...(Ranges)>::type());
+    const ValueType* cached = Find(index);
+    return cached != nullptr ? *cached : Load(index, compute);
+  }
+
+  // MemoTable::GetOrComputeBatch for a table whose cells never move: each
+  // missing cell is filled by Load, on executor when one is given, and the
+  // results are read back from the cells. A key compute needs before the
+  // batch reaches it is simply loaded by that call. Keys are tuples of
+  // arguments; one outside its range throws std::out_of_range before
+  // anything is computed. If computations throw, the cells that did fill
+  // keep their values and the exception of the earliest failing key is
+  // rethrown.
+  template <typename Key, typename Compute>
+  std::vector<ValueType> GetOrComputeBatch(
+      const std::vector<Key>& keys, Compute compute,
+      const concurrency::Executor& executor = concurrency::Executor()) {
+    std::vector<size_t> indices;
+    indices.reserve(keys.size());
+    for (const auto& key : keys) {
+      indices.push_back(IndexOfTuple(
+          key, typename utils::immutable::MakeIndexSequence<
+                   sizeof...(Ranges)>::type()));
+    }
+    std::vector<size_t> misses;
+    for (size_t position = 0; position < keys.size(); ++position) {
+      if (Find(indices[position]) == nullptr) {
+        misses.push_back(position);
+      }
+    }
+    std::vector<std::exception_ptr> errors(keys.size());
+    auto load = [&](size_t position) {
+      try {
+        const Key& key = keys[position];
+        Load(indices[position], [&compute, &key]() { return compute(key); });
+      } catch (...) {
+        errors[position] = std::current_exception();
+      }
+    };
+
+    if (executor && misses.size() > 1) {
+      concurrency::Latch done(misses.size());
+      size_t submitted = 0;
+      try {
+        for (; submitted < misses.size(); ++submitted) {
+          size_t position = misses[submitted];
+          executor([&load, &done, position]() {
+            load(position);
+            done.CountDown();
+          });
+        }
+      } catch (...) {
+        LOG_WARNING("Executor refused a batch load; computing ",
+                    misses.size() - submitted, " inline");
+        for (size_t miss = submitted; miss < misses.size(); ++miss) {
+          load(misses[miss]);
+          done.CountDown();
+        }
+      }
+      done.Wait();
+    } else {
+      for (size_t position : misses) {
+        load(position);
+      }
+    }
+
+    std::vector<ValueType> values;
+    values.reserve(keys.size());
+    for (size_t position = 0; position < keys.size(); ++position) {
+      if (errors[position]) {
+        std::rethrow_exception(errors[position]);
+      }
+      values.push_back(*Peek(indices[position]));
+    }
+    return values;
+  }
+
+  // Hits, misses and loads so far, with every filled cell an insert; cells
+  // are never removed.
+  cache::CacheStats Stats() {
+    cache::CacheStats stats;
+    stats.hits = hits_.Get();
+    stats.misses = misses_.Get();
+    stats.inserts = inserts_.Get();
+    stats.size = stats.weight = Size();
+    loads_.AddTo(&stats);
+    return stats;
+  }
+
+  // See MemoTable::EnableLoadLatency.
+  void EnableLoadLatency() { loads_.EnableLatency(); }
+
+  LatencySnapshot LoadLatency() const { return loads_.Latency(); }
+
+  size_t Size() {
+    std::lock_guard<std::mutex> lock(mutex_);
+    return size_;
+  }
+
+  size_t Weight() { return Size(); }
+
+ private:
+  struct Cell {
+    Cell() : ready(false) {}
+
+    ValueType& value() { return *reinterpret_cast<ValueType*>(&storage); }
+    const ValueType& value() const {
+      return *reinterpret_cast<const ValueType*>(&storage);
+    }
+
+    std::atomic<bool> ready;
+    typename std::aligned_storage<sizeof(ValueType),
+                                  alignof(ValueType)>::type storage;
+  };
+
+  // As in MemoTable; owner catches a computation that depends on itself.
+  struct Flight {
+    explicit Flight(std::shared_future<void> future)
+        : future(std::move(future)), owner(std::this_thread::get_id()) {}
+
+    std::shared_future<void> future;
+    std::thread::id owner;
+  };
+
+  const ValueType* Peek(size_t index) const {
+    const Cell& cell = cells_[index];
+    return cell.ready.load(std::memory_order_acquire) ? &cell.value()
+                                                      : nullptr;
+  }
+
+  template <typename Probe, size_t... Indices>
+  static size_t IndexOfTuple(const Probe& probe,
+                             utils::immutable::IndexSequence<Indices...>) {
+    return IndexOf(std::get<Indices>(probe)...);
+  }
+
+  Cell cells_[Indexer::kSize];
+  std::mutex mutex_;
+  size_t size_;
+  std::unordered_map<size_t, Flight> in_flight_;
+  cache::StripedStatsCounter hits_;
+  cache::StatsCounter misses_;
+  cache::StatsCounter inserts_;
+  LoadRecorder loads_;
+};
+
+}  // namespace memoization
+}  // namespace side_effects
@@ -0,0 +1,248 @@
+/*
+ * Copyright (C) 2024  OverbearingPearl
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ * The above copyright notice and this permission notice shall be included in
+ * all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+ * THE SOFTWARE.
+ */
+
+#pragma once
+
+#include <atomic>
+#include <cstddef>
+#include <cstdint>
+#include <memory>
+#include <new>
+#include <type_traits>
+#include <utility>
+#include <vector>
+
+#include "src/side_effects/cache/cache.h"
+#include "src/side_effects/cache/cache_stats.h"
+#include "src/utils/immutable/tuple.h"
+
+namespace side_effects {
+namespace memoization {
+
+// Per-hash-stripe generation counters of a shared table. Every entry the
+// table's policy removes bumps its stripe, so a copy of a value taken while
+// the stripe read g is still current as long as the stripe still reads g.
+// Unrelated keys in the same stripe cause spurious invalidations only.
+class GenerationTable : public cache::RemovalObserver {
+ public:
+  GenerationTable() {
+    for (auto& stripe : stripes_) {
+      stripe.store(0, std::memory_order_relaxed);
+    }
+  }
+
+  GenerationTable(const GenerationTable&) = delete;
+  GenerationTable& operator=(const GenerationTable&) = delete;
+
+  uint64_t Get(uint64_t hash) const {
+    return stripes_[StripeOf(hash)].load(std::memory_order_acquire);
+  }
+
+  void OnRemoval(uint64_t hash, cache::RemovalCause /*cause*/) override {
+    stripes_[StripeOf(hash)].fetch_add(1, std::memory_order_release);
+  }
+
+ private:
+  static constexpr size_t kStripes = 256;
+
+  // FrontCache picks slots from the low bits; take the stripe from others.
+  static size_t StripeOf(uint64_t hash) {
+    return static_cast<size_t>(hash >> 24) & (kStripes - 1);
+  }
+
+  std::atomic<uint64_t> stripes_[kStripes];
+};
+
+// Lets one thread's registry own FrontCaches of any key and value type.
+class FrontCacheBase {
+ public:
+  virtual ~FrontCacheBase() = default;
+};
+
+// A small direct-mapped cache owned by a single thread, so it takes no
+// locks. Each entry remembers the generation its value was read under and
+// is only served while that generation is current.
+template <typename KeyType, typename ValueType>
+class FrontCache : public FrontCacheBase {
+ public:
+  // slots is rounded up to a power of two.
+  explicit FrontCache(size_t slots) : entries_(RoundUp(slots)) {}
+
+  FrontCache(const FrontCache&) = delete;
+  FrontCache& operator=(const FrontCache&) = delete;
+
+  ~FrontCache() override {
+    for (auto& entry : entries_) {
+      if (entry.filled) {
+        entry.item().~Item();
+      }
+    }
+  }
+
+  // The value cached for probe, or nullptr if there is none or it was read
+  // under another generation. Valid until the next Fill.
+  template <typename Probe>
+  const ValueType* Find(const Probe& probe, uint64_t hash,
+                        uint64_t generation) const {
+    const Entry& entry = entries_[hash & (entries_.size() - 1)];
+    if (!entry.filled || entry.hash != hash ||
+        entry.generation != generation ||
+        !utils::immutable::TupleEqual()(entry.item().first, probe)) {
+      return nullptr;
+    }
+    return &entry.item().second;
+  }
+
+  // Caches value for key, replacing whatever shared its slot.
+  void Fill(KeyType key, ValueType value, uint64_t hash,
+            uint64_t generation) {
+    Entry& entry = entries_[hash & (entries_.size() - 1)];
+    if (entry.filled) {
+      entry.filled = false;
+      entry.item().~Item();
+    }
+    new (&entry.storage) Item(std::move(key), std::move(value));
+    entry.filled = true;
+    entry.hash = hash;
+    entry.generation = generation;
+  }
+
+ private:
+  using Item = std::pair<KeyType, ValueType>;
+
+  struct Entry {
+    Entry() : filled(false), hash(0), generation(0) {}
+
+    Item& item() { return *reinterpret_cast<Item*>(&storage); }
+    const Item& item() const {
+      return *reinterpret_cast<const Item*>(&storage);
+    }
+
+    bool filled;
+    uint64_t hash;
+    uint64_t generation;
+    typename std::aligned_storage<sizeof(Item), alignof(Item)>::type storage;
+  };
+
+  static size_t RoundUp(size_t slots) {
+    size_t rounded = 1;
+    while (rounded < slots) {
+      rounded <<= 1;
+    }
+    return rounded;
+  }
+
+  std::vector<Entry> entries_;
+};
+
+namespace internal {
+
+// The FrontCaches of the calling thread, one per FrontTier it has used
+// lately. Holding a few lets a thread alternate between memoized functions
+// without refilling; beyond that the least recently looked up is dropped.
+// Entries of destroyed tiers linger until dropped or until the thread
+// exits: ids are never reused, so nothing looks them up again.
+class FrontCacheRegistry {
+ public:
+  static FrontCacheRegistry& Local() {
+    static thread_local FrontCacheRegistry registry;
+    return registry;
+  }
+
+  // The cache registered for id, or nullptr.
+  FrontCacheBase* Find(uint64_t id) {
+    if (!entries_.empty() && entries_.back().id == id) {
+      return entries_.back().cache.get();
+    }
+    for (size_t index = 0; index < entries_.size(); ++index) {
+      if (entries_[index].id == id) {
+        Entry found = std::move(entries_[index]);
+        entries_.erase(entries_.begin() + index);
+        entries_.push_back(std::move(found));
+        return entries_.back().cache.get();
+      }
+    }
+    return nullptr;
+  }
+
+  FrontCacheBase* Add(uint64_t id, std::unique_ptr<FrontCacheBase> cache) {
+    if (entries_.size() == kMaxEntries) {
+      entries_.erase(entries_.begin());
+    }
+    entries_.push_back(Entry{id, std::move(cache)});
+    return entries_.back().cache.get();
+  }
+
+ private:
+  static constexpr size_t kMaxEntries = 16;
+
+  struct Entry {
+    uint64_t id;
+    std::unique_ptr<FrontCacheBase> cache;
+  };
+
+  std::vector<Entry> entries_;  // Most recently looked up last.
+};
+
+inline uint64_t NextFrontTierId() {
+  static std::atomic<uint64_t> next_id(0);
+  return next_id.fetch_add(1, std::memory_order_relaxed);
+}
+
+}  // namespace internal
+
+// The thread-local tier in front of one shared MemoTable: the table's
+// generations, registered as its RemovalObserver, and the size of each
+// thread's FrontCache. The table must not outlive it.
+template <typename KeyType, typename ValueType>
+class FrontTier {
+ public:
+  explicit FrontTier(size_t slots)
+      : id_(internal::NextFrontTierId()), slots_(slots) {}
+
+  FrontTier(const FrontTier&) = delete;
+  FrontTier& operator=(const FrontTier&) = delete;
+
+  GenerationTable& generations() { return generations_; }
+
+  // The calling thread's FrontCache, created on first use.
+  FrontCache<KeyType, ValueType>& Local() const {
+    internal::FrontCacheRegistry& registry =
+        internal::FrontCacheRegistry::Local();
+    FrontCacheBase* cache = registry.Find(id_);
+    if (cache == nullptr) {
+      cache = registry.Add(id_, std::unique_ptr<FrontCacheBase>(
+                                    new FrontCache<KeyType, ValueType>(
+                                        slots_)));
+    }
+    return *static_cast<FrontCache<KeyType, ValueType>*>(cache);
+  }
+
+  uint64_t Generation(uint64_t hash) const { return generations_.Get(hash); }
+
+ private:
+  GenerationTable generations_;
+  uint64_t id_;
+  size_t slots_;
+};
+
+}  // namespace memoization
+}  // namespace side_effects
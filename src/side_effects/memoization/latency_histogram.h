@@ -0,0 +1,233 @@
+/*
+ * Copyright (C) 2024  OverbearingPearl
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ * The above copyright notice and this permission notice shall be included in
+ * all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+ * THE SOFTWARE.
+ */
+
+#pragma once
+
+#include <atomic>
+#include <chrono>
+#include <cstddef>
+#include <cstdint>
+#include <ostream>
+#include <vector>
+
+#include "src/side_effects/cache/cache_stats.h"
+
+namespace side_effects {
+namespace memoization {
+
+// Log-linear bucketing in the style of HdrHistogram: values below
+// 2 * kSubBuckets get a bucket each, and every power of two above that is
+// split into kSubBuckets equal buckets, so a recorded value is off by at most
+// 1 / kSubBuckets (about 3%) whatever its magnitude.
+class LatencyBuckets {
+ public:
+  static constexpr size_t kSubBucketBits = 5;
+  static constexpr size_t kSubBuckets = size_t(1) << kSubBucketBits;
+  static constexpr size_t kCount = (65 - kSubBucketBits) * kSubBuckets;
+
+  static size_t IndexOf(uint64_t value) {
+    if (value < 2 * kSubBuckets) {
+      return static_cast<size_t>(value);
+    }
+    size_t shift = HighestBit(value) - kSubBucketBits;
+    return shift * kSubBuckets + static_cast<size_t>(value >> shift);
+  }
+
+  // Smallest and largest value that IndexOf maps to index.
+  static uint64_t LowestOf(size_t index) {
+    if (index < 2 * kSubBuckets) {
+      return index;
+    }
+    size_t shift = index / kSubBuckets - 1;
+    return static_cast<uint64_t>(index % kSubBuckets + kSubBuckets) << shift;
+  }
+
+  static uint64_t HighestOf(size_t index) {
+    return index + 1 == kCount ? UINT64_MAX : LowestOf(index + 1) - 1;
+  }
+
+ private:
+  static size_t HighestBit(uint64_t value) {
+#if defined(__GNUC__)
+    return 63 - __builtin_clzll(value);
+#else
+    size_t bit = 0;
+    while (value >>= 1) {
+      ++bit;
+    }
+    return bit;
+#endif
+  }
+};
+
+// Bucket counts copied out of a LatencyHistogram.
+class LatencySnapshot {
+ public:
+  LatencySnapshot() : counts_(LatencyBuckets::kCount, 0) {}
+
+  uint64_t Count() const {
+    uint64_t count = 0;
+    for (uint64_t bucket : counts_) {
+      count += bucket;
+    }
+    return count;
+  }
+
+  // Upper bound of the bucket holding the percentile-th value, with
+  // percentile in [0, 100]; 0 when nothing was recorded.
+  uint64_t ValueAtPercentile(double percentile) const {
+    uint64_t count = Count();
+    if (count == 0) {
+      return 0;
+    }
+    uint64_t rank = static_cast<uint64_t>(percentile / 100 * count + 0.5);
+    rank = rank == 0 ? 1 : (rank > count ? count : rank);
+    uint64_t seen = 0;
+    for (size_t index = 0; index < counts_.size(); ++index) {
+      seen += counts_[index];
+      if (seen >= rank) {
+        return LatencyBuckets::HighestOf(index);
+      }
+    }
+    return 0;
+  }
+
+  // Writes the non-empty buckets as CSV lines "lowest_ns,highest_ns,count"
+  // after a header line.
+  void Export(std::ostream& out) const {
+    out << "lowest_ns,highest_ns,count\n";
+    for (size_t index = 0; index < counts_.size(); ++index) {
+      if (counts_[index] != 0) {
+        out << LatencyBuckets::LowestOf(index) << ','
+            << LatencyBuckets::HighestOf(index) << ',' << counts_[index]
+            << '\n';
+      }
+    }
+  }
+
+  LatencySnapshot& operator+=(const LatencySnapshot& other) {
+    for (size_t index = 0; index < counts_.size(); ++index) {
+      counts_[index] += other.counts_[index];
+    }
+    return *this;
+  }
+
+ private:
+  friend class LatencyHistogram;
+
+  std::vector<uint64_t> counts_;
+};
+
+// Concurrent histogram of durations in nanoseconds. Record is one relaxed
+// atomic add; Snapshot may run alongside it and sees each bucket at some
+// recent value.
+class LatencyHistogram {
+ public:
+  LatencyHistogram() {
+    for (auto& bucket : buckets_) {
+      bucket.store(0, std::memory_order_relaxed);
+    }
+  }
+
+  LatencyHistogram(const LatencyHistogram&) = delete;
+  LatencyHistogram& operator=(const LatencyHistogram&) = delete;
+
+  void Record(uint64_t nanos) {
+    buckets_[LatencyBuckets::IndexOf(nanos)].fetch_add(
+        1, std::memory_order_relaxed);
+  }
+
+  LatencySnapshot Snapshot() const {
+    LatencySnapshot snapshot;
+    for (size_t index = 0; index < LatencyBuckets::kCount; ++index) {
+      snapshot.counts_[index] = buckets_[index].load(std::memory_order_relaxed);
+    }
+    return snapshot;
+  }
+
+ private:
+  std::atomic<uint64_t> buckets_[LatencyBuckets::kCount];
+};
+
+// The load counters of a memo table: how many computations of missed
+// values succeeded or threw, and the time they took. A histogram of those
+// times is allocated on EnableLatency, so tables that never ask for one
+// pay one pointer load per load.
+class LoadRecorder {
+ public:
+  using Clock = std::chrono::steady_clock;
+
+  LoadRecorder() : latency_(nullptr) {}
+
+  LoadRecorder(const LoadRecorder&) = delete;
+  LoadRecorder& operator=(const LoadRecorder&) = delete;
+
+  ~LoadRecorder() { delete latency_.load(std::memory_order_relaxed); }
+
+  // A load that started at start has just returned or thrown.
+  void Record(Clock::time_point start, bool succeeded) {
+    uint64_t nanos = static_cast<uint64_t>(
+        std::chrono::duration_cast<std::chrono::nanoseconds>(Clock::now() -
+                                                             start)
+            .count());
+    (succeeded ? loads_ : failures_).Add();
+    nanos_.Add(nanos);
+    LatencyHistogram* histogram = latency_.load(std::memory_order_acquire);
+    if (histogram != nullptr) {
+      histogram->Record(nanos);
+    }
+  }
+
+  void EnableLatency() {
+    if (latency_.load(std::memory_order_acquire) != nullptr) {
+      return;
+    }
+    LatencyHistogram* histogram = new LatencyHistogram();
+    LatencyHistogram* expected = nullptr;
+    if (!latency_.compare_exchange_strong(expected, histogram,
+                                          std::memory_order_acq_rel)) {
+      delete histogram;
+    }
+  }
+
+  // Load times recorded since EnableLatency; empty if it was not called.
+  LatencySnapshot Latency() const {
+    const LatencyHistogram* histogram =
+        latency_.load(std::memory_order_acquire);
+    return histogram == nullptr ? LatencySnapshot() : histogram->Snapshot();
+  }
+
+  // Fills in the load fields of stats.
+  void AddTo(cache::CacheStats* stats) const {
+    stats->loads = loads_.Get();
+    stats->load_failures = failures_.Get();
+    stats->load_nanos = nanos_.Get();
+  }
+
+ private:
+  cache::StatsCounter loads_;
+  cache::StatsCounter failures_;
+  cache::StatsCounter nanos_;
+  std::atomic<LatencyHistogram*> latency_;
+};
+
+}  // namespace memoization
+}  // namespace side_effects
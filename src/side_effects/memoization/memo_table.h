@@ -0,0 +1,616 @@
+/*
+ * Copyright (C) 2024  OverbearingPearl
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ * The above copyright notice and this permission notice shall be included in
+ * all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+ * THE SOFTWARE.
+ */
+
+#pragma once
+
+#include <atomic>
+#include <chrono>
+#include <exception>
+#include <functional>
+#include <future>
+#include <memory>
+#include <mutex>
+#include <stdexcept>
+#include <thread>
+#include <type_traits>
+#include <unordered_map>
+#include <utility>
+#include <vector>
+
+#include "src/side_effects/cache/cache.h"
+#include "src/side_effects/cache/pool_allocator.h"
+#include "src/side_effects/cache/read_buffer.h"
+#include "src/side_effects/concurrency/executor.h"
+#include "src/side_effects/concurrency/shared_mutex.h"
+#include "src/side_effects/io/logging.h"
+#include "src/side_effects/memoization/latency_histogram.h"
+#include "src/utils/immutable/tuple.h"
+
+namespace side_effects {
+namespace memoization {
+
+namespace internal {
+
+// Values of a batch, filled in any order (and from several threads, one
+// index each) and handed out in index order. ValueType need not be default
+// constructible.
+template <typename ValueType>
+class BatchResults {
+ public:
+  explicit BatchResults(size_t count) : storage_(count), filled_(count, 0) {}
+
+  BatchResults(const BatchResults&) = delete;
+  BatchResults& operator=(const BatchResults&) = delete;
+
+  ~BatchResults() {
+    for (size_t index = 0; index < storage_.size(); ++index) {
+      if (filled_[index]) {
+        At(index).~ValueType();
+      }
+    }
+  }
+
+  void Set(size_t index, ValueType value) {
+    new (&storage_[index]) ValueType(std::move(value));
+    filled_[index] = 1;
+  }
+
+  const ValueType& Get(size_t index) const {
+    return *reinterpret_cast<const ValueType*>(&storage_[index]);
+  }
+
+  // Every index must have been set.
+  std::vector<ValueType> Take() {
+    std::vector<ValueType> values;
+    values.reserve(storage_.size());
+    for (size_t index = 0; index < storage_.size(); ++index) {
+      values.push_back(std::move(At(index)));
+    }
+    return values;
+  }
+
+ private:
+  ValueType& At(size_t index) {
+    return *reinterpret_cast<ValueType*>(&storage_[index]);
+  }
+
+  std::vector<typename std::aligned_storage<sizeof(ValueType),
+                                            alignof(ValueType)>::type>
+      storage_;
+  std::vector<char> filled_;  // Not vector<bool>: written concurrently.
+};
+
+}  // namespace internal
+
+// One cache and its policy behind a mutex. MemoizedFunc owns a single table,
+// ShardedMemoizedFunc owns several and routes each key to one of them.
+//
+// With a policy whose hits are read-only (Insertable::kConcurrentHits), the
+// mutex is a SharedMutex and hits only take it shared.
+//
+// A ReadMostly table serves every hit under a shared ReadMostlyMutex, which
+// readers take without contending with each other. Policies without
+// concurrent hits have their hits recorded in a ReadBuffer and applied to
+// the policy later, by the next miss that inserts or by a reader whose ring
+// of the buffer has filled up. Misses pay for this with a costlier
+// exclusive lock.
+template <typename Key, typename Value, typename Insertable,
+          bool ReadMostly = false>
+class MemoTable : public std::enable_shared_from_this<
+                      MemoTable<Key, Value, Insertable, ReadMostly>> {
+ public:
+  using KeyType = Key;
+  using ValueType = Value;
+  using CacheType = typename Insertable::CacheType;
+
+  static_assert(!ReadMostly || Insertable::kConcurrentHits ||
+                    Insertable::kDeferredHits,
+                "The policy cannot defer hits to a read-mostly table");
+
+  explicit MemoTable(Insertable cache_policy)
+      : cache_policy_(std::move(cache_policy)),
+        read_buffer_(DeferredHits::value ? new cache::ReadBuffer() : nullptr) {}
+
+  MemoTable(const MemoTable&) = delete;
+  MemoTable& operator=(const MemoTable&) = delete;
+
+
+  // The lock is only held around cache and bookkeeping access; compute runs
+  // unlocked. Concurrent misses on one key share a single computation, and
+  // an exception from it reaches every waiter without being cached.
+  //
+  // compute may call back into the table for other keys (see
+  // Memoization::MemoizeRecursive). A call for a key the same thread is
+  // already computing throws std::logic_error rather than deadlock.
+  //
+  // probe only has to hash and compare like KeyType (see ProbeTuple); the
+  // key itself is built from it on a miss.
+  template <typename Probe, typename Compute>
+  ValueType GetOrCompute(const Probe& probe, Compute compute) {
+    return GetOrCompute(probe, CacheType::HashOf(probe), compute);
+  }
+
+  // As above, with hash already computed by CacheType::HashOf(probe); it is
+  // reused for the lookup and for storing the entry.
+  template <typename Probe, typename Compute>
+  ValueType GetOrCompute(const Probe& probe, uint64_t hash, Compute compute) {
+    return GetOrCompute(probe, hash, compute, HitPath());
+  }
+
+  // GetOrCompute for many keys. Each distinct missing key is computed
+  // once, on executor when one is given (the call blocks until all are
+  // done), otherwise in order on the calling thread. Keys another caller is
+  // already computing are joined, as in GetOrCompute.
+  //
+  // compute may call back into the table, for keys of this batch too: a
+  // key the batch has not reached yet is then computed on the spot by the
+  // caller that needs it (see BatchLoad).
+  //
+  // Returns the values in keys' order. If computations throw, the values
+  // that did succeed are still cached, and the exception of the earliest
+  // failing key is rethrown.
+  template <typename Compute>
+  std::vector<ValueType> GetOrComputeBatch(
+      const std::vector<KeyType>& keys, Compute compute,
+      const concurrency::Executor& executor = concurrency::Executor()) {
+    std::vector<uint64_t> hashes;
+    hashes.reserve(keys.size());
+    for (const auto& key : keys) {
+      hashes.push_back(CacheType::HashOf(key));
+    }
+    internal::BatchResults<ValueType> results(keys.size());
+    std::vector<Load> loads;
+    std::vector<std::pair<size_t, std::shared_future<ValueType>>> joined;
+    // Loads of other batches this one waits for and may run itself.
+    std::vector<std::shared_ptr<BatchLoad>> adopted;
+
+    std::unique_lock<Mutex> lock(mutex_);
+    for (size_t index = 0; index < keys.size(); ++index) {
+      if (index + kPrefetchDistance < keys.size()) {
+        cache_.Prefetch(hashes[index + kPrefetchDistance]);
+      }
+      const ValueType* cached =
+          cache_policy_.Get(&cache_, keys[index], hashes[index]);
+      if (cached != nullptr) {
+        results.Set(index, *cached);
+        continue;
+      }
+      // Also catches a key repeated within the batch, whose first
+      // occurrence is now in flight.
+      auto flight = in_flight_.find(keys[index]);
+      if (flight != in_flight_.end()) {
+        joined.emplace_back(index, flight->second.future);
+        if (flight->second.batch_load != nullptr) {
+          adopted.push_back(flight->second.batch_load);
+        }
+        continue;
+      }
+      const KeyType& key = keys[index];
+      // Runs before this call returns, so references are safe.
+      std::shared_ptr<BatchLoad> load = std::make_shared<BatchLoad>(
+          [&compute, &key]() { return compute(key); });
+      loads.push_back(Load{index, load, load->promise.get_future().share()});
+      in_flight_.emplace(key, Flight(loads.back().future, std::thread::id(),
+                                     std::move(load)));
+    }
+    lock.unlock();
+    LOG_DEBUG("Batch of ", keys.size(), ": ", loads.size(), " loads, ",
+              joined.size(), " joined");
+
+    if (executor && loads.size() > 1) {
+      concurrency::Latch done(loads.size());
+      size_t submitted = 0;
+      try {
+        for (; submitted < loads.size(); ++submitted) {
+          std::shared_ptr<BatchLoad> task = loads[submitted].task;
+          executor([this, &done, task]() {
+            RunUnclaimed(task.get());
+            done.CountDown();
+          });
+        }
+      } catch (...) {
+        // The tasks already submitted refer to done, so wait for them
+        // either way; the loads executor refused run here instead.
+        LOG_WARNING("Executor refused a batch load; computing ",
+                    loads.size() - submitted, " inline");
+        for (size_t index = submitted; index < loads.size(); ++index) {
+          RunUnclaimed(loads[index].task.get());
+          done.CountDown();
+        }
+      }
+      done.Wait();
+    } else {
+      for (const auto& load : loads) {
+        RunUnclaimed(load.task.get());
+      }
+    }
+    for (const auto& load : adopted) {
+      RunUnclaimed(load.get());
+    }
+    // A load claimed by a nested call on another thread may still be
+    // running.
+    for (const auto& load : loads) {
+      load.future.wait();
+    }
+
+    lock.lock();
+    DrainHits();
+    for (const auto& load : loads) {
+      in_flight_.erase(keys[load.index]);
+    }
+    for (const auto& load : loads) {
+      if (!load.task->error) {
+        cache_policy_.Insert(&cache_, keys[load.index], load.future.get(),
+                             hashes[load.index]);
+      }
+    }
+    lock.unlock();
+
+    size_t first_error = keys.size();
+    std::exception_ptr error;
+    auto fail = [&](size_t index, std::exception_ptr exception) {
+      if (index < first_error) {
+        first_error = index;
+        error = exception;
+      }
+    };
+    for (const auto& load : loads) {
+      joined.emplace_back(load.index, load.future);
+    }
+    for (auto& join : joined) {
+      try {
+        results.Set(join.first, join.second.get());
+      } catch (...) {
+        fail(join.first, std::current_exception());
+      }
+    }
+    if (error) {
+      std::rethrow_exception(error);
+    }
+    return results.Take();
+  }
+
+  // GetOrCompute without waiting: returns a future for the value at once.
+  // A hit comes back as a ready future, a key that is already being computed
+  // (by any caller) shares that computation, and a miss runs compute(key)
+  // on executor. The value is cached when it
+  // is ready. The table must be owned by a std::shared_ptr; a pending
+  // computation keeps it alive.
+  template <typename Probe, typename Compute>
+  std::shared_future<ValueType> GetOrComputeAsync(
+      const Probe& probe, uint64_t hash, Compute compute,
+      const concurrency::Executor& executor) {
+    std::unique_lock<Mutex> lock(mutex_);
+    const ValueType* cached = cache_policy_.Get(&cache_, probe, hash);
+    if (cached != nullptr) {
+      LOG_DEBUG("Cache hit");
+      std::promise<ValueType> ready;
+      ready.set_value(*cached);
+      return ready.get_future().share();
+    }
+
+    KeyType key(probe);
+    auto flight = in_flight_.find(key);
+    if (flight != in_flight_.end()) {
+      LOG_DEBUG("Cache miss, joining in-flight computation");
+      return flight->second.future;
+    }
+
+    LOG_DEBUG("Cache miss, computing asynchronously");
+    auto promise = std::make_shared<std::promise<ValueType>>();
+    std::shared_future<ValueType> future = promise->get_future().share();
+    in_flight_.emplace(key, Flight(future));
+    lock.unlock();
+
+    std::shared_ptr<MemoTable> self = this->shared_from_this();
+    try {
+      executor([self, key, hash, compute, promise]() mutable {
+        auto load = [&compute, &key]() { return compute(key); };
+        try {
+          self->Resolve(key, hash, load, promise.get());
+        } catch (...) {
+          // Already delivered through the future.
+        }
+      });
+    } catch (...) {
+      lock.lock();
+      in_flight_.erase(key);
+      lock.unlock();
+      promise->set_exception(std::current_exception());
+    }
+    return future;
+  }
+
+  size_t Size() {
+    std::lock_guard<Mutex> lock(mutex_);
+    return cache_.size();
+  }
+
+  // Total weight of the cached entries (see Insertable::WeightOf).
+  size_t Weight() {
+    std::lock_guard<Mutex> lock(mutex_);
+    return cache_.weight();
+  }
+
+  // Forwards to the policy's Insertable::SetRemovalObserver.
+  void SetRemovalObserver(cache::RemovalObserver* observer) {
+    std::lock_guard<Mutex> lock(mutex_);
+    cache_policy_.SetRemovalObserver(observer);
+  }
+
+  // The policy's counters plus the loads made through this table. Joining
+  // an in-flight computation counts as a miss but not as a load.
+  cache::CacheStats Stats() {
+    cache::CacheStats stats;
+    {
+      std::lock_guard<Mutex> lock(mutex_);
+      stats = cache_policy_.Stats(cache_);
+    }
+    loads_.AddTo(&stats);
+    return stats;
+  }
+
+  // Starts recording how long each load takes. The histogram is allocated
+  // on first use, so tables that never enable it pay one pointer load per
+  // miss.
+  void EnableLoadLatency() { loads_.EnableLatency(); }
+
+  // Load times recorded since EnableLoadLatency; empty if it was not called.
+  LatencySnapshot LoadLatency() const { return loads_.Latency(); }
+
+ private:
+  using ConcurrentHits =
+      std::integral_constant<bool, Insertable::kConcurrentHits>;
+  using DeferredHits =
+      std::integral_constant<bool, ReadMostly && !ConcurrentHits::value>;
+  // Selects the GetOrCompute overload for hits: std::true_type serves them
+  // under the shared lock, std::false_type under the exclusive one, and
+  // DeferHits under the shared lock through read_buffer_.
+  struct DeferHits {};
+  using HitPath = typename std::conditional<DeferredHits::value, DeferHits,
+                                            ConcurrentHits>::type;
+  using Mutex = typename std::conditional<
+      ReadMostly, concurrency::ReadMostlyMutex,
+      typename std::conditional<ConcurrentHits::value,
+                                concurrency::SharedMutex,
+                                std::mutex>::type>::type;
+
+  template <typename Probe, typename Compute>
+  ValueType GetOrCompute(const Probe& probe, uint64_t hash, Compute compute,
+                         DeferHits) {
+    if (read_buffer_->Full()) {
+      std::unique_lock<Mutex> lock(mutex_, std::try_to_lock);
+      if (lock.owns_lock()) {
+        DrainHits();
+      }
+    }
+    {
+      concurrency::SharedLock<Mutex> lock(mutex_);
+      cache::SlotIndex slot = cache_policy_.GetDeferred(cache_, probe, hash);
+      if (slot != cache::kNoSlot) {
+        LOG_DEBUG("Cache hit");
+        read_buffer_->Record(slot, hash);
+        return cache_.value(slot);
+      }
+    }
+    return GetOrCompute(probe, hash, compute, std::false_type());
+  }
+
+  template <typename Probe, typename Compute>
+  ValueType GetOrCompute(const Probe& probe, uint64_t hash, Compute compute,
+                         std::true_type) {
+    {
+      concurrency::SharedLock<Mutex> lock(mutex_);
+      const ValueType* cached = cache_policy_.GetShared(cache_, probe, hash);
+      if (cached != nullptr) {
+        LOG_DEBUG("Cache hit");
+        return *cached;
+      }
+    }
+    return GetOrCompute(probe, hash, compute, std::false_type());
+  }
+
+  template <typename Probe, typename Compute>
+  ValueType GetOrCompute(const Probe& probe, uint64_t hash, Compute compute,
+                         std::false_type) {
+    std::unique_lock<Mutex> lock(mutex_);
+
+    const ValueType* cached = cache_policy_.Get(&cache_, probe, hash);
+    if (cached != nullptr) {
+      LOG_DEBUG("Cache hit");
+      return *cached;
+    }
+
+    KeyType key(probe);
+    auto flight = in_flight_.find(key);
+    if (flight != in_flight_.end()) {
+      if (flight->second.Owner() == std::this_thread::get_id()) {
+        // Waiting would deadlock: this thread is computing key further up
+        // its own stack, so key's value depends on itself.
+        throw std::logic_error("Memoized function depends on itself");
+      }
+      std::shared_future<ValueType> pending = flight->second.future;
+      std::shared_ptr<BatchLoad> batch_load = flight->second.batch_load;
+      lock.unlock();
+      // The batch may be waiting on this very call (compute for one of its
+      // keys needs another), so run the key now if it has not started.
+      if (batch_load != nullptr && RunUnclaimed(batch_load.get())) {
+        LOG_DEBUG("Cache miss, computed a batch's key");
+      } else {
+        LOG_DEBUG("Cache miss, joining in-flight computation");
+      }
+      return pending.get();
+    }
+
+    LOG_DEBUG("Cache miss");
+    std::promise<ValueType> promise;
+    in_flight_.emplace(key, Flight(promise.get_future().share(),
+                                   std::this_thread::get_id()));
+    lock.unlock();
+    return Resolve(std::move(key), hash, compute, &promise);
+  }
+
+  // Runs compute for key, whose in_flight_ entry is promise's future, then
+  // caches the value, removes the entry and fulfils promise. If compute
+  // throws, nothing is cached and the exception goes to promise as well as
+  // to the caller. Called without the lock held.
+  template <typename Compute>
+  ValueType Resolve(KeyType key, uint64_t hash, Compute& compute,
+                    std::promise<ValueType>* promise) {
+    std::unique_lock<Mutex> lock(mutex_, std::defer_lock);
+    bool in_flight = true;
+    bool computed = false;
+    Clock::time_point start = Clock::now();
+    try {
+      ValueType result = compute();
+      computed = true;
+      loads_.Record(start, true);
+      lock.lock();
+      in_flight_.erase(key);
+      in_flight = false;
+      DrainHits();
+      cache_policy_.Insert(&cache_, std::move(key), result, hash);
+      lock.unlock();
+      promise->set_value(result);
+      return result;
+    } catch (...) {
+      if (!computed) {
+        loads_.Record(start, false);
+      }
+      if (!lock.owns_lock()) {
+        lock.lock();
+      }
+      if (in_flight) {
+        in_flight_.erase(key);
+      }
+      lock.unlock();
+      promise->set_exception(std::current_exception());
+      throw;
+    }
+  }
+
+  // Applies the hits read_buffer_ holds, so the policy sees them before
+  // it picks a victim. Called with the lock held exclusively.
+  void DrainHits() {
+    if (read_buffer_ != nullptr) {
+      read_buffer_->Drain([this](cache::SlotIndex slot, uint64_t hash) {
+        cache_policy_.ReplayHit(&cache_, slot, hash);
+      });
+    }
+  }
+
+  using Clock = LoadRecorder::Clock;
+
+  // How many keys ahead GetOrComputeBatch prefetches.
+  static constexpr size_t kPrefetchDistance = 8;
+
+  // A key GetOrComputeBatch has to compute. Whichever thread claims it
+  // first runs compute and fulfils promise: the batch, one of its executor
+  // tasks, or a caller that needs the key before the batch gets to it. The
+  // claimant becomes the owner, so a cycle back to the key throws as in
+  // GetOrCompute. owner is guarded by the table's lock; error is set
+  // before promise is fulfilled.
+  struct BatchLoad {
+    explicit BatchLoad(std::function<ValueType()> compute)
+        : compute(std::move(compute)) {}
+
+    std::function<ValueType()> compute;
+    std::thread::id owner;  // None until claimed.
+    std::promise<ValueType> promise;
+    std::exception_ptr error;
+  };
+
+  // One of GetOrComputeBatch's own loads: where its value goes, and the
+  // future its in_flight_ entry hands out.
+  struct Load {
+    size_t index;
+    std::shared_ptr<BatchLoad> task;
+    std::shared_future<ValueType> future;
+  };
+
+  // Claims load for the calling thread and runs it, unless another thread
+  // claimed it first. Called without the lock held.
+  bool RunUnclaimed(BatchLoad* load) {
+    {
+      std::lock_guard<Mutex> lock(mutex_);
+      if (load->owner != std::thread::id()) {
+        return false;
+      }
+      load->owner = std::this_thread::get_id();
+    }
+    Clock::time_point start = Clock::now();
+    try {
+      ValueType value = load->compute();
+      loads_.Record(start, true);
+      load->promise.set_value(std::move(value));
+    } catch (...) {
+      loads_.Record(start, false);
+      load->error = std::current_exception();
+      load->promise.set_exception(load->error);
+    }
+    return true;
+  }
+
+  // A computation in progress. owner is the thread computing it inline in
+  // GetOrCompute (none for async loads; batch loads keep theirs in
+  // batch_load), so a recursive call that comes back to the key is caught
+  // instead of waiting on itself.
+  struct Flight {
+    explicit Flight(std::shared_future<ValueType> future,
+                    std::thread::id owner = std::thread::id(),
+                    std::shared_ptr<BatchLoad> batch_load = nullptr)
+        : future(std::move(future)),
+          owner(owner),
+          batch_load(std::move(batch_load)) {}
+
+    // Read with the table's lock held. A finished batch load stays in
+    // flight until its batch ends, and its thread may exit meanwhile and
+    // have its id reused, so it no longer counts as owned.
+    std::thread::id Owner() const {
+      if (batch_load == nullptr) {
+        return owner;
+      }
+      bool finished = future.wait_for(std::chrono::seconds(0)) ==
+                      std::future_status::ready;
+      return finished ? std::thread::id() : batch_load->owner;
+    }
+
+    std::shared_future<ValueType> future;
+    std::thread::id owner;
+    std::shared_ptr<BatchLoad> batch_load;  // Set for GetOrComputeBatch.
+  };
+
+  Mutex mutex_;
+  Insertable cache_policy_;
+  CacheType cache_;
+  // Null unless DeferredHits.
+  std::unique_ptr<cache::ReadBuffer> read_buffer_;
+  // Nodes are pooled: a steady stream of misses reuses them.
+  std::unordered_map<
+      KeyType, Flight, utils::immutable::TupleHash,
+      utils::immutable::TupleEqual,
+      cache::PoolAllocator<std::pair<const KeyType, Flight>>>
+      in_flight_;
+  LoadRecorder loads_;
+};
+
+}  // namespace memoization
+}  // namespace side_effects
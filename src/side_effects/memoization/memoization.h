@@ -21,100 +21,580 @@
 
 #pragma once
 
+#include <cstdint>
 #include <functional>
+#include <future>
+#include <iterator>
 #include <memory>
-#include <mutex>
 #include <tuple>
-#include <unordered_map>
+#include <type_traits>
 #include <utility>
+#include <vector>
 
 #include "src/side_effects/cache/cache.h"
-#include "src/side_effects/io/logging.h"
+#include "src/side_effects/concurrency/executor.h"
+#include "src/side_effects/concurrency/work_stealing_pool.h"
+#include "src/side_effects/memoization/dense_table.h"
+#include "src/side_effects/memoization/front_cache.h"
+#include "src/side_effects/memoization/latency_histogram.h"
+#include "src/side_effects/memoization/memo_table.h"
+#include "src/utils/immutable/tuple.h"
 #include "src/utils/traits/func_traits.h"
 
 namespace side_effects {
 namespace memoization {
 
+// The unbounded policy for any callable utils::traits::FunctionTraits
+// understands.
 template <typename Func>
-struct CacheWithNoPolicy;
+struct CacheWithNoPolicy {
+  using Traits = utils::traits::FunctionTraits<Func>;
+  using type = side_effects::cache::CacheWithNoPolicy<
+      typename utils::immutable::DecayTuple<
+          typename Traits::arg_tuple_type>::type,
+      typename Traits::result_type>;
+};
+
+// Memoize's policy when none is given: DenseBounds when every argument type
+// declares a DenseKeyRange, otherwise CacheWithNoPolicy.
+template <typename Func,
+          typename KeyType = typename utils::immutable::DecayTuple<
+              typename utils::traits::FunctionTraits<Func>::arg_tuple_type>::
+              type,
+          bool Dense = internal::AllDenseKeys<KeyType>::value>
+struct DefaultPolicy {
+  using type = typename CacheWithNoPolicy<Func>::type;
+};
+
+template <typename Func, typename... Keys>
+struct DefaultPolicy<Func, std::tuple<Keys...>, true> {
+  using type = DenseBounds<typename DenseKeyRange<Keys>::type...>;
+};
+
+constexpr size_t kDefaultShardCount = 16;
+constexpr size_t kDefaultFrontCacheSlots = 64;
+
+namespace internal {
+
+// The function MemoizeRecursive wraps, and the self it passes to it: a Func
+// that looks its arguments up in table and calls body on a miss.
+template <typename Func, typename Table>
+class RecursiveBody;
+
+template <typename ReturnType, typename... Args, typename Table>
+class RecursiveBody<std::function<ReturnType(Args...)>, Table> {
+ public:
+  using Self = std::function<ReturnType(Args...)>;
+  using KeyType = typename Table::KeyType;
+
+  template <typename Body>
+  RecursiveBody(Body body, std::shared_ptr<Table> table)
+      : body_(body),
+        table_(std::move(table)),
+        self_([this](Args... args) { return Call(args...); }) {}
+
+  // self_ refers to this object.
+  RecursiveBody(const RecursiveBody&) = delete;
+  RecursiveBody& operator=(const RecursiveBody&) = delete;
+
+  const Self& self() const { return self_; }
+
+  Table& table() const { return *table_; }
+
+ private:
+  ReturnType Call(Args... args) {
+    return table_->GetOrCompute(
+        typename utils::immutable::ProbeTuple<KeyType, Args...>::type(
+            args...),
+        [&]() { return body_(self_, args...); });
+  }
+
+  std::function<ReturnType(const Self&, Args...)> body_;
+  std::shared_ptr<Table> table_;
+  Self self_;
+};
 
-template <typename ReturnType, typename... Args>
-struct CacheWithNoPolicy<std::function<ReturnType(Args...)>> {
-  using type =
-      side_effects::cache::CacheWithNoPolicy<std::tuple<Args...>, ReturnType>;
+// The table a memoized function keeps its results in: a MemoTable run by
+// Insertable, or a DenseTable for DenseBounds.
+template <typename KeyType, typename ValueType, typename Insertable>
+struct TableFor {
+  using type = MemoTable<KeyType, ValueType, Insertable>;
 };
 
-template <typename ReturnType, typename ClassType, typename... Args>
-struct CacheWithNoPolicy<std::function<ReturnType(ClassType*, Args...)>> {
-  using type =
-      side_effects::cache::CacheWithNoPolicy<std::tuple<ClassType*, Args...>,
-                                             ReturnType>;
+template <typename KeyType, typename ValueType, typename... Ranges>
+struct TableFor<KeyType, ValueType, DenseBounds<Ranges...>> {
+  using type = DenseTable<ValueType, Ranges...>;
 };
 
+}  // namespace internal
+
 class Memoization {
-  template <typename Func, typename Insertable>
+  template <typename Func, typename Insertable, bool ReadMostly = false>
   struct MemoizedFunc;
 
+  template <typename Func, typename Insertable>
+  struct ShardedMemoizedFunc;
+
+  template <typename Func, typename Insertable>
+  struct AsyncMemoizedFunc;
+
+  template <typename Func, typename Insertable>
+  struct RecursiveMemoizedFunc;
+
+  template <typename Func, typename... Ranges>
+  struct DenseMemoizedFunc;
+
+  template <typename Func, typename Insertable>
+  struct Backend {
+    using type = MemoizedFunc<Func, Insertable>;
+  };
+
+  template <typename Func, typename... Ranges>
+  struct Backend<Func, DenseBounds<Ranges...>> {
+    using type = DenseMemoizedFunc<Func, Ranges...>;
+  };
+
  public:
+  // func may be any callable with a single signature (see
+  // utils::traits::FunctionTraits): a lambda, functor, function pointer,
+  // std::function, or member function pointer, whose object pointer then
+  // becomes the first argument and part of the key. It is stored as is and
+  // called directly on a miss, so a lambda needs no std::function around
+  // it.
+  //
+  // Given DenseBounds instead of a policy, or by default when every
+  // argument type has a DenseKeyRange, results go to a DenseTable, where a
+  // hit is a single indexed load. The result still offers Batch, Stats and
+  // load latency:
+  //
+  //   auto paths = memoization.Memoize(
+  //       count_paths, DenseBounds<DenseRange<int, 0, 63>,
+  //                                DenseRange<int, 0, 63>>());
+  template <typename Func,
+            typename Insertable = typename DefaultPolicy<Func>::type>
+  typename Backend<Func, Insertable>::type Memoize(
+      Func func, Insertable cache_policy = Insertable()) {
+    return typename Backend<Func, Insertable>::type(func, cache_policy);
+  }
+
+  // Memoize with a second, thread-local tier in front of the shared table:
+  // each calling thread keeps the results of its own recent calls in a
+  // direct-mapped cache of front_slots entries and answers repeats from it
+  // without touching the table's lock. An entry is dropped as soon as
+  // cache_policy removes its key for any reason.
+  //
+  // Hits answered by the front tier never reach cache_policy, so they
+  // neither refresh the entry's recency or frequency nor show up in Stats.
+  // Policies that expire entries by time (cache_ttl.h) only notice expiry
+  // when the table is consulted, so pair them with plain Memoize instead.
   template <typename Func,
             typename Insertable = typename CacheWithNoPolicy<Func>::type>
-  MemoizedFunc<Func, Insertable> Memoize(
+  MemoizedFunc<Func, Insertable> MemoizeWithFrontCache(
+      Func func, Insertable cache_policy = Insertable(),
+      size_t front_slots = kDefaultFrontCacheSlots) {
+    return MemoizedFunc<Func, Insertable>(func, cache_policy, front_slots);
+  }
+
+  // Memoize for functions that settle on a working set and then mostly hit.
+  // Hits share the table's lock without contending with each other (see
+  // MemoTable's ReadMostly), so hit throughput grows with the number of
+  // calling threads; misses take a costlier exclusive lock. The policy
+  // learns of hits in batches, shortly after the fact, which is enough for
+  // its choice of victims.
+  //
+  // Policies that expire entries on a hit (cache_ttl.h) do not compile
+  // here.
+  template <typename Func,
+            typename Insertable = typename CacheWithNoPolicy<Func>::type>
+  MemoizedFunc<Func, Insertable, true> MemoizeReadMostly(
       Func func, Insertable cache_policy = Insertable()) {
-    return MemoizedFunc<Func, Insertable>(func, cache_policy);
+    return MemoizedFunc<Func, Insertable, true>(func, cache_policy);
   }
 
-  template <typename ReturnType, typename ClassType, typename... Args,
-            typename Insertable = typename CacheWithNoPolicy<
-                std::function<ReturnType(ClassType*, Args...)>>::type>
-  MemoizedFunc<std::function<ReturnType(ClassType*, Args...)>, Insertable>
-  Memoize(ReturnType (ClassType::*func)(Args...),
-          Insertable cache_policy = Insertable()) {
-    return MemoizedFunc<std::function<ReturnType(ClassType*, Args...)>,
-                        Insertable>(
-        [func](ClassType* obj, Args... args) { return (obj->*func)(args...); },
-        cache_policy);
+  // Memoizes a recursive function, such as a dynamic-programming
+  // recurrence. body takes `const Func& self` followed by Func's arguments
+  // and calls self instead of itself for subproblems, so every subproblem
+  // is computed once:
+  //
+  //   auto fib = memoization.MemoizeRecursive<std::function<long(int)>>(
+  //       [](const std::function<long(int)>& self, int n) -> long {
+  //         return n < 2 ? n : self(n - 1) + self(n - 2);
+  //       });
+  //
+  // Each self call holds the table's lock only around its own lookup and
+  // insert, never across the recursion. A subproblem that depends on itself
+  // throws std::logic_error (see MemoTable::GetOrCompute). Recursion depth
+  // is bounded by the thread's stack, as for the plain recursive function.
+  // DenseBounds work here as in Memoize.
+  template <typename Func,
+            typename Insertable = typename DefaultPolicy<Func>::type,
+            typename Body>
+  RecursiveMemoizedFunc<Func, Insertable> MemoizeRecursive(
+      Body body, Insertable cache_policy = Insertable()) {
+    return RecursiveMemoizedFunc<Func, Insertable>(body, cache_policy);
   }
 
- private:
+  // Like Memoize, but a call returns a std::shared_future right away and a
+  // miss is computed on executor, by default the process-wide
+  // WorkStealingPool. Calls for a key that is still being computed share
+  // the pending future; the value enters cache_policy once it is ready.
+  template <typename Func,
+            typename Insertable = typename CacheWithNoPolicy<Func>::type>
+  AsyncMemoizedFunc<Func, Insertable> MemoizeAsync(
+      Func func, Insertable cache_policy = Insertable(),
+      concurrency::Executor executor = concurrency::Executor()) {
+    if (!executor) {
+      executor = concurrency::WorkStealingPool::Default().AsExecutor();
+    }
+    return AsyncMemoizedFunc<Func, Insertable>(func, cache_policy, executor);
+  }
+
+  // Splits capacity evenly over shard_count independently locked shards.
+  // Each shard gets its own Insertable(capacity / shard_count), rounded up.
+  template <typename Insertable, typename Func>
+  ShardedMemoizedFunc<Func, Insertable> MemoizeSharded(
+      Func func, size_t capacity, size_t shard_count = kDefaultShardCount) {
+    shard_count = shard_count == 0 ? 1 : shard_count;
+    size_t shard_capacity = (capacity + shard_count - 1) / shard_count;
+    std::vector<Insertable> shard_policies;
+    for (size_t i = 0; i < shard_count; ++i) {
+      shard_policies.push_back(Insertable(shard_capacity == 0 ? 1
+                                                              : shard_capacity));
+    }
+    return ShardedMemoizedFunc<Func, Insertable>(func, shard_policies);
+  }
+
+  // Gives every shard a copy of cache_policy, for policies that are not
+  // bounded by an entry count (e.g. TTL) or that the caller sized already.
   template <typename Func, typename Insertable>
+  ShardedMemoizedFunc<Func, Insertable> MemoizeSharded(
+      Func func, const Insertable& cache_policy,
+      size_t shard_count = kDefaultShardCount) {
+    std::vector<Insertable> shard_policies(shard_count == 0 ? 1 : shard_count,
+                                           cache_policy);
+    return ShardedMemoizedFunc<Func, Insertable>(func, shard_policies);
+  }
+
+ private:
+  template <typename Func, typename Insertable, bool ReadMostly>
   struct MemoizedFunc {
     using ReturnType =
         typename utils::traits::FunctionTraits<Func>::result_type;
-    using ArgTupleType =
-        typename utils::traits::FunctionTraits<Func>::arg_tuple_type;
+    using KeyType = typename utils::immutable::DecayTuple<
+        typename utils::traits::FunctionTraits<Func>::arg_tuple_type>::type;
+    using Table = MemoTable<KeyType, ReturnType, Insertable, ReadMostly>;
+
+    using Front = FrontTier<KeyType, ReturnType>;
 
     explicit MemoizedFunc(Func func, Insertable cache_policy = Insertable())
+        : func_(func), table_(std::make_shared<Table>(cache_policy)) {}
+
+    // With a FrontTier of front_slots entries per thread.
+    MemoizedFunc(Func func, Insertable cache_policy, size_t front_slots)
         : func_(func),
-          cache_policy_(cache_policy),
-          mutex_(std::make_shared<std::mutex>()) {}
+          front_(std::make_shared<Front>(front_slots)),
+          table_(std::make_shared<Table>(cache_policy)) {
+      table_->SetRemovalObserver(&front_->generations());
+    }
 
+    // A hit probes with references to the arguments and copies nothing;
+    // the key is only built on a miss, before args are forwarded to func.
     template <typename... Args>
-    ReturnType operator()(Args... args) {
-      std::lock_guard<std::mutex> lock(*mutex_);
-
-      using KeyType = std::tuple<Args...>;
-      using ResultType = ReturnType;
-
-      KeyType key = std::make_tuple(args...);
-      auto it = cache_.find(key);
-      if (it == cache_.end()) {
-        LOG("Cache miss");
-        ResultType result = func_(args...);
-        cache_policy_.Insert(&cache_, key,
-                             std::make_shared<ResultType>(result));
-        return result;
+    ReturnType operator()(Args&&... args) {
+      typename utils::immutable::ProbeTuple<KeyType, Args...>::type probe(
+          args...);
+      uint64_t hash = Table::CacheType::HashOf(probe);
+      auto compute = [&]() {
+        return utils::traits::Invoke(func_, std::forward<Args>(args)...);
+      };
+      if (!front_) {
+        return table_->GetOrCompute(probe, hash, compute);
       }
-      LOG("Cache hit");
-      const auto value = it->second;
-      cache_policy_.Insert(&cache_, key, value);
-      return *std::static_pointer_cast<ResultType>(value);
+      // Read before the table, so a removal racing with the lookup leaves
+      // the front entry stale rather than serving an evicted value.
+      uint64_t generation = front_->Generation(hash);
+      const ReturnType* cached = front_->Local().Find(probe, hash, generation);
+      if (cached != nullptr) {
+        return *cached;
+      }
+      // Copied before compute may move from args.
+      KeyType key(probe);
+      ReturnType result = table_->GetOrCompute(probe, hash, compute);
+      // compute may have reentered Local() and replaced this thread's
+      // FrontCache, so look it up again.
+      front_->Local().Fill(std::move(key), result, hash, generation);
+      return result;
+    }
+
+    // operator() for each argument tuple in args, which may be any range of
+    // tuples convertible to KeyType. All lookups share one lock
+    // acquisition, and misses run on executor when one is given; see
+    // MemoTable::GetOrComputeBatch. Results are in args' order.
+    template <typename Range>
+    std::vector<ReturnType> Batch(
+        const Range& args,
+        const concurrency::Executor& executor = concurrency::Executor()) {
+      std::vector<KeyType> keys(std::begin(args), std::end(args));
+      return table_->GetOrComputeBatch(
+          keys,
+          [this](const KeyType& key) {
+            return utils::immutable::Apply(func_, key);
+          },
+          executor);
     }
 
+    size_t CacheSize() const { return table_->Size(); }
+
+    size_t CacheWeight() const { return table_->Weight(); }
+
+    // Hits, misses, removals and load times so far; see MemoTable::Stats.
+    cache::CacheStats Stats() const { return table_->Stats(); }
+
+    // Opts in to a histogram of load times, read back with LoadLatency.
+    void EnableLoadLatency() const { table_->EnableLoadLatency(); }
+
+    LatencySnapshot LoadLatency() const { return table_->LoadLatency(); }
+
    private:
     Func func_;
-    Insertable cache_policy_;
-    side_effects::cache::Cache<ArgTupleType, ReturnType> cache_;
-    std::shared_ptr<std::mutex> mutex_;
+    std::shared_ptr<Front> front_;  // Null unless MemoizeWithFrontCache.
+    std::shared_ptr<Table> table_;  // Declared last: observes *front_.
+  };
+
+  template <typename Func, typename Insertable>
+  struct AsyncMemoizedFunc {
+    using ReturnType =
+        typename utils::traits::FunctionTraits<Func>::result_type;
+    using KeyType = typename utils::immutable::DecayTuple<
+        typename utils::traits::FunctionTraits<Func>::arg_tuple_type>::type;
+    using Table = MemoTable<KeyType, ReturnType, Insertable>;
+
+    AsyncMemoizedFunc(Func func, Insertable cache_policy,
+                      concurrency::Executor executor)
+        : func_(std::make_shared<Func>(func)),
+          executor_(std::move(executor)),
+          table_(std::make_shared<Table>(cache_policy)) {}
+
+    // The arguments are copied into the key on a miss; the computation runs
+    // on that copy, so it may outlive them.
+    template <typename... Args>
+    std::shared_future<ReturnType> operator()(Args&&... args) {
+      typename utils::immutable::ProbeTuple<KeyType, Args...>::type probe(
+          args...);
+      std::shared_ptr<Func> func = func_;
+      return table_->GetOrComputeAsync(
+          probe, Table::CacheType::HashOf(probe),
+          [func](const KeyType& key) {
+            return utils::immutable::Apply(*func, key);
+          },
+          executor_);
+    }
+
+    size_t CacheSize() const { return table_->Size(); }
+
+    size_t CacheWeight() const { return table_->Weight(); }
+
+    cache::CacheStats Stats() const { return table_->Stats(); }
+
+   private:
+    std::shared_ptr<Func> func_;
+    concurrency::Executor executor_;
+    std::shared_ptr<Table> table_;
+  };
+
+  template <typename Func, typename Insertable>
+  struct RecursiveMemoizedFunc {
+    using ReturnType =
+        typename utils::traits::FunctionTraits<Func>::result_type;
+    using KeyType = typename utils::immutable::DecayTuple<
+        typename utils::traits::FunctionTraits<Func>::arg_tuple_type>::type;
+    using Table =
+        typename internal::TableFor<KeyType, ReturnType, Insertable>::type;
+    using Body = internal::RecursiveBody<Func, Table>;
+
+    template <typename BodyFunc>
+    RecursiveMemoizedFunc(BodyFunc body, Insertable cache_policy)
+        : body_(std::make_shared<Body>(
+              body, std::make_shared<Table>(cache_policy))) {}
+
+    template <typename... Args>
+    ReturnType operator()(Args&&... args) const {
+      return body_->self()(std::forward<Args>(args)...);
+    }
+
+    size_t CacheSize() const { return body_->table().Size(); }
+
+    size_t CacheWeight() const { return body_->table().Weight(); }
+
+    cache::CacheStats Stats() const { return body_->table().Stats(); }
+
+   private:
+    std::shared_ptr<Body> body_;
+  };
+
+  template <typename Func, typename... Ranges>
+  struct DenseMemoizedFunc {
+    using ReturnType =
+        typename utils::traits::FunctionTraits<Func>::result_type;
+    using KeyType = typename utils::immutable::DecayTuple<
+        typename utils::traits::FunctionTraits<Func>::arg_tuple_type>::type;
+    using Table = DenseTable<ReturnType, Ranges...>;
+
+    DenseMemoizedFunc(Func func, DenseBounds<Ranges...> bounds)
+        : func_(func), table_(std::make_shared<Table>(bounds)) {}
+
+    // Throws std::out_of_range for arguments outside their DenseRange.
+    template <typename... Args>
+    ReturnType operator()(Args&&... args) {
+      size_t index = Table::IndexOf(args...);
+      const ReturnType* cached = table_->Find(index);
+      if (cached != nullptr) {
+        return *cached;
+      }
+      return table_->Load(index, [&]() {
+        return utils::traits::Invoke(func_, std::forward<Args>(args)...);
+      });
+    }
+
+    // As MemoizedFunc::Batch; see DenseTable::GetOrComputeBatch.
+    template <typename Range>
+    std::vector<ReturnType> Batch(
+        const Range& args,
+        const concurrency::Executor& executor = concurrency::Executor()) {
+      std::vector<KeyType> keys(std::begin(args), std::end(args));
+      return table_->GetOrComputeBatch(
+          keys,
+          [this](const KeyType& key) {
+            return utils::immutable::Apply(func_, key);
+          },
+          executor);
+    }
+
+    size_t CacheSize() const { return table_->Size(); }
+
+    size_t CacheWeight() const { return table_->Weight(); }
+
+    cache::CacheStats Stats() const { return table_->Stats(); }
+
+    void EnableLoadLatency() const { table_->EnableLoadLatency(); }
+
+    LatencySnapshot LoadLatency() const { return table_->LoadLatency(); }
+
+   private:
+    Func func_;
+    std::shared_ptr<Table> table_;
+  };
+
+  template <typename Func, typename Insertable>
+  struct ShardedMemoizedFunc {
+    using ReturnType =
+        typename utils::traits::FunctionTraits<Func>::result_type;
+    using KeyType = typename utils::immutable::DecayTuple<
+        typename utils::traits::FunctionTraits<Func>::arg_tuple_type>::type;
+    using Table = MemoTable<KeyType, ReturnType, Insertable>;
+
+    ShardedMemoizedFunc(Func func, const std::vector<Insertable>& policies)
+        : func_(func) {
+      for (const auto& policy : policies) {
+        shards_.push_back(std::make_shared<Table>(policy));
+      }
+    }
+
+    template <typename... Args>
+    ReturnType operator()(Args&&... args) {
+      typename utils::immutable::ProbeTuple<KeyType, Args...>::type probe(
+          args...);
+      uint64_t hash = Table::CacheType::HashOf(probe);
+      return ShardFor(hash).GetOrCompute(probe, hash, [&]() {
+        return utils::traits::Invoke(func_, std::forward<Args>(args)...);
+      });
+    }
+
+    // Batch on each shard in turn, for the arguments that map to it. If a
+    // shard's batch throws, later shards are not looked up.
+    template <typename Range>
+    std::vector<ReturnType> Batch(
+        const Range& args,
+        const concurrency::Executor& executor = concurrency::Executor()) {
+      std::vector<std::vector<KeyType>> keys(shards_.size());
+      std::vector<std::vector<size_t>> positions(shards_.size());
+      size_t count = 0;
+      for (const auto& arg : args) {
+        KeyType key(arg);
+        size_t shard = ShardIndex(Table::CacheType::HashOf(key));
+        keys[shard].push_back(std::move(key));
+        positions[shard].push_back(count++);
+      }
+      internal::BatchResults<ReturnType> results(count);
+      for (size_t shard = 0; shard < shards_.size(); ++shard) {
+        if (keys[shard].empty()) {
+          continue;
+        }
+        std::vector<ReturnType> values = shards_[shard]->GetOrComputeBatch(
+            keys[shard],
+            [this](const KeyType& key) {
+              return utils::immutable::Apply(func_, key);
+            },
+            executor);
+        for (size_t i = 0; i < values.size(); ++i) {
+          results.Set(positions[shard][i], std::move(values[i]));
+        }
+      }
+      return results.Take();
+    }
+
+    size_t ShardCount() const { return shards_.size(); }
+
+    size_t CacheSize() const {
+      size_t size = 0;
+      for (const auto& shard : shards_) {
+        size += shard->Size();
+      }
+      return size;
+    }
+
+    size_t CacheWeight() const {
+      size_t weight = 0;
+      for (const auto& shard : shards_) {
+        weight += shard->Weight();
+      }
+      return weight;
+    }
+
+    // Summed over the shards.
+    cache::CacheStats Stats() const {
+      cache::CacheStats stats;
+      for (const auto& shard : shards_) {
+        stats += shard->Stats();
+      }
+      return stats;
+    }
+
+    void EnableLoadLatency() const {
+      for (const auto& shard : shards_) {
+        shard->EnableLoadLatency();
+      }
+    }
+
+    LatencySnapshot LoadLatency() const {
+      LatencySnapshot latency;
+      for (const auto& shard : shards_) {
+        latency += shard->LoadLatency();
+      }
+      return latency;
+    }
+
+   private:
+    // The shard comes from the high half of the hash; the table inside it
+    // uses the low bits, so the two choices stay independent.
+    size_t ShardIndex(uint64_t hash) const {
+      return (hash >> 32) % shards_.size();
+    }
+
+    Table& ShardFor(uint64_t hash) { return *shards_[ShardIndex(hash)]; }
+
+    Func func_;
+    std::vector<std::shared_ptr<Table>> shards_;
   };
 };
 
@@ -0,0 +1,215 @@
+/*
+ * Copyright (C) 2024  OverbearingPearl
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ * The above copyright notice and this permission notice shall be included in
+ * all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+ * THE SOFTWARE.
+ */
+
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+#include <cstring>
+#include <functional>
+#include <string>
+#include <tuple>
+#include <type_traits>
+#include <utility>
+#include <vector>
+
+namespace utils {
+namespace immutable {
+
+constexpr uint64_t kHashSeed = 0xA0761D6478BD642FULL;
+constexpr uint64_t kHashSecret1 = 0xE7037ED1A0B428DBULL;
+constexpr uint64_t kHashSecret2 = 0x8EBC6AF09C88C6E3ULL;
+constexpr uint64_t kHashSecret3 = 0x589965CC75374CC3ULL;
+
+// Full 64x64->128 bit multiply folded back to 64 bits; the mixing step of
+// wyhash.
+inline uint64_t MultiplyFold(uint64_t a, uint64_t b) {
+#if defined(__SIZEOF_INT128__)
+  __uint128_t product = static_cast<__uint128_t>(a) * b;
+  return static_cast<uint64_t>(product) ^ static_cast<uint64_t>(product >> 64);
+#else
+  uint64_t a_high = a >> 32, a_low = static_cast<uint32_t>(a);
+  uint64_t b_high = b >> 32, b_low = static_cast<uint32_t>(b);
+  uint64_t high = a_high * b_high, middle1 = a_high * b_low;
+  uint64_t middle2 = b_high * a_low, low = a_low * b_low;
+  uint64_t sum = low + (middle1 << 32);
+  uint64_t carry = sum < low;
+  uint64_t result_low = sum + (middle2 << 32);
+  carry += result_low < sum;
+  uint64_t result_high = high + (middle1 >> 32) + (middle2 >> 32) + carry;
+  return result_low ^ result_high;
+#endif
+}
+
+// Folds a 64-bit value into a running hash.
+inline uint64_t HashMix(uint64_t value, uint64_t seed) {
+  return MultiplyFold(value ^ kHashSeed, seed ^ kHashSecret1);
+}
+
+namespace internal {
+
+inline uint64_t Read64(const uint8_t* bytes) {
+  uint64_t value;
+  std::memcpy(&value, bytes, sizeof(value));
+  return value;
+}
+
+inline uint64_t Read32(const uint8_t* bytes) {
+  uint32_t value;
+  std::memcpy(&value, bytes, sizeof(value));
+  return value;
+}
+
+}  // namespace internal
+
+// Hashes a contiguous byte range in one pass, 48 bytes per round on long
+// inputs (wyhash's construction).
+inline uint64_t HashBytes(const void* data, size_t size, uint64_t seed) {
+  const uint8_t* bytes = static_cast<const uint8_t*>(data);
+  seed ^= MultiplyFold(seed ^ kHashSeed, kHashSecret1);
+  uint64_t a = 0;
+  uint64_t b = 0;
+  if (size <= 16) {
+    if (size >= 4) {
+      size_t middle = (size >> 3) << 2;
+      a = (internal::Read32(bytes) << 32) | internal::Read32(bytes + middle);
+      b = (internal::Read32(bytes + size - 4) << 32) |
+          internal::Read32(bytes + size - 4 - middle);
+    } else if (size > 0) {
+      a = (static_cast<uint64_t>(bytes[0]) << 16) |
+          (static_cast<uint64_t>(bytes[size >> 1]) << 8) | bytes[size - 1];
+    }
+  } else {
+    size_t remaining = size;
+    if (remaining > 48) {
+      uint64_t lane1 = seed;
+      uint64_t lane2 = seed;
+      do {
+        seed = MultiplyFold(internal::Read64(bytes) ^ kHashSecret1,
+                            internal::Read64(bytes + 8) ^ seed);
+        lane1 = MultiplyFold(internal::Read64(bytes + 16) ^ kHashSecret2,
+                             internal::Read64(bytes + 24) ^ lane1);
+        lane2 = MultiplyFold(internal::Read64(bytes + 32) ^ kHashSecret3,
+                             internal::Read64(bytes + 40) ^ lane2);
+        bytes += 48;
+        remaining -= 48;
+      } while (remaining > 48);
+      seed ^= lane1 ^ lane2;
+    }
+    while (remaining > 16) {
+      seed = MultiplyFold(internal::Read64(bytes) ^ kHashSecret1,
+                          internal::Read64(bytes + 8) ^ seed);
+      bytes += 16;
+      remaining -= 16;
+    }
+    a = internal::Read64(bytes + remaining - 16);
+    b = internal::Read64(bytes + remaining - 8);
+  }
+  return MultiplyFold(kHashSecret1 ^ size,
+                      MultiplyFold(a ^ kHashSecret1, b ^ seed));
+}
+
+// Customization point. Specialize Hasher<T> with
+//   static uint64_t Hash(const T& value, uint64_t seed);
+// to hash a user type; the result must be equal for values that compare
+// equal. Types without a specialization fall back to std::hash.
+template <typename T, typename Enable = void>
+struct Hasher {
+  static uint64_t Hash(const T& value, uint64_t seed) {
+    return HashMix(static_cast<uint64_t>(std::hash<T>()(value)), seed);
+  }
+};
+
+template <typename T>
+uint64_t HashValue(const T& value, uint64_t seed = kHashSeed) {
+  return Hasher<T>::Hash(value, seed);
+}
+
+template <typename T>
+struct Hasher<T, typename std::enable_if<std::is_integral<T>::value ||
+                                         std::is_enum<T>::value>::type> {
+  static uint64_t Hash(T value, uint64_t seed) {
+    return HashMix(static_cast<uint64_t>(value), seed);
+  }
+};
+
+template <typename T>
+struct Hasher<T*> {
+  static uint64_t Hash(T* value, uint64_t seed) {
+    return HashMix(reinterpret_cast<uintptr_t>(value), seed);
+  }
+};
+
+template <typename T>
+struct Hasher<T, typename std::enable_if<
+                     std::is_floating_point<T>::value>::type> {
+  static uint64_t Hash(T value, uint64_t seed) {
+    if (value == 0) {
+      value = 0;  // -0.0 == 0.0, so they must hash alike.
+    }
+    return HashBytes(&value, sizeof(value), seed);
+  }
+};
+
+template <typename CharT, typename Traits, typename Allocator>
+struct Hasher<std::basic_string<CharT, Traits, Allocator>> {
+  static uint64_t Hash(const std::basic_string<CharT, Traits, Allocator>& value,
+                       uint64_t seed) {
+    return HashBytes(value.data(), value.size() * sizeof(CharT), seed);
+  }
+};
+
+// Vectors of integers are hashed as one byte range; others element by element.
+template <typename T, typename Allocator>
+struct Hasher<std::vector<T, Allocator>> {
+  static uint64_t Hash(const std::vector<T, Allocator>& value, uint64_t seed) {
+    return HashElements(value, seed,
+                        std::integral_constant<bool,
+                                               std::is_integral<T>::value &&
+                                                   !std::is_same<T, bool>::value>());
+  }
+
+ private:
+  static uint64_t HashElements(const std::vector<T, Allocator>& value,
+                               uint64_t seed, std::true_type) {
+    return HashBytes(value.data(), value.size() * sizeof(T), seed);
+  }
+
+  static uint64_t HashElements(const std::vector<T, Allocator>& value,
+                               uint64_t seed, std::false_type) {
+    seed = HashMix(value.size(), seed);
+    for (const auto& element : value) {
+      seed = Hasher<T>::Hash(element, seed);
+    }
+    return seed;
+  }
+};
+
+template <typename First, typename Second>
+struct Hasher<std::pair<First, Second>> {
+  static uint64_t Hash(const std::pair<First, Second>& value, uint64_t seed) {
+    return Hasher<Second>::Hash(value.second,
+                                Hasher<First>::Hash(value.first, seed));
+  }
+};
+
+}  // namespace immutable
+}  // namespace utils
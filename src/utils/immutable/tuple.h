@@ -21,57 +21,166 @@
 
 #pragma once
 
-#include <functional>
+#include <cstddef>
+#include <cstdint>
+#include <cstring>
+#include <string>
 #include <tuple>
+#include <type_traits>
+#include <utility>
+
+#include "src/utils/immutable/hash.h"
+#include "src/utils/traits/func_traits.h"
 
 namespace utils {
 namespace immutable {
 
+// Folds every element into the running hash with its Hasher, so tuples of
+// references or views hash like the tuple of values they stand for.
 struct TupleHash {
   template <typename... Args>
   std::size_t operator()(const std::tuple<Args...>& t) const {
-    return HashTuple(t);
+    return static_cast<std::size_t>(HashTuple(t, kHashSeed));
+  }
+
+  template <typename Tuple>
+  static uint64_t HashTuple(const Tuple& t, uint64_t seed) {
+    return Folder<Tuple>::Fold(t, seed);
   }
 
  private:
-  template <typename Tuple,
-            std::size_t Index = std::tuple_size<Tuple>::value - 1>
-  struct Hasher {
-    std::size_t operator()(const Tuple& t) const {
-      std::size_t hash = Hasher<Tuple, Index - 1>()(t);
-      TupleHash::HashCombine(&hash, std::get<Index>(t));
-      return hash;
+  template <typename Tuple, std::size_t Size = std::tuple_size<Tuple>::value>
+  struct Folder {
+    static uint64_t Fold(const Tuple& t, uint64_t seed) {
+      using Element = typename std::decay<
+          typename std::tuple_element<Size - 1, Tuple>::type>::type;
+      return Hasher<Element>::Hash(std::get<Size - 1>(t),
+                                   Folder<Tuple, Size - 1>::Fold(t, seed));
     }
   };
 
   template <typename Tuple>
-  struct Hasher<Tuple, 0> {
-    std::size_t operator()(const Tuple& t) const {
-      std::size_t hash = 0;
-      TupleHash::HashCombine(&hash, std::get<0>(t));
-      return hash;
-    }
+  struct Folder<Tuple, 0> {
+    static uint64_t Fold(const Tuple&, uint64_t seed) { return seed; }
   };
+};
 
-  template <typename Tuple>
-  std::size_t HashTuple(const Tuple& t) const {
-    return Hasher<Tuple>()(t);
-  }
-
-  template <typename T>
-  static void HashCombine(std::size_t* seed, const T& value) {
-    std::hash<T> hasher;
-    *seed ^= hasher(value) + 0x9e3779b9 + (*seed << 6) + (*seed >> 2);
+template <typename... Args>
+struct Hasher<std::tuple<Args...>> {
+  static uint64_t Hash(const std::tuple<Args...>& value, uint64_t seed) {
+    return TupleHash::HashTuple(value, seed);
   }
 };
 
+// Element types may differ as long as they compare equal element-wise, so a
+// key tuple can be compared against a ProbeTuple without building a key.
 struct TupleEqual {
-  template <typename... Args>
-  bool operator()(const std::tuple<Args...>& t1,
-                  const std::tuple<Args...>& t2) const {
+  template <typename... Args1, typename... Args2>
+  bool operator()(const std::tuple<Args1...>& t1,
+                  const std::tuple<Args2...>& t2) const {
     return t1 == t2;
   }
 };
 
+// Non-owning view of a C string, used to probe std::string keys without
+// allocating (C++11 has no std::string_view). Hashes like std::string.
+struct StringRef {
+  StringRef(const char* chars) : data(chars), size(std::strlen(chars)) {}
+
+  operator std::string() const { return std::string(data, size); }
+
+  const char* data;
+  std::size_t size;
+};
+
+inline bool operator==(const std::string& lhs, const StringRef& rhs) {
+  return lhs.size() == rhs.size &&
+         lhs.compare(0, lhs.size(), rhs.data, rhs.size) == 0;
+}
+
+inline bool operator==(const StringRef& lhs, const std::string& rhs) {
+  return rhs == lhs;
+}
+
+template <>
+struct Hasher<StringRef> {
+  static uint64_t Hash(const StringRef& value, uint64_t seed) {
+    return HashBytes(value.data, value.size, seed);
+  }
+};
+
+// Tuple of the decayed element types, suitable for storing as a cache key
+// even when the function takes its arguments by reference.
+template <typename Tuple>
+struct DecayTuple;
+
+template <typename... Elements>
+struct DecayTuple<std::tuple<Elements...>> {
+  using type = std::tuple<typename std::decay<Elements>::type...>;
+};
+
+// How a call argument of type Arg looks up a key element of type Element: by
+// const reference when the types match, so nothing is copied, otherwise by a
+// converted value.
+template <typename Element, typename Arg>
+struct ProbeElement {
+  using type = typename std::conditional<
+      std::is_same<typename std::decay<Arg>::type, Element>::value,
+      const Element&, Element>::type;
+};
+
+// C strings probe std::string keys through a StringRef.
+template <typename Arg>
+struct ProbeElement<std::string, Arg> {
+  using Decayed = typename std::decay<Arg>::type;
+  using type = typename std::conditional<
+      std::is_same<Decayed, std::string>::value, const std::string&,
+      typename std::conditional<std::is_same<Decayed, const char*>::value ||
+                                    std::is_same<Decayed, char*>::value,
+                                StringRef, std::string>::type>::type;
+};
+
+// Tuple used to look up a KeyTuple from call arguments Args. It hashes and
+// compares like the key it stands for.
+template <typename KeyTuple, typename... Args>
+struct ProbeTuple;
+
+template <typename... Elements, typename... Args>
+struct ProbeTuple<std::tuple<Elements...>, Args...> {
+  using type = std::tuple<typename ProbeElement<Elements, Args>::type...>;
+};
+
+// C++11 stand-ins for std::index_sequence and std::apply.
+template <std::size_t... Indices>
+struct IndexSequence {};
+
+template <std::size_t Size, std::size_t... Indices>
+struct MakeIndexSequence : MakeIndexSequence<Size - 1, Size - 1, Indices...> {};
+
+template <std::size_t... Indices>
+struct MakeIndexSequence<0, Indices...> {
+  using type = IndexSequence<Indices...>;
+};
+
+template <typename Func, typename Tuple, std::size_t... Indices>
+auto ApplyIndexed(Func&& func, Tuple&& t, IndexSequence<Indices...>)
+    -> decltype(traits::Invoke(std::forward<Func>(func),
+                               std::get<Indices>(std::forward<Tuple>(t))...)) {
+  return traits::Invoke(std::forward<Func>(func),
+                        std::get<Indices>(std::forward<Tuple>(t))...);
+}
+
+// Calls func with the elements of t as arguments (see traits::Invoke).
+template <typename Func, typename Tuple>
+auto Apply(Func&& func, Tuple&& t) -> decltype(ApplyIndexed(
+    std::forward<Func>(func), std::forward<Tuple>(t),
+    typename MakeIndexSequence<
+        std::tuple_size<typename std::decay<Tuple>::type>::value>::type())) {
+  return ApplyIndexed(
+      std::forward<Func>(func), std::forward<Tuple>(t),
+      typename MakeIndexSequence<
+          std::tuple_size<typename std::decay<Tuple>::type>::value>::type());
+}
+
 }  // namespace immutable
 }  // namespace utils
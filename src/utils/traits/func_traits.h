@@ -23,24 +23,117 @@
 
 #include <functional>
 #include <tuple>
+#include <type_traits>
+#include <utility>
 
 namespace utils {
 namespace traits {
 
+// result_type and arg_tuple_type of a callable with one signature: a
+// function, function pointer or reference, member function pointer (whose
+// object comes first, as a pointer), or a class with a single, non-template
+// operator() such as a lambda, functor or std::function. Generic lambdas
+// and overloaded functors have no single signature and are rejected.
 template <typename Func>
 struct FunctionTraits;
 
+namespace internal {
+
 template <typename ReturnType, typename... Args>
-struct FunctionTraits<std::function<ReturnType(Args...)>> {
+struct Signature {
   using result_type = ReturnType;
   using arg_tuple_type = std::tuple<Args...>;
 };
 
+// Signature of a call operator, without its class.
+template <typename CallOperator>
+struct CallOperatorTraits;
+
 template <typename ReturnType, typename ClassType, typename... Args>
-struct FunctionTraits<ReturnType (ClassType::*)(Args...)> {
-  using result_type = ReturnType;
-  using arg_tuple_type = std::tuple<ClassType*, Args...>;
-};
+struct CallOperatorTraits<ReturnType (ClassType::*)(Args...)>
+    : Signature<ReturnType, Args...> {};
+
+template <typename ReturnType, typename ClassType, typename... Args>
+struct CallOperatorTraits<ReturnType (ClassType::*)(Args...) const>
+    : Signature<ReturnType, Args...> {};
+
+#if defined(__cpp_noexcept_function_type)
+template <typename ReturnType, typename ClassType, typename... Args>
+struct CallOperatorTraits<ReturnType (ClassType::*)(Args...) noexcept>
+    : Signature<ReturnType, Args...> {};
+
+template <typename ReturnType, typename ClassType, typename... Args>
+struct CallOperatorTraits<ReturnType (ClassType::*)(Args...) const noexcept>
+    : Signature<ReturnType, Args...> {};
+#endif
+
+}  // namespace internal
+
+template <typename Func>
+struct FunctionTraits
+    : internal::CallOperatorTraits<decltype(&Func::operator())> {};
+
+template <typename Func>
+struct FunctionTraits<const Func> : FunctionTraits<Func> {};
+
+template <typename Func>
+struct FunctionTraits<Func&> : FunctionTraits<Func> {};
+
+template <typename Func>
+struct FunctionTraits<Func&&> : FunctionTraits<Func> {};
+
+template <typename ReturnType, typename... Args>
+struct FunctionTraits<ReturnType(Args...)>
+    : internal::Signature<ReturnType, Args...> {};
+
+template <typename ReturnType, typename... Args>
+struct FunctionTraits<ReturnType (*)(Args...)>
+    : internal::Signature<ReturnType, Args...> {};
+
+template <typename ReturnType, typename... Args>
+struct FunctionTraits<std::function<ReturnType(Args...)>>
+    : internal::Signature<ReturnType, Args...> {};
+
+template <typename ReturnType, typename ClassType, typename... Args>
+struct FunctionTraits<ReturnType (ClassType::*)(Args...)>
+    : internal::Signature<ReturnType, ClassType*, Args...> {};
+
+template <typename ReturnType, typename ClassType, typename... Args>
+struct FunctionTraits<ReturnType (ClassType::*)(Args...) const>
+    : internal::Signature<ReturnType, const ClassType*, Args...> {};
+
+#if defined(__cpp_noexcept_function_type)
+template <typename ReturnType, typename... Args>
+struct FunctionTraits<ReturnType(Args...) noexcept>
+    : internal::Signature<ReturnType, Args...> {};
+
+template <typename ReturnType, typename... Args>
+struct FunctionTraits<ReturnType (*)(Args...) noexcept>
+    : internal::Signature<ReturnType, Args...> {};
+
+template <typename ReturnType, typename ClassType, typename... Args>
+struct FunctionTraits<ReturnType (ClassType::*)(Args...) noexcept>
+    : internal::Signature<ReturnType, ClassType*, Args...> {};
+
+template <typename ReturnType, typename ClassType, typename... Args>
+struct FunctionTraits<ReturnType (ClassType::*)(Args...) const noexcept>
+    : internal::Signature<ReturnType, const ClassType*, Args...> {};
+#endif
+
+// C++11 stand-in for std::invoke: calls func with args, or, for a member
+// function pointer, calls it on the object the first argument points to.
+template <typename Func, typename... Args>
+auto Invoke(Func&& func, Args&&... args)
+    -> decltype(std::forward<Func>(func)(std::forward<Args>(args)...)) {
+  return std::forward<Func>(func)(std::forward<Args>(args)...);
+}
+
+template <typename MemberFunc, typename Object, typename... Args>
+auto Invoke(MemberFunc func, Object&& object, Args&&... args)
+    -> decltype(((*std::forward<Object>(object)).*
+                 func)(std::forward<Args>(args)...)) {
+  return ((*std::forward<Object>(object)).*func)(std::forward<Args>(args)...);
+}
 
 }  // namespace traits
 }  // namespace utils
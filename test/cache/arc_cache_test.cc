@@ -0,0 +1,87 @@
+/*
+ * Copyright (C) 2024  OverbearingPearl
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ * The above copyright notice and this permission notice shall be included in
+ * all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+ * THE SOFTWARE.
+ */
+
+#include <gtest/gtest.h>
+
+#include <tuple>
+
+#include "src/side_effects/cache/cache_arc.h"
+#include "src/side_effects/cache/cache_lru.h"
+#include "test/cache/hit_ratio.h"
+
+namespace {
+
+using IntArcPolicy =
+    side_effects::cache::CacheWithArcPolicy<std::tuple<int>, int>;
+using IntLruPolicy =
+    side_effects::cache::CacheWithLruPolicy<std::tuple<int>, int>;
+using IntCache = IntArcPolicy::CacheType;
+
+void Put(IntArcPolicy* policy, IntCache* cache, int key) {
+  policy->Insert(cache, std::make_tuple(key), key);
+}
+
+}  // namespace
+
+TEST(Cache, PolicyArc_ScanOfNewKeys_KeepsKeysHitTwice) {
+  IntArcPolicy policy(4);
+  IntCache cache;
+  Put(&policy, &cache, 1);
+  Put(&policy, &cache, 2);
+  policy.Get(&cache, std::make_tuple(1));
+  policy.Get(&cache, std::make_tuple(2));
+  for (int key = 100; key < 120; ++key) {
+    Put(&policy, &cache, key);
+  }
+  EXPECT_EQ(cache.size(), 4);
+  EXPECT_EQ(cache.count(std::make_tuple(1)), 1);
+  EXPECT_EQ(cache.count(std::make_tuple(2)), 1);
+}
+
+TEST(Cache, PolicyArc_RecentGhostHit_GrowsRecencyTarget) {
+  IntArcPolicy policy(2);
+  IntCache cache;
+  Put(&policy, &cache, 1);
+  policy.Get(&cache, std::make_tuple(1));
+  Put(&policy, &cache, 2);
+  Put(&policy, &cache, 3);  // Evicts 2 into the recency ghosts.
+  EXPECT_EQ(cache.count(std::make_tuple(2)), 0);
+  EXPECT_EQ(policy.RecentTarget(), 0);
+  Put(&policy, &cache, 2);
+  EXPECT_EQ(policy.RecentTarget(), 1);
+  EXPECT_EQ(cache.size(), 2);
+}
+
+TEST(Cache, PolicyArc_LoopWithScans_KeepsLoopResident) {
+  auto trace = cache_test::WithScans(cache_test::LoopTrace(300, 200), 600,
+                                     1000, 1000000);
+  double lru = cache_test::HitRatio(IntLruPolicy(500), trace);
+  double arc = cache_test::HitRatio(IntArcPolicy(500), trace);
+  EXPECT_GT(arc, lru * 1.5);
+}
+
+TEST(Cache, PolicyArc_ZipfWithScans_BeatsLru) {
+  auto trace = cache_test::WithScans(
+      cache_test::ZipfTrace(100000, 1000, 0.9, 1), 2000, 1000, 1000000);
+  double lru = cache_test::HitRatio(IntLruPolicy(500), trace);
+  double arc = cache_test::HitRatio(IntArcPolicy(500), trace);
+  EXPECT_GT(arc, lru + 0.05);
+}
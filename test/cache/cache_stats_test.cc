@@ -0,0 +1,126 @@
+/*
+ * Copyright (C) 2024  OverbearingPearl
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ * The above copyright notice and this permission notice shall be included in
+ * all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+ * THE SOFTWARE.
+ */
+
+#include <gtest/gtest.h>
+
+#include <chrono>
+#include <thread>
+#include <tuple>
+
+#include "src/side_effects/cache/cache_clock.h"
+#include "src/side_effects/cache/cache_flush.h"
+#include "src/side_effects/cache/cache_lru.h"
+#include "src/side_effects/cache/cache_stats.h"
+#include "src/side_effects/cache/cache_ttl.h"
+
+namespace {
+
+using side_effects::cache::RemovalCause;
+
+using IntLruPolicy =
+    side_effects::cache::CacheWithLruPolicy<std::tuple<int>, int>;
+
+}  // namespace
+
+TEST(Cache, Stats_HitsAndMisses_Counted) {
+  IntLruPolicy policy(4);
+  IntLruPolicy::CacheType cache;
+  policy.Insert(&cache, std::make_tuple(1), 1);
+  policy.Get(&cache, std::make_tuple(1));
+  policy.Get(&cache, std::make_tuple(1));
+  policy.Get(&cache, std::make_tuple(2));
+  side_effects::cache::CacheStats stats = policy.Stats(cache);
+  EXPECT_EQ(stats.hits, 2);
+  EXPECT_EQ(stats.misses, 1);
+  EXPECT_EQ(stats.inserts, 1);
+  EXPECT_EQ(stats.size, 1);
+  EXPECT_EQ(stats.weight, 1);
+  EXPECT_DOUBLE_EQ(stats.HitRatio(), 2.0 / 3);
+}
+
+TEST(Cache, Stats_Removals_AttributedToCause) {
+  IntLruPolicy policy(2);
+  IntLruPolicy::CacheType cache;
+  policy.Insert(&cache, std::make_tuple(1), 1);
+  policy.Insert(&cache, std::make_tuple(2), 2);
+  policy.Insert(&cache, std::make_tuple(3), 3);
+  policy.Insert(&cache, std::make_tuple(3), 30);
+  policy.Erase(&cache, std::make_tuple(2));
+  side_effects::cache::CacheStats stats = policy.Stats(cache);
+  EXPECT_EQ(stats.inserts, 4);
+  EXPECT_EQ(stats.Removals(RemovalCause::kCapacity), 1);
+  EXPECT_EQ(stats.Removals(RemovalCause::kReplaced), 1);
+  EXPECT_EQ(stats.Removals(RemovalCause::kExplicit), 1);
+  EXPECT_EQ(stats.Removals(RemovalCause::kExpired), 0);
+  EXPECT_EQ(stats.size, 1);
+}
+
+TEST(Cache, Stats_FlushPolicy_CountsEveryFlushedEntry) {
+  side_effects::cache::CacheWithFlushPolicy<std::tuple<int>, int> policy(3);
+  decltype(policy)::CacheType cache;
+  for (int key = 0; key < 4; ++key) {
+    policy.Insert(&cache, std::make_tuple(key), key);
+  }
+  EXPECT_EQ(policy.Stats(cache).Removals(RemovalCause::kCapacity), 3);
+}
+
+TEST(Cache, Stats_TtlExpiry_CountedAsExpiredAndMiss) {
+  side_effects::cache::CacheWithTtlPolicy<std::tuple<int>, int> policy(
+      std::chrono::milliseconds(20));
+  decltype(policy)::CacheType cache;
+  policy.Insert(&cache, std::make_tuple(1), 1);
+  std::this_thread::sleep_for(std::chrono::milliseconds(40));
+  EXPECT_EQ(policy.Get(&cache, std::make_tuple(1)), nullptr);
+  side_effects::cache::CacheStats stats = policy.Stats(cache);
+  EXPECT_EQ(stats.misses, 1);
+  EXPECT_EQ(stats.hits, 0);
+  EXPECT_EQ(stats.Removals(RemovalCause::kExpired), 1);
+}
+
+TEST(Cache, Stats_SharedHits_CountedAcrossThreads) {
+  side_effects::cache::CacheWithClockPolicy<std::tuple<int>, int> policy(4);
+  decltype(policy)::CacheType cache;
+  policy.Insert(&cache, std::make_tuple(1), 1);
+  uint64_t hash = decltype(policy)::CacheType::HashOf(std::make_tuple(1));
+  std::thread threads[4];
+  for (auto& thread : threads) {
+    thread = std::thread([&]() {
+      for (int i = 0; i < 1000; ++i) {
+        policy.GetShared(cache, std::make_tuple(1), hash);
+      }
+    });
+  }
+  for (auto& thread : threads) {
+    thread.join();
+  }
+  EXPECT_EQ(policy.Stats(cache).hits, 4000);
+}
+
+TEST(Cache, Stats_CopiedPolicy_StartsFromZero) {
+  IntLruPolicy policy(4);
+  IntLruPolicy::CacheType cache;
+  policy.Insert(&cache, std::make_tuple(1), 1);
+  IntLruPolicy copy(policy);
+  IntLruPolicy::CacheType empty;
+  EXPECT_EQ(copy.Stats(empty).inserts, 0);
+  policy.ResetStats();
+  EXPECT_EQ(policy.Stats(cache).inserts, 0);
+}
@@ -0,0 +1,77 @@
+/*
+ * Copyright (C) 2024  OverbearingPearl
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ * The above copyright notice and this permission notice shall be included in
+ * all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+ * THE SOFTWARE.
+ */
+
+#include <gtest/gtest.h>
+
+#include <tuple>
+
+#include "src/side_effects/cache/cache_clock.h"
+#include "src/side_effects/cache/cache_lru.h"
+#include "test/cache/hit_ratio.h"
+
+namespace {
+
+using IntClockPolicy =
+    side_effects::cache::CacheWithClockPolicy<std::tuple<int>, int>;
+using IntCache = IntClockPolicy::CacheType;
+
+void Put(IntClockPolicy* policy, IntCache* cache, int key) {
+  policy->Insert(cache, std::make_tuple(key), key);
+}
+
+}  // namespace
+
+TEST(Cache, PolicyClock_CacheFull_SparesVisitedEntries) {
+  IntClockPolicy policy(3);
+  IntCache cache;
+  Put(&policy, &cache, 1);
+  Put(&policy, &cache, 2);
+  Put(&policy, &cache, 3);
+  policy.Get(&cache, std::make_tuple(1));
+  Put(&policy, &cache, 4);
+  EXPECT_EQ(cache.count(std::make_tuple(1)), 1);
+  EXPECT_EQ(cache.count(std::make_tuple(2)), 0);
+  Put(&policy, &cache, 5);
+  EXPECT_EQ(cache.count(std::make_tuple(1)), 1);
+  EXPECT_EQ(cache.count(std::make_tuple(3)), 0);
+  EXPECT_EQ(cache.size(), 3);
+}
+
+TEST(Cache, PolicyClock_EraseThenInsert_ReusesRingPosition) {
+  IntClockPolicy policy(2);
+  IntCache cache;
+  Put(&policy, &cache, 1);
+  Put(&policy, &cache, 2);
+  EXPECT_TRUE(policy.Erase(&cache, std::make_tuple(1)));
+  Put(&policy, &cache, 3);
+  Put(&policy, &cache, 4);
+  EXPECT_EQ(cache.size(), 2);
+  EXPECT_EQ(cache.count(std::make_tuple(4)), 1);
+}
+
+TEST(Cache, PolicyClock_ZipfTrace_HitRatioAtLeastLru) {
+  auto trace = cache_test::ZipfTrace(100000, 10000, 0.9, 1);
+  double lru = cache_test::HitRatio(
+      side_effects::cache::CacheWithLruPolicy<std::tuple<int>, int>(500),
+      trace);
+  double clock = cache_test::HitRatio(IntClockPolicy(500), trace);
+  EXPECT_GE(clock, lru - 0.01);
+}
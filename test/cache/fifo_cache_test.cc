@@ -0,0 +1,79 @@
+/*
+ * Copyright (C) 2024  OverbearingPearl
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ * The above copyright notice and this permission notice shall be included in
+ * all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+ * THE SOFTWARE.
+ */
+
+#include <gtest/gtest.h>
+
+#include <functional>
+#include <tuple>
+
+#include "src/side_effects/cache/cache_fifo.h"
+#include "src/side_effects/memoization/memoization.h"
+
+namespace {
+
+using IntFifoPolicy =
+    side_effects::cache::CacheWithFifoPolicy<std::tuple<int>, int>;
+using IntCache = IntFifoPolicy::CacheType;
+
+void Put(IntFifoPolicy* policy, IntCache* cache, int key) {
+  policy->Insert(cache, std::make_tuple(key), key);
+}
+
+}  // namespace
+
+TEST(Cache, PolicyFifo_CacheFull_EvictsOldestInsertRegardlessOfHits) {
+  IntFifoPolicy policy(2);
+  IntCache cache;
+  Put(&policy, &cache, 1);
+  Put(&policy, &cache, 2);
+  policy.Get(&cache, std::make_tuple(1));
+  Put(&policy, &cache, 3);
+  EXPECT_EQ(cache.count(std::make_tuple(1)), 0);
+  EXPECT_EQ(cache.count(std::make_tuple(2)), 1);
+  EXPECT_EQ(cache.count(std::make_tuple(3)), 1);
+}
+
+TEST(Cache, PolicyFifo_OverwriteKey_RequeuesInsteadOfDuplicating) {
+  IntFifoPolicy policy(2);
+  IntCache cache;
+  Put(&policy, &cache, 1);
+  Put(&policy, &cache, 2);
+  Put(&policy, &cache, 1);
+  Put(&policy, &cache, 3);
+  EXPECT_EQ(cache.count(std::make_tuple(1)), 1);
+  EXPECT_EQ(cache.count(std::make_tuple(2)), 0);
+  Put(&policy, &cache, 4);
+  EXPECT_EQ(cache.count(std::make_tuple(1)), 0);
+  EXPECT_EQ(cache.size(), 2);
+}
+
+TEST(Memoization, FifoCache_HitHeavyWorkload_StaysWithinCapacity) {
+  side_effects::memoization::Memoization memoization;
+  auto identity = memoization.Memoize(
+      std::function<int(int)>([](int n) { return n; }), IntFifoPolicy(4));
+  for (int round = 0; round < 50; ++round) {
+    for (int i = 0; i < 200; ++i) {
+      EXPECT_EQ(identity(i % 3), i % 3);
+    }
+    EXPECT_EQ(identity(100 + round), 100 + round);
+  }
+  EXPECT_EQ(identity(0), 0);
+}
@@ -0,0 +1,108 @@
+/*
+ * Copyright (C) 2024  OverbearingPearl
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ * The above copyright notice and this permission notice shall be included in
+ * all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+ * THE SOFTWARE.
+ */
+
+#include <gtest/gtest.h>
+
+#include <string>
+#include <tuple>
+#include <vector>
+
+#include "src/side_effects/cache/cache.h"
+
+namespace {
+
+using StringCache = side_effects::cache::Cache<std::tuple<int>, std::string>;
+using side_effects::cache::kNoSlot;
+using side_effects::cache::SlotIndex;
+
+}  // namespace
+
+TEST(Cache, FlatTable_ManyInserts_AllKeysFound) {
+  StringCache cache;
+  for (int i = 0; i < 10000; ++i) {
+    cache.Emplace(std::make_tuple(i), std::to_string(i));
+  }
+  EXPECT_EQ(cache.size(), 10000);
+  for (int i = 0; i < 10000; ++i) {
+    SlotIndex slot = cache.Find(std::make_tuple(i));
+    ASSERT_NE(slot, kNoSlot);
+    EXPECT_EQ(cache.value(slot), std::to_string(i));
+  }
+  EXPECT_EQ(cache.Find(std::make_tuple(10000)), kNoSlot);
+}
+
+TEST(Cache, FlatTable_Rehash_KeepsSlotIndicesStable) {
+  StringCache cache;
+  std::vector<SlotIndex> slots;
+  for (int i = 0; i < 16; ++i) {
+    slots.push_back(cache.Emplace(std::make_tuple(i), std::to_string(i)));
+  }
+  for (int i = 16; i < 5000; ++i) {
+    cache.Emplace(std::make_tuple(i), std::to_string(i));
+  }
+  for (int i = 0; i < 16; ++i) {
+    EXPECT_EQ(cache.Find(std::make_tuple(i)), slots[i]);
+    EXPECT_EQ(std::get<0>(cache.key(slots[i])), i);
+  }
+}
+
+TEST(Cache, FlatTable_EraseChurn_ReusesSlotsAndKeepsLookupsCorrect) {
+  StringCache cache;
+  for (int round = 0; round < 50; ++round) {
+    for (int i = 0; i < 100; ++i) {
+      cache.Emplace(std::make_tuple(round * 100 + i), "v");
+    }
+    for (int i = 0; i < 100; ++i) {
+      SlotIndex slot = cache.Find(std::make_tuple(round * 100 + i));
+      ASSERT_NE(slot, kNoSlot);
+      cache.Erase(slot);
+    }
+  }
+  EXPECT_TRUE(cache.empty());
+  SlotIndex slot = cache.Emplace(std::make_tuple(-1), "x");
+  EXPECT_LT(slot, 100);
+  EXPECT_EQ(cache.count(std::make_tuple(4999)), 0);
+  EXPECT_EQ(cache.count(std::make_tuple(-1)), 1);
+}
+
+TEST(Cache, FlatTable_Holds_OnlyLiveSlotWithItsHash) {
+  StringCache cache;
+  SlotIndex one = cache.Emplace(std::make_tuple(1), "1");
+  SlotIndex two = cache.Emplace(std::make_tuple(2), "2");
+  uint64_t hash_one = StringCache::HashOf(std::make_tuple(1));
+  EXPECT_TRUE(cache.Holds(one, hash_one));
+  EXPECT_FALSE(cache.Holds(two, hash_one));
+  EXPECT_FALSE(cache.Holds(two + 1, hash_one));
+  cache.Erase(one);
+  EXPECT_FALSE(cache.Holds(one, hash_one));
+  EXPECT_TRUE(cache.Holds(two, StringCache::HashOf(std::make_tuple(2))));
+}
+
+TEST(Cache, FlatTable_Copy_IsIndependent) {
+  StringCache cache;
+  cache.Emplace(std::make_tuple(1), "one");
+  StringCache copy(cache);
+  copy.value(copy.Find(std::make_tuple(1))) = "uno";
+  copy.Emplace(std::make_tuple(2), "two");
+  EXPECT_EQ(cache.value(cache.Find(std::make_tuple(1))), "one");
+  EXPECT_EQ(cache.size(), 1);
+  EXPECT_EQ(copy.size(), 2);
+}
@@ -0,0 +1,108 @@
+/*
+ * Copyright (C) 2024  OverbearingPearl
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ * The above copyright notice and this permission notice shall be included in
+ * all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+ * THE SOFTWARE.
+ */
+
+#pragma once
+
+#include <algorithm>
+#include <cmath>
+#include <cstddef>
+#include <random>
+#include <tuple>
+#include <vector>
+
+// Key traces and a hit-ratio driver shared by the policy tests.
+namespace cache_test {
+
+// Keys 0..keys-1 drawn with probability proportional to 1 / (rank + 1)^skew.
+inline std::vector<int> ZipfTrace(size_t length, int keys, double skew,
+                                  unsigned seed) {
+  std::vector<double> cdf(keys);
+  double total = 0;
+  for (int key = 0; key < keys; ++key) {
+    total += 1.0 / std::pow(key + 1, skew);
+    cdf[key] = total;
+  }
+  std::mt19937 random(seed);
+  std::uniform_real_distribution<double> uniform(0, total);
+  std::vector<int> trace(length);
+  for (auto& key : trace) {
+    key = static_cast<int>(
+        std::lower_bound(cdf.begin(), cdf.end(), uniform(random)) -
+        cdf.begin());
+  }
+  return trace;
+}
+
+// trace with a never-repeated key (from first_key upwards) after each access,
+// like a hot working set interleaved with a scan.
+inline std::vector<int> WithOneHitWonders(const std::vector<int>& trace,
+                                          int first_key) {
+  std::vector<int> mixed;
+  for (int key : trace) {
+    mixed.push_back(key);
+    mixed.push_back(first_key++);
+  }
+  return mixed;
+}
+
+// trace with a sweep of scan_length never-repeated keys (from first_key
+// upwards) after every period accesses, like a periodic batch job.
+inline std::vector<int> WithScans(const std::vector<int>& trace, size_t period,
+                                  int scan_length, int first_key) {
+  std::vector<int> mixed;
+  for (size_t i = 0; i < trace.size(); ++i) {
+    mixed.push_back(trace[i]);
+    if ((i + 1) % period == 0) {
+      for (int key = 0; key < scan_length; ++key) {
+        mixed.push_back(first_key++);
+      }
+    }
+  }
+  return mixed;
+}
+
+// keys 0..keys-1 accessed in order, rounds times.
+inline std::vector<int> LoopTrace(int keys, int rounds) {
+  std::vector<int> trace;
+  for (int round = 0; round < rounds; ++round) {
+    for (int key = 0; key < keys; ++key) {
+      trace.push_back(key);
+    }
+  }
+  return trace;
+}
+
+// Fraction of accesses served from cache when policy inserts every miss.
+template <typename Policy>
+double HitRatio(Policy policy, const std::vector<int>& trace) {
+  typename Policy::CacheType cache;
+  size_t hits = 0;
+  for (int key : trace) {
+    if (policy.Get(&cache, std::make_tuple(key)) != nullptr) {
+      ++hits;
+    } else {
+      policy.Insert(&cache, std::make_tuple(key), key);
+    }
+  }
+  return static_cast<double>(hits) / trace.size();
+}
+
+}  // namespace cache_test
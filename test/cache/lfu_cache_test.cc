@@ -30,11 +30,92 @@
 TEST(Cache, PolicyLfu_InsertSameKeyTwice_CacheSizeIsOne) {
   side_effects::cache::CacheWithLfuPolicy<std::tuple<std::string>, int>
       lfu_policy(1);
-  auto cache = std::make_shared<
-      side_effects::cache::Cache<std::tuple<std::string>, int>>();
-  lfu_policy.Insert(cache.get(), std::make_tuple("key"),
-                    std::make_shared<int>(1));
-  lfu_policy.Insert(cache.get(), std::make_tuple("key"),
-                    std::make_shared<int>(2));
+  auto cache = std::make_shared<side_effects::cache::Cache<
+      std::tuple<std::string>, int, side_effects::cache::LfuMetadata>>();
+  lfu_policy.Insert(cache.get(), std::make_tuple("key"), 1);
+  lfu_policy.Insert(cache.get(), std::make_tuple("key"), 2);
   EXPECT_EQ(cache->size(), 1);
 }
+
+namespace {
+
+using IntLfuPolicy =
+    side_effects::cache::CacheWithLfuPolicy<std::tuple<int>, int>;
+using IntCache = IntLfuPolicy::CacheType;
+
+void Put(IntLfuPolicy* policy, IntCache* cache, int key) {
+  policy->Insert(cache, std::make_tuple(key), key);
+}
+
+void Hit(IntLfuPolicy* policy, IntCache* cache, int key) {
+  policy->Get(cache, std::make_tuple(key));
+}
+
+}  // namespace
+
+TEST(Cache, PolicyLfu_CacheFull_EvictsLeastFrequent) {
+  IntLfuPolicy policy(2);
+  IntCache cache;
+  Put(&policy, &cache, 1);
+  Hit(&policy, &cache, 1);
+  Put(&policy, &cache, 2);
+  Put(&policy, &cache, 3);
+  EXPECT_EQ(cache.size(), 2);
+  EXPECT_EQ(cache.count(std::make_tuple(1)), 1);
+  EXPECT_EQ(cache.count(std::make_tuple(2)), 0);
+  EXPECT_EQ(cache.count(std::make_tuple(3)), 1);
+}
+
+TEST(Cache, PolicyLfu_FrequencyTie_EvictsLeastRecent) {
+  IntLfuPolicy policy(3);
+  IntCache cache;
+  Put(&policy, &cache, 1);
+  Put(&policy, &cache, 2);
+  Put(&policy, &cache, 3);
+  Hit(&policy, &cache, 2);
+  Hit(&policy, &cache, 1);
+  Put(&policy, &cache, 4);
+  EXPECT_EQ(cache.count(std::make_tuple(3)), 0);
+  Put(&policy, &cache, 5);
+  EXPECT_EQ(cache.count(std::make_tuple(4)), 0);
+  EXPECT_EQ(cache.count(std::make_tuple(1)), 1);
+  EXPECT_EQ(cache.count(std::make_tuple(2)), 1);
+}
+
+TEST(Cache, PolicyLfu_WithDecay_OldHotKeyFallsOut) {
+  IntLfuPolicy policy(2, 4);
+  IntCache cache;
+  Put(&policy, &cache, 1);
+  for (int i = 0; i < 3; ++i) {
+    Hit(&policy, &cache, 1);
+  }
+  EXPECT_EQ(policy.Frequency(cache, std::make_tuple(1)), 2);
+  Put(&policy, &cache, 2);
+  Hit(&policy, &cache, 2);
+  Put(&policy, &cache, 3);
+  EXPECT_EQ(cache.count(std::make_tuple(1)), 0);
+  EXPECT_EQ(cache.count(std::make_tuple(2)), 1);
+}
+
+TEST(Cache, PolicyLfu_LargeCacheChurn_BucketsTrackDistinctFrequencies) {
+  const int kCapacity = 1 << 14;
+  IntLfuPolicy policy(kCapacity);
+  IntCache cache;
+  for (int i = 0; i < kCapacity; ++i) {
+    Put(&policy, &cache, i);
+    for (int hit = 0; hit < i % 4; ++hit) {
+      Hit(&policy, &cache, i);
+    }
+  }
+  EXPECT_EQ(policy.BucketCount(), 4);
+  // Each new key evicts the oldest key of frequency 1, then moves up a
+  // single bucket on its hit: no operation depends on the entry count.
+  for (int i = 0; i < 20000; ++i) {
+    Put(&policy, &cache, kCapacity + i);
+    Hit(&policy, &cache, kCapacity + i);
+    ASSERT_LE(policy.BucketCount(), 4);
+  }
+  EXPECT_EQ(cache.size(), kCapacity);
+  EXPECT_EQ(policy.Frequency(cache, std::make_tuple(kCapacity + 19999)), 2);
+  EXPECT_EQ(policy.Frequency(cache, std::make_tuple(3)), 4);
+}
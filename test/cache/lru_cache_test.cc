@@ -0,0 +1,109 @@
+/*
+ * Copyright (C) 2024  OverbearingPearl
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ * The above copyright notice and this permission notice shall be included in
+ * all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+ * THE SOFTWARE.
+ */
+
+#include <gtest/gtest.h>
+
+#include <algorithm>
+#include <list>
+#include <random>
+#include <tuple>
+
+#include "src/side_effects/cache/cache_lru.h"
+
+namespace {
+
+using IntLruPolicy =
+    side_effects::cache::CacheWithLruPolicy<std::tuple<int>, int>;
+using IntCache = IntLruPolicy::CacheType;
+
+void Put(IntLruPolicy* policy, IntCache* cache, int key) {
+  policy->Insert(cache, std::make_tuple(key), key);
+}
+
+}  // namespace
+
+TEST(Cache, PolicyLru_CacheFull_EvictsLeastRecentlyUsed) {
+  IntLruPolicy policy(2);
+  IntCache cache;
+  Put(&policy, &cache, 1);
+  Put(&policy, &cache, 2);
+  policy.Get(&cache, std::make_tuple(1));
+  Put(&policy, &cache, 3);
+  EXPECT_EQ(cache.count(std::make_tuple(1)), 1);
+  EXPECT_EQ(cache.count(std::make_tuple(2)), 0);
+  EXPECT_EQ(cache.count(std::make_tuple(3)), 1);
+}
+
+TEST(Cache, PolicyLru_InsertExistingKeyAtCapacity_KeepsOtherEntries) {
+  IntLruPolicy policy(2);
+  IntCache cache;
+  Put(&policy, &cache, 1);
+  Put(&policy, &cache, 2);
+  Put(&policy, &cache, 2);
+  EXPECT_EQ(cache.size(), 2);
+  EXPECT_EQ(cache.count(std::make_tuple(1)), 1);
+}
+
+TEST(Cache, PolicyLru_RandomOperations_MatchReferenceOrder) {
+  IntLruPolicy policy(16);
+  IntCache cache;
+  std::list<int> expected;  // Most recently used first.
+  std::mt19937 random(7);
+  for (int i = 0; i < 5000; ++i) {
+    int key = static_cast<int>(random() % 40);
+    auto position = std::find(expected.begin(), expected.end(), key);
+    switch (random() % 3) {
+      case 0:
+        Put(&policy, &cache, key);
+        if (position != expected.end()) {
+          expected.erase(position);
+        } else if (expected.size() == 16) {
+          expected.pop_back();
+        }
+        expected.push_front(key);
+        break;
+      case 1:
+        EXPECT_EQ(policy.Get(&cache, std::make_tuple(key)) != nullptr,
+                  position != expected.end());
+        if (position != expected.end()) {
+          expected.splice(expected.begin(), expected, position);
+        }
+        break;
+      default:
+        EXPECT_EQ(policy.Erase(&cache, std::make_tuple(key)),
+                  position != expected.end());
+        if (position != expected.end()) {
+          expected.erase(position);
+        }
+        break;
+    }
+    ASSERT_EQ(cache.size(), expected.size());
+  }
+  // Once full, new keys evict the survivors in least recently used order.
+  for (int key = 1000; cache.size() < 16; ++key) {
+    Put(&policy, &cache, key);
+  }
+  for (auto key = expected.rbegin(); key != expected.rend(); ++key) {
+    EXPECT_EQ(cache.count(std::make_tuple(*key)), 1);
+    Put(&policy, &cache, 2000 + *key);
+    EXPECT_EQ(cache.count(std::make_tuple(*key)), 0);
+  }
+}
@@ -0,0 +1,140 @@
+/*
+ * Copyright (C) 2024  OverbearingPearl
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ * The above copyright notice and this permission notice shall be included in
+ * all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+ * THE SOFTWARE.
+ */
+
+#include <gtest/gtest.h>
+
+#include <chrono>
+#include <cstdlib>
+#include <list>
+#include <new>
+#include <tuple>
+#include <vector>
+
+#include "src/side_effects/cache/cache_arc.h"
+#include "src/side_effects/cache/cache_fifo.h"
+#include "src/side_effects/cache/cache_lfu.h"
+#include "src/side_effects/cache/cache_lru.h"
+#include "src/side_effects/cache/cache_sieve.h"
+#include "src/side_effects/cache/cache_tinylfu.h"
+#include "src/side_effects/cache/cache_ttl.h"
+#include "src/side_effects/cache/cache_two_queue.h"
+#include "src/side_effects/cache/pool_allocator.h"
+#include "test/cache/hit_ratio.h"
+
+namespace {
+
+// Counts this thread's calls to operator new, so other threads do not
+// disturb a measurement. The replacement covers the whole program, which is
+// why these tests build into an executable of their own (see
+// test/CMakeLists.txt).
+thread_local size_t heap_allocations = 0;
+
+}  // namespace
+
+// The array and nothrow forms forward to these.
+void* operator new(size_t size) {
+  ++heap_allocations;
+  void* block = std::malloc(size == 0 ? 1 : size);
+  if (block == nullptr) {
+    throw std::bad_alloc();
+  }
+  return block;
+}
+
+void operator delete(void* block) noexcept { std::free(block); }
+
+void operator delete(void* block, size_t) noexcept { std::free(block); }
+
+namespace {
+
+using side_effects::cache::PoolAllocator;
+
+// Runs a mix of hot keys and one-off keys through policy until its cache is
+// full and churning, then returns how many heap allocations the policy and
+// its cache make, together, while the same mix continues.
+template <typename Policy>
+size_t AllocationsAtCapacity(Policy policy) {
+  std::vector<int> trace = cache_test::WithOneHitWonders(
+      cache_test::ZipfTrace(10000, 1000, 0.9, 42), 1000);
+  typename Policy::CacheType cache;
+  size_t allocations = 0;
+  for (size_t i = 0; i < trace.size(); ++i) {
+    if (i == trace.size() / 2) {
+      allocations = heap_allocations;
+    }
+    if (policy.Get(&cache, std::make_tuple(trace[i])) == nullptr) {
+      policy.Insert(&cache, std::make_tuple(trace[i]), trace[i]);
+    }
+  }
+  return heap_allocations - allocations;
+}
+
+}  // namespace
+
+TEST(Cache, PoolAllocator_FreedNode_Reused) {
+  PoolAllocator<int> allocator(16);
+  int* first = allocator.allocate(1);
+  allocator.deallocate(first, 1);
+  size_t before = heap_allocations;
+  int* second = allocator.allocate(1);
+  EXPECT_EQ(second, first);
+  EXPECT_EQ(heap_allocations, before);
+  allocator.deallocate(second, 1);
+
+  int* array = allocator.allocate(4);  // Arrays bypass the pool.
+  EXPECT_EQ(heap_allocations, before + 1);
+  allocator.deallocate(array, 4);
+}
+
+TEST(Cache, PoolAllocator_CopiedContainer_GetsItsOwnPool) {
+  std::list<int, PoolAllocator<int>> list(PoolAllocator<int>(16));
+  list.push_back(1);
+  std::list<int, PoolAllocator<int>> copy(list);
+  EXPECT_EQ(copy, list);
+  EXPECT_NE(copy.get_allocator(), list.get_allocator());
+  std::list<int, PoolAllocator<int>> other(list.get_allocator());
+  EXPECT_EQ(other.get_allocator(), list.get_allocator());
+  other.splice(other.begin(), list);
+  EXPECT_TRUE(list.empty());
+  EXPECT_EQ(other.front(), 1);
+}
+
+TEST(Cache, PoolAllocator_PoliciesAtCapacity_NoHeapAllocations) {
+  using Key = std::tuple<int>;
+  using side_effects::cache::CacheWithArcPolicy;
+  using side_effects::cache::CacheWithFifoPolicy;
+  using side_effects::cache::CacheWithLfuPolicy;
+  using side_effects::cache::CacheWithLruPolicy;
+  using side_effects::cache::CacheWithSievePolicy;
+  using side_effects::cache::CacheWithTinyLfuPolicy;
+  using side_effects::cache::CacheWithTtlPolicy;
+  using side_effects::cache::CacheWithTwoQueuePolicy;
+  EXPECT_EQ(AllocationsAtCapacity(CacheWithLruPolicy<Key, int>(100)), 0);
+  EXPECT_EQ(AllocationsAtCapacity(CacheWithFifoPolicy<Key, int>(100)), 0);
+  EXPECT_EQ(AllocationsAtCapacity(CacheWithLfuPolicy<Key, int>(100)), 0);
+  EXPECT_EQ(AllocationsAtCapacity(CacheWithSievePolicy<Key, int>(100)), 0);
+  EXPECT_EQ(AllocationsAtCapacity(CacheWithTwoQueuePolicy<Key, int>(100)), 0);
+  EXPECT_EQ(AllocationsAtCapacity(CacheWithArcPolicy<Key, int>(100)), 0);
+  EXPECT_EQ(AllocationsAtCapacity(CacheWithTinyLfuPolicy<Key, int>(100)), 0);
+  EXPECT_EQ(AllocationsAtCapacity(CacheWithTtlPolicy<Key, int>(
+                std::chrono::minutes(10), 100)),
+            0);
+}
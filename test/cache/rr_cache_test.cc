@@ -0,0 +1,100 @@
+/*
+ * Copyright (C) 2024  OverbearingPearl
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ * The above copyright notice and this permission notice shall be included in
+ * all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+ * THE SOFTWARE.
+ */
+
+#include <gtest/gtest.h>
+
+#include <tuple>
+#include <vector>
+
+#include "src/side_effects/cache/cache_lru.h"
+#include "src/side_effects/cache/cache_rr.h"
+#include "test/cache/hit_ratio.h"
+
+namespace {
+
+using IntRrPolicy =
+    side_effects::cache::CacheWithRrPolicy<std::tuple<int>, int>;
+using IntSampledLruPolicy =
+    side_effects::cache::CacheWithSampledLruPolicy<std::tuple<int>, int>;
+using IntLruPolicy =
+    side_effects::cache::CacheWithLruPolicy<std::tuple<int>, int>;
+
+template <typename Policy>
+std::vector<int> Survivors(Policy policy, int inserts, int keys) {
+  typename Policy::CacheType cache;
+  for (int key = 0; key < inserts; ++key) {
+    policy.Insert(&cache, std::make_tuple(key), key);
+  }
+  std::vector<int> survivors;
+  for (int key = 0; key < keys; ++key) {
+    if (cache.count(std::make_tuple(key)) != 0) {
+      survivors.push_back(key);
+    }
+  }
+  return survivors;
+}
+
+}  // namespace
+
+TEST(Cache, PolicyRr_SameSeed_EvictsSameKeys) {
+  EXPECT_EQ(Survivors(IntRrPolicy(8, 1), 64, 64),
+            Survivors(IntRrPolicy(8, 1), 64, 64));
+  EXPECT_NE(Survivors(IntRrPolicy(8, 1), 64, 64),
+            Survivors(IntRrPolicy(8, 2), 64, 64));
+  EXPECT_EQ(Survivors(IntRrPolicy(8), 64, 64).size(), 8);
+}
+
+TEST(Cache, PolicyRr_EraseChurn_KeepsDenseSlotsConsistent) {
+  IntRrPolicy policy(16);
+  IntRrPolicy::CacheType cache;
+  for (int key = 0; key < 1000; ++key) {
+    policy.Insert(&cache, std::make_tuple(key), key);
+    if (key % 3 == 0) {
+      policy.Erase(&cache, std::make_tuple(key - 1));
+    }
+    ASSERT_LE(cache.size(), 16);
+  }
+  cache.ForEach([&cache](side_effects::cache::SlotIndex slot) {
+    EXPECT_EQ(std::get<0>(cache.key(slot)), cache.value(slot));
+  });
+}
+
+TEST(Cache, PolicySampledLru_SampleEveryEntry_EvictsLeastRecentlyUsed) {
+  // Sampling with replacement, so take enough samples to see all 3 entries.
+  IntSampledLruPolicy policy(3, 64);
+  IntSampledLruPolicy::CacheType cache;
+  policy.Insert(&cache, std::make_tuple(1), 1);
+  policy.Insert(&cache, std::make_tuple(2), 2);
+  policy.Insert(&cache, std::make_tuple(3), 3);
+  policy.Get(&cache, std::make_tuple(1));
+  policy.Insert(&cache, std::make_tuple(4), 4);
+  EXPECT_EQ(cache.count(std::make_tuple(1)), 1);
+  EXPECT_EQ(cache.count(std::make_tuple(2)), 0);
+}
+
+TEST(Cache, PolicySampledLru_ZipfTrace_CloseToLru) {
+  auto trace = cache_test::ZipfTrace(100000, 10000, 0.9, 1);
+  double lru = cache_test::HitRatio(IntLruPolicy(500), trace);
+  double rr = cache_test::HitRatio(IntRrPolicy(500), trace);
+  double sampled = cache_test::HitRatio(IntSampledLruPolicy(500), trace);
+  EXPECT_GT(sampled, rr + 0.02);
+  EXPECT_GT(sampled, lru - 0.01);
+}
@@ -0,0 +1,123 @@
+/*
+ * Copyright (C) 2024  OverbearingPearl
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ * The above copyright notice and this permission notice shall be included in
+ * all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+ * THE SOFTWARE.
+ */
+
+#include <gtest/gtest.h>
+
+#include <atomic>
+#include <functional>
+#include <thread>
+#include <tuple>
+#include <vector>
+
+#include "src/side_effects/cache/cache_lru.h"
+#include "src/side_effects/cache/cache_sieve.h"
+#include "src/side_effects/memoization/memoization.h"
+#include "test/cache/hit_ratio.h"
+
+namespace {
+
+using IntSievePolicy =
+    side_effects::cache::CacheWithSievePolicy<std::tuple<int>, int>;
+using IntLruPolicy =
+    side_effects::cache::CacheWithLruPolicy<std::tuple<int>, int>;
+using IntCache = IntSievePolicy::CacheType;
+
+void Put(IntSievePolicy* policy, IntCache* cache, int key) {
+  policy->Insert(cache, std::make_tuple(key), key);
+}
+
+}  // namespace
+
+TEST(Cache, PolicySieve_CacheFull_EvictsOldestUnvisited) {
+  IntSievePolicy policy(3);
+  IntCache cache;
+  Put(&policy, &cache, 1);
+  Put(&policy, &cache, 2);
+  Put(&policy, &cache, 3);
+  policy.Get(&cache, std::make_tuple(1));
+  policy.Get(&cache, std::make_tuple(3));
+  Put(&policy, &cache, 4);
+  EXPECT_EQ(cache.count(std::make_tuple(2)), 0);
+  // The hand resumes after 2 and passes 3 (clearing its bit) before 4.
+  Put(&policy, &cache, 5);
+  EXPECT_EQ(cache.count(std::make_tuple(1)), 1);
+  EXPECT_EQ(cache.count(std::make_tuple(3)), 1);
+  EXPECT_EQ(cache.count(std::make_tuple(4)), 0);
+}
+
+TEST(Cache, PolicySieve_EraseUnderHand_KeepsSweeping) {
+  IntSievePolicy policy(2);
+  IntCache cache;
+  Put(&policy, &cache, 1);
+  Put(&policy, &cache, 2);
+  Put(&policy, &cache, 3);
+  EXPECT_TRUE(policy.Erase(&cache, std::make_tuple(2)));
+  Put(&policy, &cache, 4);
+  Put(&policy, &cache, 5);
+  EXPECT_EQ(cache.size(), 2);
+  EXPECT_EQ(cache.count(std::make_tuple(5)), 1);
+}
+
+TEST(Cache, PolicySieve_OneHitWonders_BeatsLru) {
+  for (double skew : {0.7, 1.1}) {
+    auto trace = cache_test::WithOneHitWonders(
+        cache_test::ZipfTrace(100000, 10000, skew, 1), 1000000);
+    double lru = cache_test::HitRatio(IntLruPolicy(500), trace);
+    double sieve = cache_test::HitRatio(IntSievePolicy(500), trace);
+    EXPECT_GT(sieve, lru + 0.05) << "skew " << skew;
+  }
+}
+
+TEST(Cache, PolicySieve_ZipfTrace_BeatsLru) {
+  auto trace = cache_test::ZipfTrace(100000, 10000, 0.9, 1);
+  double lru = cache_test::HitRatio(IntLruPolicy(500), trace);
+  double sieve = cache_test::HitRatio(IntSievePolicy(500), trace);
+  EXPECT_GT(sieve, lru);
+}
+
+TEST(Memoization, SieveCache_ConcurrentHits_SeeConsistentResults) {
+  side_effects::memoization::Memoization memoization;
+  std::atomic<int> calls(0);
+  auto square = memoization.Memoize(
+      std::function<int(int)>([&calls](int n) {
+        ++calls;
+        return n * n;
+      }),
+      IntSievePolicy(64));
+
+  std::atomic<int> mismatches(0);
+  std::vector<std::thread> workers;
+  for (int t = 0; t < 4; ++t) {
+    workers.emplace_back([&square, &mismatches, t]() {
+      for (int i = 0; i < 2000; ++i) {
+        int n = (i * 7 + t) % (i % 4 == 0 ? 128 : 32);
+        if (square(n) != n * n) {
+          ++mismatches;
+        }
+      }
+    });
+  }
+  for (auto& worker : workers) {
+    worker.join();
+  }
+  EXPECT_EQ(mismatches.load(), 0);
+  EXPECT_LT(calls.load(), 4 * 2000);
+}
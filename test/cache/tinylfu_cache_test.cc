@@ -0,0 +1,118 @@
+/*
+ * Copyright (C) 2024  OverbearingPearl
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ * The above copyright notice and this permission notice shall be included in
+ * all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+ * THE SOFTWARE.
+ */
+
+#include <gtest/gtest.h>
+
+#include <cstdint>
+#include <tuple>
+
+#include "src/side_effects/cache/cache_lru.h"
+#include "src/side_effects/cache/cache_tinylfu.h"
+#include "src/side_effects/cache/frequency_sketch.h"
+#include "src/utils/immutable/hash.h"
+#include "test/cache/hit_ratio.h"
+
+namespace {
+
+using IntTinyLfuPolicy =
+    side_effects::cache::CacheWithTinyLfuPolicy<std::tuple<int>, int>;
+using IntLruPolicy =
+    side_effects::cache::CacheWithLruPolicy<std::tuple<int>, int>;
+using IntCache = IntTinyLfuPolicy::CacheType;
+
+void Put(IntTinyLfuPolicy* policy, IntCache* cache, int key) {
+  policy->Insert(cache, std::make_tuple(key), key);
+}
+
+uint64_t KeyHash(int key) { return utils::immutable::HashValue(key); }
+
+}  // namespace
+
+TEST(Cache, FrequencySketch_FirstAccess_OnlyReachesDoorkeeper) {
+  side_effects::cache::FrequencySketch sketch(64);
+  EXPECT_EQ(sketch.Estimate(KeyHash(1)), 0);
+  sketch.Increment(KeyHash(1));
+  EXPECT_EQ(sketch.Estimate(KeyHash(1)), 1);
+  sketch.Increment(KeyHash(1));
+  sketch.Increment(KeyHash(1));
+  EXPECT_EQ(sketch.Estimate(KeyHash(1)), 3);
+}
+
+TEST(Cache, FrequencySketch_ManyAccesses_SaturateAndHalve) {
+  side_effects::cache::FrequencySketch sketch(64);
+  for (int i = 0; i < 40; ++i) {
+    sketch.Increment(KeyHash(1));
+  }
+  EXPECT_EQ(sketch.Estimate(KeyHash(1)), 16);
+  sketch.Reset();
+  EXPECT_EQ(sketch.Estimate(KeyHash(1)), 7);
+}
+
+TEST(Cache, FrequencySketch_SamplePeriodElapsed_AgesCounts) {
+  side_effects::cache::FrequencySketch sketch(16);
+  for (int i = 0; i < 8; ++i) {
+    sketch.Increment(KeyHash(1));
+  }
+  uint32_t before = sketch.Estimate(KeyHash(1));
+  for (int key = 100; key < 260; ++key) {
+    sketch.Increment(KeyHash(key));
+  }
+  EXPECT_LT(sketch.Estimate(KeyHash(1)), before);
+}
+
+TEST(Cache, PolicyTinyLfu_ColdCandidate_IsNotAdmitted) {
+  IntTinyLfuPolicy policy(4);
+  IntCache cache;
+  for (int key = 1; key <= 4; ++key) {
+    Put(&policy, &cache, key);
+    policy.Get(&cache, std::make_tuple(key));
+    policy.Get(&cache, std::make_tuple(key));
+  }
+  for (int key = 100; key < 110; ++key) {
+    Put(&policy, &cache, key);
+  }
+  EXPECT_EQ(cache.size(), 4);
+  // Only the window slot churns; the frequent keys in the main cache stay.
+  int frequent_left = 0;
+  for (int key = 1; key <= 4; ++key) {
+    frequent_left += static_cast<int>(cache.count(std::make_tuple(key)));
+  }
+  EXPECT_EQ(frequent_left, 3);
+  EXPECT_EQ(cache.count(std::make_tuple(109)), 1);
+}
+
+TEST(Cache, PolicyTinyLfu_ZipfTrace_BeatsLru) {
+  auto trace = cache_test::ZipfTrace(100000, 10000, 0.9, 1);
+  double lru = cache_test::HitRatio(IntLruPolicy(500), trace);
+  double tinylfu = cache_test::HitRatio(IntTinyLfuPolicy(500), trace);
+  EXPECT_GT(tinylfu, lru + 0.05);
+}
+
+TEST(Cache, PolicyTinyLfu_OneHitWonders_KeepHotSet) {
+  auto zipf = cache_test::ZipfTrace(100000, 10000, 0.9, 1);
+  auto trace = cache_test::WithOneHitWonders(zipf, 1000000);
+  double lru = cache_test::HitRatio(IntLruPolicy(500), trace);
+  double tinylfu = cache_test::HitRatio(IntTinyLfuPolicy(500), trace);
+  EXPECT_GT(tinylfu, lru * 1.5);
+  // Half the accesses are one-offs, so at best the Zipf half keeps its ratio.
+  EXPECT_GT(tinylfu, cache_test::HitRatio(IntTinyLfuPolicy(500), zipf) / 2 -
+                         0.02);
+}
@@ -0,0 +1,105 @@
+/*
+ * Copyright (C) 2024  OverbearingPearl
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ * The above copyright notice and this permission notice shall be included in
+ * all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+ * THE SOFTWARE.
+ */
+
+#include <gtest/gtest.h>
+
+#include <chrono>
+#include <functional>
+#include <thread>
+#include <tuple>
+
+#include "src/side_effects/cache/cache_ttl.h"
+#include "src/side_effects/memoization/memoization.h"
+
+namespace {
+
+using IntTtlPolicy =
+    side_effects::cache::CacheWithTtlPolicy<std::tuple<int>, int>;
+using IntCache = IntTtlPolicy::CacheType;
+
+void Put(IntTtlPolicy* policy, IntCache* cache, int key) {
+  policy->Insert(cache, std::make_tuple(key), key);
+}
+
+}  // namespace
+
+TEST(Cache, PolicyTtl_EntryExpired_RemovedOnNextInsert) {
+  IntTtlPolicy policy(std::chrono::milliseconds(20));
+  IntCache cache;
+  Put(&policy, &cache, 1);
+  std::this_thread::sleep_for(std::chrono::milliseconds(40));
+  Put(&policy, &cache, 2);
+  EXPECT_EQ(cache.count(std::make_tuple(1)), 0);
+  EXPECT_EQ(cache.count(std::make_tuple(2)), 1);
+}
+
+TEST(Cache, PolicyTtl_EntryExpired_GetTurnsHitIntoMiss) {
+  IntTtlPolicy policy(std::chrono::milliseconds(20));
+  IntCache cache;
+  Put(&policy, &cache, 1);
+  EXPECT_NE(policy.Get(&cache, std::make_tuple(1)), nullptr);
+  std::this_thread::sleep_for(std::chrono::milliseconds(40));
+  EXPECT_EQ(policy.Get(&cache, std::make_tuple(1)), nullptr);
+  EXPECT_EQ(cache.size(), 0);
+}
+
+TEST(Cache, PolicyTtl_PerEntryOverride_OutlivesDefault) {
+  IntTtlPolicy policy(std::chrono::milliseconds(20));
+  IntCache cache;
+  policy.InsertWithTtl(&cache, std::make_tuple(1), 1,
+                       std::chrono::seconds(60));
+  Put(&policy, &cache, 2);
+  std::this_thread::sleep_for(std::chrono::milliseconds(40));
+  Put(&policy, &cache, 3);
+  EXPECT_NE(policy.Get(&cache, std::make_tuple(1)), nullptr);
+  EXPECT_EQ(cache.count(std::make_tuple(2)), 0);
+  EXPECT_EQ(cache.size(), 2);
+}
+
+TEST(Cache, PolicyTtl_WithCapacity_EvictsClosestToExpiry) {
+  IntTtlPolicy policy(std::chrono::seconds(60), 2);
+  IntCache cache;
+  policy.InsertWithTtl(&cache, std::make_tuple(1), 1,
+                       std::chrono::seconds(90));
+  policy.InsertWithTtl(&cache, std::make_tuple(2), 2,
+                       std::chrono::seconds(10));
+  Put(&policy, &cache, 3);
+  EXPECT_EQ(cache.size(), 2);
+  EXPECT_EQ(cache.count(std::make_tuple(1)), 1);
+  EXPECT_EQ(cache.count(std::make_tuple(2)), 0);
+}
+
+TEST(Memoization, TtlCache_ExpiredHit_Recomputes) {
+  side_effects::memoization::Memoization memoization;
+  int calls = 0;
+  auto counted = memoization.Memoize(
+      std::function<int(int)>([&calls](int n) {
+        ++calls;
+        return n;
+      }),
+      IntTtlPolicy(std::chrono::milliseconds(20)));
+  EXPECT_EQ(counted(1), 1);
+  EXPECT_EQ(counted(1), 1);
+  EXPECT_EQ(calls, 1);
+  std::this_thread::sleep_for(std::chrono::milliseconds(40));
+  EXPECT_EQ(counted(1), 1);
+  EXPECT_EQ(calls, 2);
+}
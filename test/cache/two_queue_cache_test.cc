@@ -0,0 +1,91 @@
+/*
+ * Copyright (C) 2024  OverbearingPearl
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ * The above copyright notice and this permission notice shall be included in
+ * all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+ * THE SOFTWARE.
+ */
+
+#include <gtest/gtest.h>
+
+#include <functional>
+#include <tuple>
+
+#include "src/side_effects/cache/cache_lru.h"
+#include "src/side_effects/cache/cache_two_queue.h"
+#include "src/side_effects/memoization/memoization.h"
+#include "test/cache/hit_ratio.h"
+
+namespace {
+
+using IntTwoQueuePolicy =
+    side_effects::cache::CacheWithTwoQueuePolicy<std::tuple<int>, int>;
+using IntLruPolicy =
+    side_effects::cache::CacheWithLruPolicy<std::tuple<int>, int>;
+using IntCache = IntTwoQueuePolicy::CacheType;
+
+void Put(IntTwoQueuePolicy* policy, IntCache* cache, int key) {
+  policy->Insert(cache, std::make_tuple(key), key);
+}
+
+}  // namespace
+
+TEST(Cache, PolicyTwoQueue_GhostHit_AdmitsToMainQueue) {
+  IntTwoQueuePolicy policy(4);
+  IntCache cache;
+  for (int key = 1; key <= 5; ++key) {
+    Put(&policy, &cache, key);
+  }
+  EXPECT_EQ(cache.count(std::make_tuple(1)), 0);
+  Put(&policy, &cache, 1);  // Remembered, so it goes to the main queue.
+  for (int key = 100; key < 110; ++key) {
+    Put(&policy, &cache, key);
+  }
+  EXPECT_EQ(cache.count(std::make_tuple(1)), 1);
+  EXPECT_EQ(cache.size(), 4);
+}
+
+TEST(Cache, PolicyTwoQueue_LoopLargerThanCacheWithScans_BeatsLru) {
+  auto trace = cache_test::WithScans(cache_test::LoopTrace(600, 100), 1800,
+                                     1000, 1000000);
+  double lru = cache_test::HitRatio(IntLruPolicy(500), trace);
+  double two_queue = cache_test::HitRatio(IntTwoQueuePolicy(500), trace);
+  EXPECT_GT(two_queue, lru + 0.3);
+}
+
+TEST(Cache, PolicyTwoQueue_ZipfWithScans_BeatsLru) {
+  auto trace = cache_test::WithScans(
+      cache_test::ZipfTrace(100000, 1000, 0.9, 1), 2000, 1000, 1000000);
+  double lru = cache_test::HitRatio(IntLruPolicy(500), trace);
+  double two_queue = cache_test::HitRatio(IntTwoQueuePolicy(500), trace);
+  EXPECT_GT(two_queue, lru + 0.05);
+}
+
+TEST(Memoization, TwoQueueCache_RepeatedCalls_ComputeOnce) {
+  side_effects::memoization::Memoization memoization;
+  int calls = 0;
+  auto square = memoization.Memoize(std::function<int(int)>([&calls](int n) {
+                                      ++calls;
+                                      return n * n;
+                                    }),
+                                    IntTwoQueuePolicy(8));
+  for (int round = 0; round < 3; ++round) {
+    for (int n = 0; n < 4; ++n) {
+      EXPECT_EQ(square(n), n * n);
+    }
+  }
+  EXPECT_EQ(calls, 4);
+}
@@ -0,0 +1,122 @@
+/*
+ * Copyright (C) 2024  OverbearingPearl
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ * The above copyright notice and this permission notice shall be included in
+ * all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+ * THE SOFTWARE.
+ */
+
+#include <gtest/gtest.h>
+
+#include <chrono>
+#include <functional>
+#include <string>
+#include <tuple>
+#include <vector>
+
+#include "src/side_effects/cache/cache_fifo.h"
+#include "src/side_effects/cache/cache_flush.h"
+#include "src/side_effects/cache/cache_lfu.h"
+#include "src/side_effects/cache/cache_lru.h"
+#include "src/side_effects/cache/cache_rr.h"
+#include "src/side_effects/cache/cache_ttl.h"
+#include "src/side_effects/memoization/memoization.h"
+
+namespace {
+
+using Key = std::tuple<int>;
+
+size_t Length(const Key&, const std::string& value) { return value.size(); }
+
+template <typename Policy>
+void ExpectWithinBudget(Policy policy) {
+  typename Policy::CacheType cache;
+  for (int key = 0; key < 10; ++key) {
+    policy.Insert(&cache, std::make_tuple(key), std::string(30, 'x'));
+    EXPECT_LE(cache.weight(), 100);
+  }
+  EXPECT_GE(cache.size(), 1);
+  policy.Insert(&cache, std::make_tuple(10), std::string(90, 'y'));
+  EXPECT_EQ(cache.weight(), 90);
+  EXPECT_EQ(cache.size(), 1);
+  // Heavier than the whole budget: everything else goes, it stays alone.
+  policy.Insert(&cache, std::make_tuple(11), std::string(150, 'z'));
+  EXPECT_EQ(cache.weight(), 150);
+  EXPECT_EQ(cache.count(std::make_tuple(11)), 1);
+}
+
+}  // namespace
+
+TEST(Cache, WeightBudget_EveryPolicy_EvictsUntilUnderBudget) {
+  side_effects::cache::WeightBudget budget(100);
+  ExpectWithinBudget(
+      side_effects::cache::CacheWithFifoPolicy<Key, std::string>(budget,
+                                                                 Length));
+  ExpectWithinBudget(
+      side_effects::cache::CacheWithFlushPolicy<Key, std::string>(budget,
+                                                                  Length));
+  ExpectWithinBudget(
+      side_effects::cache::CacheWithLfuPolicy<Key, std::string>(budget,
+                                                                Length));
+  ExpectWithinBudget(
+      side_effects::cache::CacheWithLruPolicy<Key, std::string>(budget,
+                                                                Length));
+  ExpectWithinBudget(
+      side_effects::cache::CacheWithRrPolicy<Key, std::string>(budget, Length));
+  ExpectWithinBudget(side_effects::cache::CacheWithTtlPolicy<Key, std::string>(
+      std::chrono::milliseconds(60000), budget, Length));
+}
+
+TEST(Cache, WeightBudget_LruWithHeavyEntry_EvictsSeveralLightOnes) {
+  side_effects::cache::CacheWithLruPolicy<Key, std::string> policy(
+      side_effects::cache::WeightBudget(100), Length);
+  side_effects::cache::CacheWithLruPolicy<Key, std::string>::CacheType cache;
+  for (int key = 0; key < 5; ++key) {
+    policy.Insert(&cache, std::make_tuple(key), std::string(20, 'x'));
+  }
+  policy.Get(&cache, std::make_tuple(0));
+  policy.Insert(&cache, std::make_tuple(5), std::string(50, 'y'));
+  EXPECT_EQ(cache.weight(), 90);
+  EXPECT_EQ(cache.count(std::make_tuple(0)), 1);
+  EXPECT_EQ(cache.count(std::make_tuple(1)), 0);
+  EXPECT_EQ(cache.count(std::make_tuple(2)), 0);
+  EXPECT_EQ(cache.count(std::make_tuple(3)), 0);
+}
+
+TEST(Cache, WeightBudget_DefaultWeigher_CountsHeapBytes) {
+  side_effects::cache::SizeofWeigher<Key, std::vector<int>> weigher;
+  EXPECT_EQ(weigher(std::make_tuple(1), std::vector<int>(10)),
+            sizeof(Key) + sizeof(std::vector<int>) + 10 * sizeof(int));
+  side_effects::cache::CacheWithLruPolicy<Key, int> unweighted(4);
+  EXPECT_EQ(unweighted.WeightOf(std::make_tuple(1), 1), 1);
+}
+
+TEST(Memoization, WeightBudget_Sharded_ReportsTotalWeight) {
+  side_effects::memoization::Memoization memoization;
+  auto repeat = memoization.MemoizeSharded(
+      std::function<std::vector<int>(int)>(
+          [](int n) { return std::vector<int>(n, n); }),
+      side_effects::cache::CacheWithLruPolicy<Key, std::vector<int>>(
+          side_effects::cache::WeightBudget(1 << 20)),
+      4);
+  size_t expected = 0;
+  for (int n = 1; n <= 8; ++n) {
+    repeat(n);
+    expected += sizeof(Key) + sizeof(std::vector<int>) + n * sizeof(int);
+  }
+  EXPECT_EQ(repeat.CacheSize(), 8);
+  EXPECT_EQ(repeat.CacheWeight(), expected);
+}
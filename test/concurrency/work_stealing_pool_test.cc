@@ -0,0 +1,80 @@
+/*
+ * Copyright (C) 2024  OverbearingPearl
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ * The above copyright notice and this permission notice shall be included in
+ * all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+ * THE SOFTWARE.
+ */
+
+#include <gtest/gtest.h>
+
+#include <atomic>
+#include <chrono>
+#include <memory>
+#include <mutex>
+#include <set>
+#include <thread>
+
+#include "src/side_effects/concurrency/executor.h"
+#include "src/side_effects/concurrency/work_stealing_pool.h"
+
+TEST(Concurrency, WorkStealingPool_ManyTasks_AllRunOnce) {
+  std::atomic<int> runs(0);
+  {
+    side_effects::concurrency::WorkStealingPool pool(4);
+    for (int i = 0; i < 1000; ++i) {
+      pool.Submit([&runs]() { ++runs; });
+    }
+  }
+  EXPECT_EQ(runs.load(), 1000);
+}
+
+TEST(Concurrency, WorkStealingPool_NestedTasks_StolenByIdleWorkers) {
+  side_effects::concurrency::WorkStealingPool pool(4);
+  side_effects::concurrency::Latch done(64);
+  std::mutex mutex;
+  std::set<std::thread::id> workers;
+  // One task fans out; the children land on its worker's deque, so any
+  // other worker that runs one has stolen it.
+  pool.Submit([&]() {
+    for (int i = 0; i < 64; ++i) {
+      pool.Submit([&]() {
+        std::this_thread::sleep_for(std::chrono::milliseconds(1));
+        {
+          std::lock_guard<std::mutex> lock(mutex);
+          workers.insert(std::this_thread::get_id());
+        }
+        done.CountDown();
+      });
+    }
+  });
+  done.Wait();
+  EXPECT_GT(workers.size(), 1);
+}
+
+TEST(Concurrency, WorkStealingPool_AsExecutor_RunsOnPoolThreads) {
+  side_effects::concurrency::WorkStealingPool pool(2);
+  side_effects::concurrency::Executor executor = pool.AsExecutor();
+  side_effects::concurrency::Latch done(1);
+  std::thread::id ran_on;
+  executor([&]() {
+    ran_on = std::this_thread::get_id();
+    done.CountDown();
+  });
+  done.Wait();
+  EXPECT_NE(ran_on, std::this_thread::get_id());
+  EXPECT_EQ(pool.ThreadCount(), 2);
+}
@@ -0,0 +1,165 @@
+/*
+ * Copyright (C) 2024  OverbearingPearl
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ * The above copyright notice and this permission notice shall be included in
+ * all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+ * THE SOFTWARE.
+ */
+
+#include <gtest/gtest.h>
+
+#include <chrono>
+#include <cstdio>
+#include <cstdlib>
+#include <sstream>
+#include <string>
+#include <thread>
+#include <vector>
+
+#include "src/side_effects/io/log_ring.h"
+#include "src/side_effects/io/logging.h"
+
+#ifdef PLATFORM_WINDOWS
+#define fileno _fileno
+#endif
+
+namespace {
+
+using side_effects::io::LogLevel;
+using side_effects::io::Logger;
+
+// Runs log with the logger writing to a temporary file and returns what it
+// wrote.
+template <typename Log>
+std::string Capture(Log log) {
+  std::FILE* file = std::tmpfile();
+  Logger::Instance().SetOutput(fileno(file));
+  log();
+  Logger::Instance().SetOutput(1);
+  std::string text;
+  std::fseek(file, 0, SEEK_SET);
+  char buffer[4096];
+  size_t read;
+  while ((read = std::fread(buffer, 1, sizeof(buffer), file)) > 0) {
+    text.append(buffer, read);
+  }
+  std::fclose(file);
+  return text;
+}
+
+size_t CountLines(const std::string& text, const std::string& needle) {
+  size_t count = 0;
+  for (size_t at = text.find(needle); at != std::string::npos;
+       at = text.find(needle, at + needle.size())) {
+    ++count;
+  }
+  return count;
+}
+
+int Touch(int* evaluated) { return ++*evaluated; }
+
+}  // namespace
+
+TEST(Io, LogRing_FullRing_RejectsUntilPopped) {
+  side_effects::io::LogRing ring;
+  for (size_t i = 0; i < side_effects::io::LogRing::kSlots; ++i) {
+    ASSERT_TRUE(ring.TryPush(LogLevel::kInfo, "line ", i));
+  }
+  EXPECT_FALSE(ring.TryPush(LogLevel::kInfo, "dropped"));
+  std::ostringstream out;
+  ring.Pop(&out);
+  EXPECT_EQ(out.str(), "line 0");
+  EXPECT_TRUE(ring.TryPush(LogLevel::kInfo, "accepted"));
+}
+
+TEST(Io, LogRing_CapturedCString_CopiedAtLogTime) {
+  side_effects::io::LogRing ring;
+  char buffer[] = "before";
+  ring.TryPush(LogLevel::kInfo, static_cast<char*>(buffer));
+  buffer[0] = 'X';
+  std::ostringstream out;
+  ring.Pop(&out);
+  EXPECT_EQ(out.str(), "before");
+}
+
+TEST(Io, LogRing_OversizedArguments_FormattedEagerly) {
+  side_effects::io::LogRing ring;
+  std::string a(10, 'a'), b(10, 'b'), c(10, 'c'), d(10, 'd');
+  ring.TryPush(LogLevel::kInfo, a, b, c, d, 1, 2.5);
+  std::ostringstream out;
+  ring.Pop(&out);
+  EXPECT_EQ(out.str(), a + b + c + d + "12.5");
+}
+
+TEST(Io, Logger_ManyThreads_EveryLineWrittenOnce) {
+  std::string text = Capture([]() {
+    std::vector<std::thread> threads;
+    for (int t = 0; t < 4; ++t) {
+      threads.emplace_back([t]() {
+        for (int i = 0; i < 1000; ++i) {
+          Logger::Instance().Log(LogLevel::kWarning, "worker ", t, " line ",
+                                 i);
+        }
+      });
+    }
+    for (auto& thread : threads) {
+      thread.join();
+    }
+  });
+  EXPECT_EQ(CountLines(text, "[WARNING] worker "), 4000);
+  EXPECT_EQ(CountLines(text, "[WARNING] worker 2 line 999\n"), 1);
+}
+
+TEST(Io, Logger_DisabledLevel_ArgumentsNotEvaluated) {
+  int evaluated = 0;
+  std::string text = Capture([&evaluated]() {
+    LOG_DEBUG("debug ", Touch(&evaluated));
+    LOG_ERROR("error ", Touch(&evaluated));
+  });
+  int expected = (side_effects::io::LogLevelEnabled(LogLevel::kDebug) ? 1 : 0) +
+                 (side_effects::io::LogLevelEnabled(LogLevel::kError) ? 1 : 0);
+  EXPECT_EQ(evaluated, expected);
+  EXPECT_EQ(CountLines(text, "[DEBUG] debug"),
+            side_effects::io::LogLevelEnabled(LogLevel::kDebug) ? 1 : 0);
+}
+
+TEST(Io, Logger_ThreadsLoggingThroughShutdown_ExitCleanly) {
+  ::testing::FLAGS_gtest_death_test_style = "threadsafe";
+  EXPECT_EXIT(
+      {
+        std::FILE* sink = std::fopen("/dev/null", "w");
+        Logger::Instance().SetOutput(fileno(sink));
+        for (int t = 0; t < 4; ++t) {
+          std::thread([t]() {
+            for (int i = 0;; ++i) {
+              Logger::Instance().Log(LogLevel::kInfo, "racing ", t, " ", i);
+            }
+          }).detach();
+        }
+        // Each thread logs for the first time, so some of them do so only
+        // once the logger is gone.
+        std::thread([]() {
+          for (;;) {
+            std::thread([]() {
+              Logger::Instance().Log(LogLevel::kInfo, "fresh thread");
+            }).join();
+          }
+        }).detach();
+        std::this_thread::sleep_for(std::chrono::milliseconds(20));
+        std::exit(0);
+      },
+      ::testing::ExitedWithCode(0), "");
+}
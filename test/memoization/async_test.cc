@@ -0,0 +1,139 @@
+/*
+ * Copyright (C) 2024  OverbearingPearl
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ * The above copyright notice and this permission notice shall be included in
+ * all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+ * THE SOFTWARE.
+ */
+
+#include <gtest/gtest.h>
+
+#include <atomic>
+#include <chrono>
+#include <functional>
+#include <future>
+#include <memory>
+#include <stdexcept>
+#include <string>
+#include <thread>
+#include <tuple>
+
+#include "src/side_effects/cache/cache_lru.h"
+#include "src/side_effects/concurrency/work_stealing_pool.h"
+#include "src/side_effects/memoization/memo_table.h"
+#include "src/side_effects/memoization/memoization.h"
+
+TEST(Memoization, Async_ConcurrentCallers_ShareOneComputation) {
+  side_effects::memoization::Memoization memoization;
+  std::atomic<int> calls(0);
+  std::promise<void> release;
+  std::shared_future<void> released = release.get_future().share();
+  auto slow = memoization.MemoizeAsync(std::function<int(int)>([&](int n) {
+    ++calls;
+    released.wait();
+    return n + 1;
+  }));
+  std::shared_future<int> first = slow(41);
+  std::shared_future<int> second = slow(41);
+  EXPECT_EQ(first.wait_for(std::chrono::milliseconds(0)),
+            std::future_status::timeout);
+  release.set_value();
+  EXPECT_EQ(first.get(), 42);
+  EXPECT_EQ(second.get(), 42);
+  EXPECT_EQ(calls.load(), 1);
+}
+
+TEST(Memoization, Async_ResolvedValue_CachedAndReturnedReady) {
+  side_effects::memoization::Memoization memoization;
+  std::atomic<int> calls(0);
+  auto length = memoization.MemoizeAsync(
+      std::function<size_t(std::string)>([&calls](std::string s) {
+        ++calls;
+        return s.size();
+      }),
+      side_effects::cache::CacheWithLruPolicy<std::tuple<std::string>,
+                                              size_t>(4));
+  EXPECT_EQ(length("four").get(), 4);
+  std::shared_future<size_t> hit = length("four");
+  EXPECT_EQ(hit.wait_for(std::chrono::milliseconds(0)),
+            std::future_status::ready);
+  EXPECT_EQ(hit.get(), 4);
+  EXPECT_EQ(calls.load(), 1);
+  EXPECT_EQ(length.CacheSize(), 1);
+  EXPECT_EQ(length.Stats().hits, 1);
+}
+
+TEST(Memoization, Async_Throwing_DeliveredThroughFutureAndNotCached) {
+  side_effects::memoization::Memoization memoization;
+  std::atomic<int> calls(0);
+  auto fail = memoization.MemoizeAsync(
+      std::function<int(int)>([&calls](int /*n*/) -> int {
+        ++calls;
+        throw std::runtime_error("no");
+      }));
+  EXPECT_THROW(fail(1).get(), std::runtime_error);
+  EXPECT_THROW(fail(1).get(), std::runtime_error);
+  EXPECT_EQ(calls.load(), 2);
+  EXPECT_EQ(fail.CacheSize(), 0);
+}
+
+TEST(Memoization, Async_CustomExecutor_RunsTheMisses) {
+  side_effects::memoization::Memoization memoization;
+  side_effects::concurrency::WorkStealingPool pool(2);
+  std::atomic<int> submitted(0);
+  side_effects::concurrency::Executor executor =
+      [&](std::function<void()> task) {
+        ++submitted;
+        pool.Submit(std::move(task));
+      };
+  auto square = memoization.MemoizeAsync(
+      std::function<int(int)>([](int n) { return n * n; }),
+      side_effects::cache::CacheWithNoPolicy<std::tuple<int>, int>(),
+      executor);
+  EXPECT_EQ(square(3).get(), 9);
+  EXPECT_EQ(square(3).get(), 9);
+  EXPECT_EQ(square(4).get(), 16);
+  EXPECT_EQ(submitted.load(), 2);
+}
+
+TEST(Memoization, Async_SynchronousCaller_JoinsPendingComputation) {
+  using Table = side_effects::memoization::MemoTable<
+      std::tuple<int>, int,
+      side_effects::cache::CacheWithNoPolicy<std::tuple<int>, int>>;
+  auto table = std::make_shared<Table>(
+      side_effects::cache::CacheWithNoPolicy<std::tuple<int>, int>());
+  std::atomic<int> calls(0);
+  std::promise<void> release;
+  std::shared_future<void> released = release.get_future().share();
+  auto key = std::make_tuple(7);
+  uint64_t hash = Table::CacheType::HashOf(key);
+  std::shared_future<int> pending = table->GetOrComputeAsync(
+      key, hash,
+      [&](const std::tuple<int>& k) {
+        ++calls;
+        released.wait();
+        return std::get<0>(k);
+      },
+      side_effects::concurrency::WorkStealingPool::Default().AsExecutor());
+  std::thread releaser([&release]() {
+    std::this_thread::sleep_for(std::chrono::milliseconds(10));
+    release.set_value();
+  });
+  EXPECT_EQ(table->GetOrCompute(key, hash, [&calls]() { return ++calls; }), 7);
+  releaser.join();
+  EXPECT_EQ(pending.get(), 7);
+  EXPECT_EQ(calls.load(), 1);
+}
@@ -0,0 +1,223 @@
+/*
+ * Copyright (C) 2024  OverbearingPearl
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ * The above copyright notice and this permission notice shall be included in
+ * all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+ * THE SOFTWARE.
+ */
+
+#include <gtest/gtest.h>
+
+#include <atomic>
+#include <chrono>
+#include <functional>
+#include <memory>
+#include <mutex>
+#include <stdexcept>
+#include <string>
+#include <thread>
+#include <tuple>
+#include <vector>
+
+#include "src/side_effects/cache/cache_lru.h"
+#include "src/side_effects/concurrency/executor.h"
+#include "src/side_effects/memoization/memoization.h"
+
+namespace {
+
+std::vector<std::tuple<int>> Args(const std::vector<int>& values) {
+  std::vector<std::tuple<int>> args;
+  for (int value : values) {
+    args.push_back(std::make_tuple(value));
+  }
+  return args;
+}
+
+// Runs each task on its own thread; Join waits for all of them.
+class ThreadPerTask {
+ public:
+  side_effects::concurrency::Executor AsExecutor() {
+    return [this](std::function<void()> task) {
+      std::lock_guard<std::mutex> lock(mutex_);
+      threads_.emplace_back(task);
+    };
+  }
+
+  void Join() {
+    for (auto& thread : threads_) {
+      thread.join();
+    }
+  }
+
+  size_t Spawned() const { return threads_.size(); }
+
+ private:
+  std::mutex mutex_;
+  std::vector<std::thread> threads_;
+};
+
+}  // namespace
+
+TEST(Memoization, Batch_MixedHitsAndMisses_ResultsInInputOrder) {
+  side_effects::memoization::Memoization memoization;
+  std::atomic<int> calls(0);
+  auto square = memoization.Memoize(std::function<int(int)>([&calls](int n) {
+    ++calls;
+    return n * n;
+  }));
+  square(3);
+  std::vector<int> results = square.Batch(Args({5, 3, 7, 5, 1, 7}));
+  EXPECT_EQ(results, (std::vector<int>{25, 9, 49, 25, 1, 49}));
+  // 3 was cached; the repeated 5 and 7 are computed once.
+  EXPECT_EQ(calls.load(), 4);
+  EXPECT_EQ(square.CacheSize(), 4);
+  EXPECT_EQ(square.Stats().hits, 1);
+  EXPECT_EQ(square.Stats().loads, 4);
+}
+
+TEST(Memoization, Batch_MultipleArguments_ConvertedToKey) {
+  side_effects::memoization::Memoization memoization;
+  auto join = memoization.Memoize(std::function<std::string(std::string, int)>(
+      [](std::string s, int n) { return s + std::to_string(n); }));
+  std::vector<std::tuple<const char*, int>> args = {
+      std::make_tuple("a", 1), std::make_tuple("b", 2)};
+  EXPECT_EQ(join.Batch(args), (std::vector<std::string>{"a1", "b2"}));
+  EXPECT_EQ(join("a", 1), "a1");
+  EXPECT_EQ(join.Stats().hits, 1);
+}
+
+TEST(Memoization, Batch_WithExecutor_ComputesMissesConcurrently) {
+  side_effects::memoization::Memoization memoization;
+  std::atomic<int> running(0);
+  std::atomic<int> most_running(0);
+  auto slow = memoization.Memoize(std::function<int(int)>([&](int n) {
+    int now = ++running;
+    int seen = most_running.load();
+    while (now > seen && !most_running.compare_exchange_weak(seen, now)) {
+    }
+    std::this_thread::sleep_for(std::chrono::milliseconds(20));
+    --running;
+    return -n;
+  }));
+  ThreadPerTask pool;
+  std::vector<int> results = slow.Batch(Args({1, 2, 3, 4}), pool.AsExecutor());
+  pool.Join();
+  EXPECT_EQ(results, (std::vector<int>{-1, -2, -3, -4}));
+  EXPECT_EQ(pool.Spawned(), 4);
+  EXPECT_GT(most_running.load(), 1);
+}
+
+TEST(Memoization, Batch_ExecutorThrowsOnSubmit_RemainingLoadsRunInline) {
+  side_effects::memoization::Memoization memoization;
+  std::atomic<int> calls(0);
+  auto square = memoization.Memoize(std::function<int(int)>([&calls](int n) {
+    ++calls;
+    return n * n;
+  }));
+  ThreadPerTask pool;
+  side_effects::concurrency::Executor accepting = pool.AsExecutor();
+  size_t submits = 0;
+  side_effects::concurrency::Executor refusing =
+      [&](std::function<void()> task) {
+        if (++submits > 1) {
+          throw std::runtime_error("queue full");
+        }
+        accepting(task);
+      };
+  EXPECT_EQ(square.Batch(Args({1, 2, 3}), refusing),
+            (std::vector<int>{1, 4, 9}));
+  pool.Join();
+  EXPECT_EQ(pool.Spawned(), 1);
+  EXPECT_EQ(calls.load(), 3);
+  // Nothing was left in flight.
+  EXPECT_EQ(square(2), 4);
+  EXPECT_EQ(square(3), 9);
+  EXPECT_EQ(calls.load(), 3);
+}
+
+TEST(Memoization, Batch_ThrowingKey_RethrowsAndCachesTheRest) {
+  side_effects::memoization::Memoization memoization;
+  auto checked = memoization.Memoize(std::function<int(int)>([](int n) {
+    if (n < 0) {
+      throw std::invalid_argument("negative");
+    }
+    return n;
+  }));
+  EXPECT_THROW(checked.Batch(Args({1, -1, 2})), std::invalid_argument);
+  EXPECT_EQ(checked.CacheSize(), 2);
+  EXPECT_EQ(checked.Stats().load_failures, 1);
+}
+
+TEST(Memoization, Batch_FunctionCallsItselfForBatchKeys_ComputesEachOnce) {
+  side_effects::memoization::Memoization memoization;
+  using Fib = decltype(memoization.Memoize(std::function<long(int)>()));
+  std::atomic<int> calls(0);
+  std::unique_ptr<Fib> fib;
+  fib.reset(new Fib(memoization.Memoize(
+      std::function<long(int)>([&calls, &fib](int n) -> long {
+        ++calls;
+        return n < 2 ? n : (*fib)(n - 1) + (*fib)(n - 2);
+      }))));
+  // Computing 5 needs 4 before the batch gets to it.
+  EXPECT_EQ(fib->Batch(Args({5, 4})), (std::vector<long>{5, 3}));
+  EXPECT_EQ(calls.load(), 6);
+  ThreadPerTask pool;
+  EXPECT_EQ(fib->Batch(Args({12, 11, 10, 9}), pool.AsExecutor()),
+            (std::vector<long>{144, 89, 55, 34}));
+  pool.Join();
+  EXPECT_EQ(calls.load(), 13);
+}
+
+TEST(Memoization, Batch_FunctionDependsOnItself_Throws) {
+  side_effects::memoization::Memoization memoization;
+  using Loop = decltype(memoization.Memoize(std::function<int(int)>()));
+  std::unique_ptr<Loop> loop;
+  loop.reset(new Loop(memoization.Memoize(
+      std::function<int(int)>([&loop](int n) { return (*loop)(n); }))));
+  EXPECT_THROW(loop->Batch(Args({1, 2})), std::logic_error);
+  EXPECT_EQ(loop->CacheSize(), 0);
+}
+
+TEST(Memoization, Batch_BoundedCache_StillReturnsEveryResult) {
+  side_effects::memoization::Memoization memoization;
+  auto twice = memoization.Memoize(
+      std::function<int(int)>([](int n) { return 2 * n; }),
+      side_effects::cache::CacheWithLruPolicy<std::tuple<int>, int>(2));
+  std::vector<int> results = twice.Batch(Args({1, 2, 3, 4, 5}));
+  EXPECT_EQ(results, (std::vector<int>{2, 4, 6, 8, 10}));
+  EXPECT_EQ(twice.CacheSize(), 2);
+}
+
+TEST(Memoization, Batch_Sharded_ResultsInInputOrder) {
+  side_effects::memoization::Memoization memoization;
+  std::atomic<int> calls(0);
+  auto square = memoization.MemoizeSharded<
+      side_effects::cache::CacheWithLruPolicy<std::tuple<int>, int>>(
+      std::function<int(int)>([&calls](int n) {
+        ++calls;
+        return n * n;
+      }),
+      64, 4);
+  std::vector<int> values;
+  std::vector<int> expected;
+  for (int i = 0; i < 40; ++i) {
+    values.push_back(i % 20);
+    expected.push_back((i % 20) * (i % 20));
+  }
+  EXPECT_EQ(square.Batch(Args(values)), expected);
+  EXPECT_EQ(calls.load(), 20);
+  EXPECT_EQ(square.Stats().loads, 20);
+}
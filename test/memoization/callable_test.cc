@@ -0,0 +1,127 @@
+/*
+ * Copyright (C) 2024  OverbearingPearl
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ * The above copyright notice and this permission notice shall be included in
+ * all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+ * THE SOFTWARE.
+ */
+
+#include <gtest/gtest.h>
+
+#include <functional>
+#include <string>
+#include <tuple>
+#include <vector>
+
+#include "src/side_effects/cache/cache_lru.h"
+#include "src/side_effects/memoization/memoization.h"
+
+namespace {
+
+int calls = 0;
+
+int CountedSquare(int n) {
+  ++calls;
+  return n * n;
+}
+
+struct Account {
+  int Balance(int month) const {
+    ++lookups;
+    return month * 100;
+  }
+
+  mutable int lookups = 0;
+};
+
+struct Repeat {
+  std::string operator()(const std::string& s, int times) const {
+    ++*count;
+    std::string result;
+    for (int i = 0; i < times; ++i) {
+      result += s;
+    }
+    return result;
+  }
+
+  int* count;
+};
+
+}  // namespace
+
+TEST(Memoization, Callable_PlainLambda_MemoizedWithoutStdFunction) {
+  side_effects::memoization::Memoization memoization;
+  int count = 0;
+  auto square = memoization.Memoize([&count](int n) {
+    ++count;
+    return n * n;
+  });
+  EXPECT_EQ(square(4), 16);
+  EXPECT_EQ(square(4), 16);
+  EXPECT_EQ(count, 1);
+}
+
+TEST(Memoization, Callable_FunctionPointer_Memoized) {
+  side_effects::memoization::Memoization memoization;
+  calls = 0;
+  auto square = memoization.Memoize(&CountedSquare);
+  auto square_by_name = memoization.Memoize(CountedSquare);
+  EXPECT_EQ(square(5), 25);
+  EXPECT_EQ(square(5), 25);
+  EXPECT_EQ(square_by_name(5), 25);
+  EXPECT_EQ(calls, 2);  // The two memoized functions have separate caches.
+}
+
+TEST(Memoization, Callable_Functor_MemoizedWithPolicy) {
+  side_effects::memoization::Memoization memoization;
+  int count = 0;
+  auto repeat = memoization.Memoize(
+      Repeat{&count},
+      side_effects::cache::CacheWithLruPolicy<std::tuple<std::string, int>,
+                                              std::string>(1));
+  EXPECT_EQ(repeat("ab", 2), "abab");
+  EXPECT_EQ(repeat("ab", 2), "abab");
+  EXPECT_EQ(repeat("c", 3), "ccc");
+  EXPECT_EQ(repeat("ab", 2), "abab");
+  EXPECT_EQ(count, 3);
+}
+
+TEST(Memoization, Callable_ConstMemberFunction_KeyedByObject) {
+  side_effects::memoization::Memoization memoization;
+  Account first;
+  Account second;
+  auto balance = memoization.Memoize(&Account::Balance);
+  EXPECT_EQ(balance(&first, 2), 200);
+  EXPECT_EQ(balance(&first, 2), 200);
+  EXPECT_EQ(balance(&second, 2), 200);
+  EXPECT_EQ(first.lookups, 1);
+  EXPECT_EQ(second.lookups, 1);
+}
+
+TEST(Memoization, Callable_Lambda_BatchAndShardedAndAsync) {
+  side_effects::memoization::Memoization memoization;
+  auto negate = [](int n) { return -n; };
+  auto batched = memoization.Memoize(negate);
+  std::vector<std::tuple<int>> args = {std::make_tuple(1),
+                                       std::make_tuple(2)};
+  EXPECT_EQ(batched.Batch(args), (std::vector<int>{-1, -2}));
+  auto sharded = memoization.MemoizeSharded(
+      negate, side_effects::cache::CacheWithNoPolicy<std::tuple<int>, int>(),
+      4);
+  EXPECT_EQ(sharded(7), -7);
+  auto async = memoization.MemoizeAsync(negate);
+  EXPECT_EQ(async(9).get(), -9);
+}
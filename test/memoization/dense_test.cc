@@ -0,0 +1,218 @@
+/*
+ * Copyright (C) 2024  OverbearingPearl
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ * The above copyright notice and this permission notice shall be included in
+ * all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+ * THE SOFTWARE.
+ */
+
+#include <gtest/gtest.h>
+
+#include <atomic>
+#include <chrono>
+#include <cstdint>
+#include <functional>
+#include <stdexcept>
+#include <thread>
+#include <tuple>
+#include <type_traits>
+#include <vector>
+
+#include "src/side_effects/memoization/dense_table.h"
+#include "src/side_effects/memoization/memoization.h"
+
+using side_effects::memoization::DenseBounds;
+using side_effects::memoization::DenseRange;
+using side_effects::memoization::DenseTable;
+
+namespace {
+
+enum class Color { kRed, kGreen, kBlue };
+
+}  // namespace
+
+namespace side_effects {
+namespace memoization {
+
+template <>
+struct DenseKeyRange<Color> {
+  using type = DenseRange<Color, Color::kRed, Color::kBlue>;
+};
+
+}  // namespace memoization
+}  // namespace side_effects
+
+TEST(Memoization, Dense_Grid_EachCellComputedOnce) {
+  side_effects::memoization::Memoization memoization;
+  std::atomic<int> calls(0);
+  auto product = memoization.Memoize(
+      [&calls](int row, int column) {
+        ++calls;
+        return row * column;
+      },
+      DenseBounds<DenseRange<int, -4, 4>, DenseRange<int, 0, 9>>());
+  for (int round = 0; round < 2; ++round) {
+    for (int row = -4; row <= 4; ++row) {
+      for (int column = 0; column <= 9; ++column) {
+        EXPECT_EQ(product(row, column), row * column);
+      }
+    }
+  }
+  EXPECT_EQ(calls.load(), 90);
+  EXPECT_EQ(product.CacheSize(), 90);
+}
+
+TEST(Memoization, Dense_OutOfRange_Throws) {
+  side_effects::memoization::Memoization memoization;
+  auto twice = memoization.Memoize([](int n) { return 2 * n; },
+                                   DenseBounds<DenseRange<int, 0, 7>>());
+  EXPECT_EQ(twice(7), 14);
+  EXPECT_THROW(twice(8), std::out_of_range);
+  EXPECT_THROW(twice(-1), std::out_of_range);
+}
+
+TEST(Memoization, Dense_DeclaredKeyRange_SelectedByDefault) {
+  side_effects::memoization::Memoization memoization;
+  std::atomic<int> calls(0);
+  auto weight = memoization.Memoize([&calls](Color color, bool bright) {
+    ++calls;
+    return static_cast<int>(color) * 2 + (bright ? 1 : 0);
+  });
+  static_assert(
+      std::is_same<decltype(weight)::Table,
+                   DenseTable<int, DenseRange<Color, Color::kRed,
+                                              Color::kBlue>,
+                              DenseRange<bool, false, true>>>::value,
+      "Color and bool arguments select a DenseTable");
+  EXPECT_EQ(weight(Color::kBlue, true), 5);
+  EXPECT_EQ(weight(Color::kBlue, true), 5);
+  EXPECT_EQ(weight(Color::kRed, false), 0);
+  EXPECT_EQ(calls.load(), 2);
+
+  auto mixed = memoization.Memoize([](Color /*color*/, int n) { return n; });
+  static_assert(!std::is_same<decltype(mixed)::Table,
+                              DenseTable<int>>::value,
+                "an int argument without bounds keeps the MemoTable");
+  EXPECT_EQ(mixed(Color::kGreen, 1000), 1000);
+}
+
+TEST(Memoization, Dense_Recursive_SubproblemsComputedOnce) {
+  side_effects::memoization::Memoization memoization;
+  using Fib = std::function<int64_t(int)>;
+  std::atomic<int> calls(0);
+  auto fib = memoization.MemoizeRecursive<Fib>(
+      [&calls](const Fib& self, int n) -> int64_t {
+        ++calls;
+        return n < 2 ? n : self(n - 1) + self(n - 2);
+      },
+      DenseBounds<DenseRange<int, 0, 90>>());
+  EXPECT_EQ(fib(90), 2880067194370816120LL);
+  EXPECT_EQ(calls.load(), 91);
+  EXPECT_EQ(fib.CacheSize(), 91);
+}
+
+TEST(Memoization, Dense_ThrowingLoad_NotCached) {
+  side_effects::memoization::Memoization memoization;
+  std::atomic<int> calls(0);
+  auto flaky = memoization.Memoize(
+      [&calls](int n) -> int {
+        if (++calls == 1) {
+          throw std::runtime_error("first call fails");
+        }
+        return n;
+      },
+      DenseBounds<DenseRange<int, 0, 3>>());
+  EXPECT_THROW(flaky(2), std::runtime_error);
+  EXPECT_EQ(flaky.CacheSize(), 0);
+  EXPECT_EQ(flaky(2), 2);
+  EXPECT_EQ(flaky.CacheSize(), 1);
+}
+
+TEST(Memoization, Dense_ConcurrentMisses_ComputedOnce) {
+  side_effects::memoization::Memoization memoization;
+  std::atomic<int> calls(0);
+  auto slow = memoization.Memoize(
+      [&calls](int n) {
+        ++calls;
+        std::this_thread::sleep_for(std::chrono::milliseconds(20));
+        return n + 1;
+      },
+      DenseBounds<DenseRange<int, 0, 3>>());
+  std::vector<std::thread> threads;
+  for (int i = 0; i < 8; ++i) {
+    threads.emplace_back([&slow]() { EXPECT_EQ(slow(3), 4); });
+  }
+  for (auto& thread : threads) {
+    thread.join();
+  }
+  EXPECT_EQ(calls.load(), 1);
+}
+
+TEST(Memoization, Dense_SelectedByDefault_OffersStatsLatencyAndBatch) {
+  side_effects::memoization::Memoization memoization;
+  std::atomic<int> calls(0);
+  auto weight = memoization.Memoize([&calls](Color color, bool bright) {
+    ++calls;
+    return static_cast<int>(color) * 2 + (bright ? 1 : 0);
+  });
+  weight.EnableLoadLatency();
+  EXPECT_EQ(weight(Color::kGreen, false), 2);
+  EXPECT_EQ(weight(Color::kGreen, false), 2);
+  std::vector<std::tuple<Color, bool>> args = {
+      std::make_tuple(Color::kRed, true),
+      std::make_tuple(Color::kGreen, false),
+      std::make_tuple(Color::kBlue, true),
+      std::make_tuple(Color::kRed, true)};
+  EXPECT_EQ(weight.Batch(args), (std::vector<int>{1, 2, 5, 1}));
+  EXPECT_EQ(calls.load(), 3);
+
+  side_effects::cache::CacheStats stats = weight.Stats();
+  EXPECT_EQ(stats.hits, 2u);
+  EXPECT_EQ(stats.misses, 4u);
+  EXPECT_EQ(stats.inserts, 3u);
+  EXPECT_EQ(stats.loads, 3u);
+  EXPECT_EQ(stats.load_failures, 0u);
+  EXPECT_EQ(stats.size, 3u);
+  EXPECT_EQ(weight.LoadLatency().Count(), 3u);
+}
+
+TEST(Memoization, Dense_BatchOnExecutor_KeepsLoadsThatSucceeded) {
+  side_effects::memoization::Memoization memoization;
+  std::atomic<int> calls(0);
+  auto checked = memoization.Memoize(
+      [&calls](int n) -> int {
+        ++calls;
+        if (n % 2 == 1) {
+          throw std::runtime_error("odd");
+        }
+        return n * 10;
+      },
+      DenseBounds<DenseRange<int, 0, 7>>());
+  side_effects::concurrency::Executor executor =
+      [](std::function<void()> task) { std::thread(task).join(); };
+  std::vector<std::tuple<int>> args = {std::make_tuple(0), std::make_tuple(2),
+                                       std::make_tuple(4)};
+  EXPECT_EQ(checked.Batch(args, executor), (std::vector<int>{0, 20, 40}));
+  args.push_back(std::make_tuple(5));
+  args.push_back(std::make_tuple(6));
+  EXPECT_THROW(checked.Batch(args, executor), std::runtime_error);
+  EXPECT_EQ(checked.CacheSize(), 4u);
+  EXPECT_EQ(checked.Stats().load_failures, 1u);
+  EXPECT_EQ(calls.load(), 5);
+  args.push_back(std::make_tuple(8));
+  EXPECT_THROW(checked.Batch(args), std::out_of_range);
+  EXPECT_EQ(calls.load(), 5);
+}
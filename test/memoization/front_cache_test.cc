@@ -0,0 +1,123 @@
+/*
+ * Copyright (C) 2024  OverbearingPearl
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ * The above copyright notice and this permission notice shall be included in
+ * all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+ * THE SOFTWARE.
+ */
+
+#include <gtest/gtest.h>
+
+#include <atomic>
+#include <functional>
+#include <string>
+#include <thread>
+#include <tuple>
+#include <vector>
+
+#include "src/side_effects/cache/cache_lru.h"
+#include "src/side_effects/memoization/memoization.h"
+
+TEST(Memoization, FrontCache_RepeatedCall_ServedWithoutPolicy) {
+  side_effects::memoization::Memoization memoization;
+  std::atomic<int> calls(0);
+  auto square = memoization.MemoizeWithFrontCache(
+      std::function<int(int)>([&calls](int n) {
+        ++calls;
+        return n * n;
+      }),
+      side_effects::cache::CacheWithLruPolicy<std::tuple<int>, int>(8));
+  EXPECT_EQ(square(3), 9);
+  EXPECT_EQ(square(3), 9);
+  EXPECT_EQ(square(3), 9);
+  EXPECT_EQ(calls.load(), 1);
+  side_effects::cache::CacheStats stats = square.Stats();
+  EXPECT_EQ(stats.misses, 1);
+  EXPECT_EQ(stats.hits, 0);
+}
+
+TEST(Memoization, FrontCache_EvictedFromTable_Recomputed) {
+  side_effects::memoization::Memoization memoization;
+  std::atomic<int> calls(0);
+  auto square = memoization.MemoizeWithFrontCache(
+      std::function<int(int)>([&calls](int n) {
+        ++calls;
+        return n * n;
+      }),
+      side_effects::cache::CacheWithLruPolicy<std::tuple<int>, int>(1));
+  square(1);
+  square(2);  // Evicts 1 from the table, and so from the front tier.
+  EXPECT_EQ(square(1), 1);
+  EXPECT_EQ(calls.load(), 3);
+  EXPECT_EQ(square.CacheSize(), 1);
+}
+
+TEST(Memoization, FrontCache_OtherThread_HitsSharedTable) {
+  side_effects::memoization::Memoization memoization;
+  std::atomic<int> calls(0);
+  auto square = memoization.MemoizeWithFrontCache(
+      std::function<int(int)>([&calls](int n) {
+        ++calls;
+        return n * n;
+      }),
+      side_effects::cache::CacheWithLruPolicy<std::tuple<int>, int>(8));
+  square(4);
+  std::thread other([&square]() {
+    EXPECT_EQ(square(4), 16);
+    EXPECT_EQ(square(4), 16);
+  });
+  other.join();
+  EXPECT_EQ(calls.load(), 1);
+  // The other thread's first call missed its own front cache only.
+  EXPECT_EQ(square.Stats().hits, 1);
+}
+
+TEST(Memoization, FrontCache_StringProbe_HitsWithoutCopy) {
+  side_effects::memoization::Memoization memoization;
+  std::atomic<int> calls(0);
+  auto length = memoization.MemoizeWithFrontCache(
+      std::function<size_t(const std::string&)>(
+          [&calls](const std::string& s) {
+            ++calls;
+            return s.size();
+          }));
+  EXPECT_EQ(length("hello"), 5);
+  EXPECT_EQ(length("hello"), 5);
+  EXPECT_EQ(length(std::string("hello")), 5);
+  EXPECT_EQ(length("world!"), 6);
+  EXPECT_EQ(calls.load(), 2);
+}
+
+TEST(Memoization, FrontCache_ManyFunctionsOnOneThread_StayCorrect) {
+  side_effects::memoization::Memoization memoization;
+  using Memoized = decltype(memoization.MemoizeWithFrontCache(
+      std::function<int(int)>()));
+  std::atomic<int> calls(0);
+  std::vector<Memoized> functions;
+  for (int offset = 0; offset < 40; ++offset) {
+    functions.push_back(memoization.MemoizeWithFrontCache(
+        std::function<int(int)>([&calls, offset](int n) {
+          ++calls;
+          return n + offset;
+        })));
+  }
+  for (int round = 0; round < 3; ++round) {
+    for (int offset = 0; offset < 40; ++offset) {
+      EXPECT_EQ(functions[offset](1), 1 + offset);
+    }
+  }
+  EXPECT_EQ(calls.load(), 40);
+}
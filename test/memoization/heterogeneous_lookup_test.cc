@@ -0,0 +1,113 @@
+/*
+ * Copyright (C) 2024  OverbearingPearl
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ * The above copyright notice and this permission notice shall be included in
+ * all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+ * THE SOFTWARE.
+ */
+
+#include <gtest/gtest.h>
+
+#include <cstddef>
+#include <functional>
+#include <string>
+#include <tuple>
+
+#include "src/side_effects/cache/cache_lru.h"
+#include "src/side_effects/memoization/memoization.h"
+
+namespace {
+
+struct Tracked {
+  explicit Tracked(int id) : id(id) {}
+  Tracked(const Tracked& other) : id(other.id) { ++copies; }
+  Tracked(Tracked&& other) : id(other.id) {}
+  Tracked& operator=(const Tracked& other) {
+    id = other.id;
+    ++copies;
+    return *this;
+  }
+  Tracked& operator=(Tracked&& other) {
+    id = other.id;
+    return *this;
+  }
+  bool operator==(const Tracked& other) const { return id == other.id; }
+
+  int id;
+  static int copies;
+};
+
+int Tracked::copies = 0;
+
+}  // namespace
+
+namespace std {
+template <>
+struct hash<Tracked> {
+  size_t operator()(const Tracked& tracked) const {
+    return std::hash<int>()(tracked.id);
+  }
+};
+}  // namespace std
+
+TEST(Memoization, HeterogeneousLookup_Hit_CopiesNoArguments) {
+  side_effects::memoization::Memoization memoization;
+  auto id_of = memoization.Memoize(
+      std::function<int(const Tracked&)>(
+          [](const Tracked& tracked) { return tracked.id; }),
+      side_effects::cache::CacheWithLruPolicy<std::tuple<Tracked>, int>(4));
+
+  Tracked argument(7);
+  EXPECT_EQ(id_of(argument), 7);
+  Tracked::copies = 0;
+  EXPECT_EQ(id_of(argument), 7);
+  EXPECT_EQ(id_of(argument), 7);
+  EXPECT_EQ(Tracked::copies, 0);
+}
+
+TEST(Memoization, HeterogeneousLookup_Miss_MaterializesKeyOnce) {
+  side_effects::memoization::Memoization memoization;
+  auto id_of = memoization.Memoize(
+      std::function<int(const Tracked&)>(
+          [](const Tracked& tracked) { return tracked.id; }),
+      side_effects::cache::CacheWithLruPolicy<std::tuple<Tracked>, int>(4));
+
+  Tracked argument(3);
+  Tracked::copies = 0;
+  EXPECT_EQ(id_of(argument), 3);
+  // One copy into the key, one for the in-flight entry.
+  EXPECT_LE(Tracked::copies, 2);
+}
+
+TEST(Memoization, HeterogeneousLookup_ReferenceParameters_KeyOwnsCopies) {
+  side_effects::memoization::Memoization memoization;
+  int calls = 0;
+  auto repeat_length = memoization.Memoize(
+      std::function<size_t(const std::string&, const int&)>(
+          [&calls](const std::string& text, const int& times) {
+            ++calls;
+            return text.size() * times;
+          }));
+
+  {
+    std::string text("temporary");
+    int times = 2;
+    EXPECT_EQ(repeat_length(text, times), 18);
+  }
+  EXPECT_EQ(repeat_length(std::string("temporary"), 2), 18);
+  EXPECT_EQ(repeat_length("temporary", 2L), 18);
+  EXPECT_EQ(calls, 1);
+}
@@ -0,0 +1,143 @@
+/*
+ * Copyright (C) 2024  OverbearingPearl
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ * The above copyright notice and this permission notice shall be included in
+ * all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+ * THE SOFTWARE.
+ */
+
+#include <gtest/gtest.h>
+
+#include <atomic>
+#include <functional>
+#include <thread>
+#include <tuple>
+#include <vector>
+
+#include "src/side_effects/cache/cache_lru.h"
+#include "src/side_effects/cache/cache_sieve.h"
+#include "src/side_effects/concurrency/shared_mutex.h"
+#include "src/side_effects/memoization/memoization.h"
+
+namespace {
+
+using Lru = side_effects::cache::CacheWithLruPolicy<std::tuple<int>, int>;
+
+std::function<int(int)> CountingSquare(std::atomic<int>* calls) {
+  return [calls](int n) {
+    ++*calls;
+    return n * n;
+  };
+}
+
+}  // namespace
+
+TEST(Memoization, ReadMostly_RepeatedCall_ComputedOnceAndCountedAsHit) {
+  side_effects::memoization::Memoization memoization;
+  std::atomic<int> calls(0);
+  auto square = memoization.MemoizeReadMostly(CountingSquare(&calls), Lru(8));
+  EXPECT_EQ(square(3), 9);
+  EXPECT_EQ(square(3), 9);
+  EXPECT_EQ(square(3), 9);
+  EXPECT_EQ(calls.load(), 1);
+  side_effects::cache::CacheStats stats = square.Stats();
+  EXPECT_EQ(stats.misses, 1);
+  EXPECT_EQ(stats.hits, 2);
+}
+
+TEST(Memoization, ReadMostly_DeferredHit_AppliedBeforeEviction) {
+  side_effects::memoization::Memoization memoization;
+  std::atomic<int> calls(0);
+  auto square = memoization.MemoizeReadMostly(CountingSquare(&calls), Lru(2));
+  square(1);
+  square(2);
+  square(1);  // Only recorded; 1 becomes most recent when 3 is inserted.
+  square(3);
+  EXPECT_EQ(calls.load(), 3);
+  square(1);
+  EXPECT_EQ(calls.load(), 3);
+  square(2);
+  EXPECT_EQ(calls.load(), 4);
+}
+
+TEST(Memoization, ReadMostly_MoreHitsThanBufferHolds_RecencyKept) {
+  side_effects::memoization::Memoization memoization;
+  std::atomic<int> calls(0);
+  auto square = memoization.MemoizeReadMostly(CountingSquare(&calls), Lru(2));
+  square(1);
+  square(2);
+  for (int i = 0; i < 1000; ++i) {
+    square(2);
+    square(1);
+  }
+  square(3);  // Evicts 2, the less recent of the two.
+  square(1);
+  EXPECT_EQ(calls.load(), 3);
+  EXPECT_EQ(square.Stats().hits, 2001);
+}
+
+TEST(Memoization, ReadMostly_ConcurrentHitPolicy_ServesHits) {
+  side_effects::memoization::Memoization memoization;
+  std::atomic<int> calls(0);
+  auto square = memoization.MemoizeReadMostly(
+      CountingSquare(&calls),
+      side_effects::cache::CacheWithSievePolicy<std::tuple<int>, int>(8));
+  for (int n = 0; n < 4; ++n) {
+    EXPECT_EQ(square(n), n * n);
+    EXPECT_EQ(square(n), n * n);
+  }
+  EXPECT_EQ(calls.load(), 4);
+  EXPECT_EQ(square.Stats().hits, 4);
+}
+
+TEST(Memoization, ReadMostly_ConcurrentHitsAndMisses_ReturnCorrectValues) {
+  side_effects::memoization::Memoization memoization;
+  std::atomic<int> calls(0);
+  auto square =
+      memoization.MemoizeReadMostly(CountingSquare(&calls), Lru(32));
+  std::vector<std::thread> threads;
+  for (int t = 0; t < 8; ++t) {
+    threads.emplace_back([&square, t]() {
+      for (int i = 0; i < 20000; ++i) {
+        // Mostly a hot set of 16 keys, with a miss every so often.
+        int n = i % 50 == 0 ? (i * 7 + t) % 64 : (i + t) % 16;
+        ASSERT_EQ(square(n), n * n);
+      }
+    });
+  }
+  for (auto& thread : threads) {
+    thread.join();
+  }
+  EXPECT_LE(square.CacheSize(), 32);
+  side_effects::cache::CacheStats stats = square.Stats();
+  EXPECT_EQ(stats.hits + stats.misses, 8 * 20000);
+}
+
+TEST(Memoization, ReadMostlyMutex_TryLockWithReaderIn_FailsAtOnce) {
+  side_effects::concurrency::ReadMostlyMutex mutex;
+  mutex.lock_shared();
+  EXPECT_FALSE(mutex.try_lock());
+  // The failed attempt must not leave readers locked out.
+  std::thread reader([&mutex]() {
+    mutex.lock_shared();
+    mutex.unlock_shared();
+  });
+  reader.join();
+  mutex.unlock_shared();
+  EXPECT_TRUE(mutex.try_lock());
+  EXPECT_FALSE(mutex.try_lock());
+  mutex.unlock();
+}
@@ -0,0 +1,123 @@
+/*
+ * Copyright (C) 2024  OverbearingPearl
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ * The above copyright notice and this permission notice shall be included in
+ * all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+ * THE SOFTWARE.
+ */
+
+#include <gtest/gtest.h>
+
+#include <algorithm>
+#include <atomic>
+#include <functional>
+#include <stdexcept>
+#include <string>
+#include <thread>
+#include <tuple>
+#include <vector>
+
+#include "src/side_effects/cache/cache_lru.h"
+#include "src/side_effects/memoization/memoization.h"
+
+TEST(Memoization, Recursive_Fibonacci_EachStateComputedOnce) {
+  side_effects::memoization::Memoization memoization;
+  std::atomic<int> calls(0);
+  auto fib = memoization.MemoizeRecursive<std::function<int64_t(int)>>(
+      [&calls](const std::function<int64_t(int)>& self, int n) -> int64_t {
+        ++calls;
+        return n < 2 ? n : self(n - 1) + self(n - 2);
+      });
+  EXPECT_EQ(fib(90), 2880067194370816120LL);
+  EXPECT_EQ(calls.load(), 91);
+  EXPECT_EQ(fib.CacheSize(), 91);
+  EXPECT_EQ(fib(50), 12586269025LL);
+  EXPECT_EQ(calls.load(), 91);
+}
+
+TEST(Memoization, Recursive_EditDistance_MultipleArguments) {
+  side_effects::memoization::Memoization memoization;
+  std::string a = "intention";
+  std::string b = "execution";
+  using Distance = std::function<int(size_t, size_t)>;
+  auto distance = memoization.MemoizeRecursive<Distance>(
+      [&a, &b](const Distance& self, size_t i, size_t j) -> int {
+        if (i == a.size()) {
+          return static_cast<int>(b.size() - j);
+        }
+        if (j == b.size()) {
+          return static_cast<int>(a.size() - i);
+        }
+        if (a[i] == b[j]) {
+          return self(i + 1, j + 1);
+        }
+        return 1 + std::min(self(i + 1, j + 1),
+                            std::min(self(i + 1, j), self(i, j + 1)));
+      });
+  EXPECT_EQ(distance(0, 0), 5);
+  EXPECT_LE(distance.CacheSize(), (a.size() + 1) * (b.size() + 1));
+}
+
+TEST(Memoization, Recursive_BoundedPolicy_StillCorrect) {
+  side_effects::memoization::Memoization memoization;
+  using Fib = std::function<int64_t(int)>;
+  auto fib = memoization.MemoizeRecursive<Fib>(
+      [](const Fib& self, int n) -> int64_t {
+        return n < 2 ? n : self(n - 1) + self(n - 2);
+      },
+      side_effects::cache::CacheWithLruPolicy<std::tuple<int>, int64_t>(8));
+  EXPECT_EQ(fib(60), 1548008755920LL);
+  EXPECT_LE(fib.CacheSize(), 8);
+}
+
+TEST(Memoization, Recursive_DeepChain_DoesNotDeadlock) {
+  side_effects::memoization::Memoization memoization;
+  using Sum = std::function<int64_t(int)>;
+  auto sum = memoization.MemoizeRecursive<Sum>(
+      [](const Sum& self, int n) -> int64_t {
+        return n == 0 ? 0 : n + self(n - 1);
+      });
+  EXPECT_EQ(sum(2000), 2001000);
+  EXPECT_EQ(sum.Stats().loads, 2001);
+}
+
+TEST(Memoization, Recursive_CycleOnOneThread_ThrowsInsteadOfDeadlocking) {
+  side_effects::memoization::Memoization memoization;
+  using Loop = std::function<int(int)>;
+  auto loop = memoization.MemoizeRecursive<Loop>(
+      [](const Loop& self, int n) { return self((n + 1) % 3); });
+  EXPECT_THROW(loop(0), std::logic_error);
+  EXPECT_EQ(loop.CacheSize(), 0);
+}
+
+TEST(Memoization, Recursive_ConcurrentCallers_ShareSubproblems) {
+  side_effects::memoization::Memoization memoization;
+  std::atomic<int> calls(0);
+  using Fib = std::function<int64_t(int)>;
+  auto fib = memoization.MemoizeRecursive<Fib>(
+      [&calls](const Fib& self, int n) -> int64_t {
+        ++calls;
+        return n < 2 ? n : self(n - 1) + self(n - 2);
+      });
+  std::vector<std::thread> threads;
+  for (int t = 0; t < 4; ++t) {
+    threads.emplace_back([&fib]() { EXPECT_EQ(fib(80), 23416728348467685LL); });
+  }
+  for (auto& thread : threads) {
+    thread.join();
+  }
+  EXPECT_EQ(calls.load(), 81);
+}
@@ -0,0 +1,135 @@
+/*
+ * Copyright (C) 2024  OverbearingPearl
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ * The above copyright notice and this permission notice shall be included in
+ * all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+ * THE SOFTWARE.
+ */
+
+#include <gtest/gtest.h>
+
+#include <atomic>
+#include <chrono>
+#include <functional>
+#include <thread>
+#include <tuple>
+#include <vector>
+
+#include "src/side_effects/cache/cache_arc.h"
+#include "src/side_effects/cache/cache_clock.h"
+#include "src/side_effects/cache/cache_fifo.h"
+#include "src/side_effects/cache/cache_flush.h"
+#include "src/side_effects/cache/cache_lfu.h"
+#include "src/side_effects/cache/cache_lru.h"
+#include "src/side_effects/cache/cache_rr.h"
+#include "src/side_effects/cache/cache_sieve.h"
+#include "src/side_effects/cache/cache_tinylfu.h"
+#include "src/side_effects/cache/cache_two_queue.h"
+#include "src/side_effects/cache/cache_ttl.h"
+#include "src/side_effects/memoization/memoization.h"
+
+namespace {
+
+template <typename Policy>
+void ExpectCapacitySplitAcrossShards() {
+  side_effects::memoization::Memoization memoization;
+  std::atomic<int> calls(0);
+  auto square = memoization.MemoizeSharded<Policy>(
+      std::function<int(int)>([&calls](int n) {
+        ++calls;
+        return n * n;
+      }),
+      16, 4);
+  EXPECT_EQ(square.ShardCount(), 4);
+  for (int i = 0; i < 100; ++i) {
+    EXPECT_EQ(square(i), i * i);
+  }
+  EXPECT_EQ(calls.load(), 100);
+  EXPECT_LE(square.CacheSize(), 16);
+  EXPECT_EQ(square(99), 99 * 99);
+}
+
+}  // namespace
+
+TEST(Memoization, Sharded_EveryPolicy_BoundedByTotalCapacity) {
+  ExpectCapacitySplitAcrossShards<
+      side_effects::cache::CacheWithArcPolicy<std::tuple<int>, int>>();
+  ExpectCapacitySplitAcrossShards<
+      side_effects::cache::CacheWithClockPolicy<std::tuple<int>, int>>();
+  ExpectCapacitySplitAcrossShards<
+      side_effects::cache::CacheWithFifoPolicy<std::tuple<int>, int>>();
+  ExpectCapacitySplitAcrossShards<
+      side_effects::cache::CacheWithFlushPolicy<std::tuple<int>, int>>();
+  ExpectCapacitySplitAcrossShards<
+      side_effects::cache::CacheWithLfuPolicy<std::tuple<int>, int>>();
+  ExpectCapacitySplitAcrossShards<
+      side_effects::cache::CacheWithLruPolicy<std::tuple<int>, int>>();
+  ExpectCapacitySplitAcrossShards<
+      side_effects::cache::CacheWithRrPolicy<std::tuple<int>, int>>();
+  ExpectCapacitySplitAcrossShards<
+      side_effects::cache::CacheWithSampledLruPolicy<std::tuple<int>, int>>();
+  ExpectCapacitySplitAcrossShards<
+      side_effects::cache::CacheWithSievePolicy<std::tuple<int>, int>>();
+  ExpectCapacitySplitAcrossShards<
+      side_effects::cache::CacheWithTinyLfuPolicy<std::tuple<int>, int>>();
+  ExpectCapacitySplitAcrossShards<
+      side_effects::cache::CacheWithTwoQueuePolicy<std::tuple<int>, int>>();
+}
+
+TEST(Memoization, Sharded_PolicyPrototype_CopiedToEveryShard) {
+  side_effects::memoization::Memoization memoization;
+  std::atomic<int> calls(0);
+  auto square = memoization.MemoizeSharded(
+      std::function<int(int)>([&calls](int n) {
+        ++calls;
+        return n * n;
+      }),
+      side_effects::cache::CacheWithTtlPolicy<std::tuple<int>, int>(
+          std::chrono::milliseconds(60000)),
+      8);
+  EXPECT_EQ(square.ShardCount(), 8);
+  for (int i = 0; i < 32; ++i) {
+    EXPECT_EQ(square(i), i * i);
+    EXPECT_EQ(square(i), i * i);
+  }
+  EXPECT_EQ(calls.load(), 32);
+  EXPECT_EQ(square.CacheSize(), 32);
+}
+
+TEST(Memoization, Sharded_ConcurrentCallers_SeeConsistentResults) {
+  side_effects::memoization::Memoization memoization;
+  auto square = memoization.MemoizeSharded<
+      side_effects::cache::CacheWithLruPolicy<std::tuple<int>, int>>(
+      std::function<int(int)>([](int n) { return n * n; }), 64, 8);
+
+  std::atomic<int> mismatches(0);
+  std::vector<std::thread> workers;
+  for (int t = 0; t < 4; ++t) {
+    workers.emplace_back([&square, &mismatches, t]() {
+      for (int i = 0; i < 500; ++i) {
+        int n = (i * 7 + t) % 128;
+        if (square(n) != n * n) {
+          ++mismatches;
+        }
+      }
+    });
+  }
+  for (auto& worker : workers) {
+    worker.join();
+  }
+  EXPECT_EQ(mismatches.load(), 0);
+  EXPECT_LE(square.CacheSize(), 64);
+}
@@ -0,0 +1,125 @@
+/*
+ * Copyright (C) 2024  OverbearingPearl
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ * The above copyright notice and this permission notice shall be included in
+ * all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+ * THE SOFTWARE.
+ */
+
+#include <gtest/gtest.h>
+
+#include <atomic>
+#include <chrono>
+#include <functional>
+#include <stdexcept>
+#include <thread>
+#include <tuple>
+#include <vector>
+
+#include "src/side_effects/cache/cache_lru.h"
+#include "src/side_effects/memoization/memoization.h"
+
+namespace {
+
+using IntLruPolicy =
+    side_effects::cache::CacheWithLruPolicy<std::tuple<int>, int>;
+
+}  // namespace
+
+TEST(Memoization, SingleFlight_SlowMiss_DoesNotBlockOtherKeys) {
+  side_effects::memoization::Memoization memoization;
+  std::atomic<bool> released(false);
+  std::atomic<bool> timed_out(false);
+  auto slow = memoization.Memoize(
+      std::function<int(int)>([&](int n) {
+        if (n == 1) {
+          auto deadline =
+              std::chrono::steady_clock::now() + std::chrono::seconds(5);
+          while (!released.load()) {
+            if (std::chrono::steady_clock::now() > deadline) {
+              timed_out = true;
+              break;
+            }
+            std::this_thread::yield();
+          }
+        }
+        return n * 10;
+      }),
+      IntLruPolicy(8));
+
+  EXPECT_EQ(slow(2), 20);
+  std::thread miss([&slow]() { EXPECT_EQ(slow(1), 10); });
+  std::this_thread::sleep_for(std::chrono::milliseconds(20));
+  EXPECT_EQ(slow(2), 20);
+  EXPECT_EQ(slow(3), 30);
+  released = true;
+  miss.join();
+  EXPECT_FALSE(timed_out.load());
+}
+
+TEST(Memoization, SingleFlight_ConcurrentMisses_ComputeOnce) {
+  side_effects::memoization::Memoization memoization;
+  std::atomic<int> calls(0);
+  auto slow = memoization.Memoize(
+      std::function<int(int)>([&calls](int n) {
+        ++calls;
+        std::this_thread::sleep_for(std::chrono::milliseconds(100));
+        return n + 1;
+      }),
+      IntLruPolicy(8));
+
+  std::vector<std::thread> callers;
+  for (int i = 0; i < 8; ++i) {
+    callers.emplace_back([&slow]() { EXPECT_EQ(slow(41), 42); });
+  }
+  for (auto& caller : callers) {
+    caller.join();
+  }
+  EXPECT_EQ(calls.load(), 1);
+}
+
+TEST(Memoization, SingleFlight_Exception_ReachesWaitersAndIsNotCached) {
+  side_effects::memoization::Memoization memoization;
+  std::atomic<int> calls(0);
+  auto flaky = memoization.Memoize(
+      std::function<int(int)>([&calls](int n) -> int {
+        if (++calls == 1) {
+          std::this_thread::sleep_for(std::chrono::milliseconds(200));
+          throw std::runtime_error("transient");
+        }
+        return n;
+      }),
+      IntLruPolicy(8));
+
+  std::atomic<int> failures(0);
+  std::vector<std::thread> callers;
+  for (int i = 0; i < 4; ++i) {
+    callers.emplace_back([&flaky, &failures]() {
+      try {
+        flaky(7);
+      } catch (const std::runtime_error&) {
+        ++failures;
+      }
+    });
+  }
+  for (auto& caller : callers) {
+    caller.join();
+  }
+  EXPECT_EQ(failures.load(), 4);
+  EXPECT_EQ(calls.load(), 1);
+  EXPECT_EQ(flaky(7), 7);
+  EXPECT_EQ(calls.load(), 2);
+}
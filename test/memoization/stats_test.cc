@@ -0,0 +1,128 @@
+/*
+ * Copyright (C) 2024  OverbearingPearl
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ * The above copyright notice and this permission notice shall be included in
+ * all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+ * THE SOFTWARE.
+ */
+
+#include <gtest/gtest.h>
+
+#include <algorithm>
+#include <functional>
+#include <sstream>
+#include <stdexcept>
+#include <string>
+#include <tuple>
+
+#include "src/side_effects/cache/cache_lru.h"
+#include "src/side_effects/memoization/latency_histogram.h"
+#include "src/side_effects/memoization/memoization.h"
+
+using side_effects::memoization::LatencyBuckets;
+
+TEST(Memoization, Stats_HitsMissesAndLoads_Counted) {
+  side_effects::memoization::Memoization memoization;
+  auto square = memoization.Memoize(
+      std::function<int(int)>([](int n) { return n * n; }),
+      side_effects::cache::CacheWithLruPolicy<std::tuple<int>, int>(2));
+  square(1);
+  square(1);
+  square(2);
+  square(3);
+  side_effects::cache::CacheStats stats = square.Stats();
+  EXPECT_EQ(stats.hits, 1);
+  EXPECT_EQ(stats.misses, 3);
+  EXPECT_EQ(stats.loads, 3);
+  EXPECT_EQ(stats.load_failures, 0);
+  EXPECT_EQ(stats.Removals(side_effects::cache::RemovalCause::kCapacity), 1);
+  EXPECT_EQ(stats.size, 2);
+}
+
+TEST(Memoization, Stats_ThrowingLoad_CountedAsFailure) {
+  side_effects::memoization::Memoization memoization;
+  auto fail = memoization.Memoize(std::function<int(int)>(
+      [](int /*n*/) -> int { throw std::runtime_error("no"); }));
+  EXPECT_THROW(fail(1), std::runtime_error);
+  side_effects::cache::CacheStats stats = fail.Stats();
+  EXPECT_EQ(stats.loads, 0);
+  EXPECT_EQ(stats.load_failures, 1);
+  EXPECT_EQ(stats.inserts, 0);
+}
+
+TEST(Memoization, Stats_Sharded_SummedOverShards) {
+  side_effects::memoization::Memoization memoization;
+  auto square = memoization.MemoizeSharded<
+      side_effects::cache::CacheWithLruPolicy<std::tuple<int>, int>>(
+      std::function<int(int)>([](int n) { return n * n; }), 64, 4);
+  square.EnableLoadLatency();
+  for (int round = 0; round < 2; ++round) {
+    for (int i = 0; i < 20; ++i) {
+      square(i);
+    }
+  }
+  side_effects::cache::CacheStats stats = square.Stats();
+  EXPECT_EQ(stats.hits, 20);
+  EXPECT_EQ(stats.misses, 20);
+  EXPECT_EQ(stats.loads, 20);
+  EXPECT_EQ(stats.size, 20);
+  EXPECT_EQ(square.LoadLatency().Count(), 20);
+}
+
+TEST(Memoization, LoadLatency_Disabled_IsEmpty) {
+  side_effects::memoization::Memoization memoization;
+  auto square =
+      memoization.Memoize(std::function<int(int)>([](int n) { return n * n; }));
+  square(1);
+  EXPECT_EQ(square.LoadLatency().Count(), 0);
+  EXPECT_EQ(square.LoadLatency().ValueAtPercentile(99), 0);
+}
+
+TEST(Memoization, LatencyBuckets_EveryValue_WithinItsBucket) {
+  size_t bucket_count = LatencyBuckets::kCount;
+  for (uint64_t value : {0ull, 1ull, 63ull, 64ull, 65ull, 1000ull, 123456789ull,
+                         ~0ull}) {
+    size_t index = LatencyBuckets::IndexOf(value);
+    ASSERT_LT(index, bucket_count);
+    EXPECT_LE(LatencyBuckets::LowestOf(index), value);
+    EXPECT_GE(LatencyBuckets::HighestOf(index), value);
+  }
+  // Relative error stays within 1 / kSubBuckets.
+  size_t index = LatencyBuckets::IndexOf(1000000);
+  EXPECT_LE(LatencyBuckets::HighestOf(index) - LatencyBuckets::LowestOf(index),
+            1000000 / LatencyBuckets::kSubBuckets);
+}
+
+TEST(Memoization, LatencyHistogram_Percentiles_AndExport) {
+  side_effects::memoization::LatencyHistogram histogram;
+  for (uint64_t nanos = 1; nanos <= 100; ++nanos) {
+    histogram.Record(nanos * 1000);
+  }
+  side_effects::memoization::LatencySnapshot snapshot = histogram.Snapshot();
+  EXPECT_EQ(snapshot.Count(), 100);
+  uint64_t median = snapshot.ValueAtPercentile(50);
+  EXPECT_GE(median, 50000);
+  EXPECT_LE(median, 50000 + 50000 / LatencyBuckets::kSubBuckets);
+  EXPECT_GE(snapshot.ValueAtPercentile(100), 100000);
+
+  std::ostringstream csv;
+  snapshot.Export(csv);
+  std::string text = csv.str();
+  EXPECT_EQ(text.compare(0, 26, "lowest_ns,highest_ns,count"), 0);
+  // Header plus one line per non-empty bucket.
+  EXPECT_GT(std::count(text.begin(), text.end(), '\n'), 50);
+  EXPECT_LE(std::count(text.begin(), text.end(), '\n'), 101);
+}
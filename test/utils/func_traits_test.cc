@@ -0,0 +1,92 @@
+/*
+ * Copyright (C) 2024  OverbearingPearl
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ * The above copyright notice and this permission notice shall be included in
+ * all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+ * THE SOFTWARE.
+ */
+
+#include <gtest/gtest.h>
+
+#include <functional>
+#include <string>
+#include <tuple>
+#include <type_traits>
+
+#include "src/utils/traits/func_traits.h"
+
+namespace {
+
+int Twice(int n) { return 2 * n; }
+
+struct Counter {
+  int Add(int n) { return total += n; }
+  int Get() const { return total; }
+
+  int total = 0;
+};
+
+struct Scale {
+  double operator()(double x, int times) const { return x * times; }
+};
+
+template <typename Func, typename ReturnType, typename... Args>
+constexpr bool HasSignature() {
+  return std::is_same<
+             typename utils::traits::FunctionTraits<Func>::result_type,
+             ReturnType>::value &&
+         std::is_same<
+             typename utils::traits::FunctionTraits<Func>::arg_tuple_type,
+             std::tuple<Args...>>::value;
+}
+
+}  // namespace
+
+TEST(Utils, FunctionTraits_EveryCallableKind_SignatureDeduced) {
+  auto lambda = [](const std::string& s, int n) { return s.size() + n; };
+  auto mutable_lambda = [](int n) mutable { return n; };
+  auto noexcept_lambda = [](int n) noexcept { return n; };
+  static_assert(HasSignature<decltype(lambda), size_t, const std::string&,
+                             int>(),
+                "lambda");
+  static_assert(HasSignature<decltype(mutable_lambda), int, int>(),
+                "mutable lambda");
+  static_assert(HasSignature<decltype(noexcept_lambda), int, int>(),
+                "noexcept lambda");
+  static_assert(HasSignature<Scale, double, double, int>(), "functor");
+  static_assert(HasSignature<const Scale&, double, double, int>(),
+                "functor reference");
+  static_assert(HasSignature<decltype(&Twice), int, int>(),
+                "function pointer");
+  static_assert(HasSignature<decltype(Twice), int, int>(), "function");
+  static_assert(HasSignature<std::function<int(int)>, int, int>(),
+                "std::function");
+  static_assert(HasSignature<decltype(&Counter::Add), int, Counter*, int>(),
+                "member function");
+  static_assert(
+      HasSignature<decltype(&Counter::Get), int, const Counter*>(),
+      "const member function");
+}
+
+TEST(Utils, Invoke_MemberFunction_CalledOnPointee) {
+  Counter counter;
+  EXPECT_EQ(utils::traits::Invoke(&Counter::Add, &counter, 3), 3);
+  EXPECT_EQ(utils::traits::Invoke(&Counter::Get,
+                                  static_cast<const Counter*>(&counter)),
+            3);
+  EXPECT_EQ(utils::traits::Invoke(&Twice, 4), 8);
+  EXPECT_EQ(utils::traits::Invoke(Scale(), 1.5, 2), 3.0);
+}
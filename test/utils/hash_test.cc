@@ -0,0 +1,163 @@
+/*
+ * Copyright (C) 2024  OverbearingPearl
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ * The above copyright notice and this permission notice shall be included in
+ * all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+ * THE SOFTWARE.
+ */
+
+#include <gtest/gtest.h>
+
+#include <cstdint>
+#include <set>
+#include <string>
+#include <tuple>
+#include <vector>
+
+#include "src/side_effects/cache/cache_lru.h"
+#include "src/side_effects/memoization/memoization.h"
+#include "src/utils/immutable/hash.h"
+#include "src/utils/immutable/tuple.h"
+
+namespace {
+
+struct Point {
+  int x;
+  int y;
+
+  bool operator==(const Point& other) const {
+    return x == other.x && y == other.y;
+  }
+};
+
+}  // namespace
+
+namespace utils {
+namespace immutable {
+
+template <>
+struct Hasher<Point> {
+  static uint64_t Hash(const Point& value, uint64_t seed) {
+    return HashValue(value.y, HashValue(value.x, seed));
+  }
+};
+
+}  // namespace immutable
+}  // namespace utils
+
+namespace {
+
+using utils::immutable::HashBytes;
+using utils::immutable::HashValue;
+using utils::immutable::StringRef;
+using utils::immutable::TupleHash;
+
+TEST(Utils, Hash_EqualValues_HashAlike) {
+  EXPECT_EQ(HashValue(0.0), HashValue(-0.0));
+  EXPECT_EQ(HashValue(std::string("memo")), HashValue(StringRef("memo")));
+  EXPECT_EQ(TupleHash()(std::make_tuple(std::string("memo"), 1)),
+            TupleHash()(std::make_tuple(StringRef("memo"), 1)));
+  EXPECT_NE(HashValue(std::string("memo")), HashValue(std::string("meme")));
+}
+
+TEST(Utils, Hash_ByteRangesOfEveryLength_AllDiffer) {
+  std::string bytes(200, 'x');
+  std::set<uint64_t> hashes;
+  for (size_t size = 0; size <= bytes.size(); ++size) {
+    hashes.insert(HashBytes(bytes.data(), size, 0));
+  }
+  EXPECT_EQ(hashes.size(), bytes.size() + 1);
+}
+
+TEST(Utils, Hash_SwappedElements_Differ) {
+  EXPECT_NE(TupleHash()(std::make_tuple(1, 2)),
+            TupleHash()(std::make_tuple(2, 1)));
+}
+
+// Small consecutive integers must still fill the control tag and the group
+// bits, which FlatTable takes from the low end of the hash.
+TEST(Utils, Hash_ConsecutiveIntegers_SpreadOverLowBits) {
+  std::vector<int> tags(128, 0);
+  std::vector<int> groups(256, 0);
+  for (int a = 0; a < 128; ++a) {
+    for (int b = 0; b < 128; ++b) {
+      uint64_t hash = TupleHash()(std::make_tuple(a, b));
+      ++tags[hash & 0x7F];
+      ++groups[(hash >> 7) & 0xFF];
+    }
+  }
+  for (int count : tags) {
+    EXPECT_GT(count, 128 / 2);
+    EXPECT_LT(count, 128 * 2);
+  }
+  for (int count : groups) {
+    EXPECT_GT(count, 64 / 2);
+    EXPECT_LT(count, 64 * 2);
+  }
+}
+
+TEST(Memoization, Hash_UserHasher_UsableAsKey) {
+  side_effects::memoization::Memoization memoization;
+  int calls = 0;
+  auto norm = memoization.Memoize(
+      std::function<int(Point)>([&calls](Point p) {
+        ++calls;
+        return p.x * p.x + p.y * p.y;
+      }),
+      side_effects::cache::CacheWithLruPolicy<std::tuple<Point>, int>(4));
+  EXPECT_EQ(norm(Point{3, 4}), 25);
+  EXPECT_EQ(norm(Point{3, 4}), 25);
+  EXPECT_EQ(calls, 1);
+}
+
+TEST(Memoization, Hash_VectorArgument_UsableAsKey) {
+  side_effects::memoization::Memoization memoization;
+  int calls = 0;
+  auto sum = memoization.Memoize(
+      std::function<int(const std::vector<int>&)>(
+          [&calls](const std::vector<int>& values) {
+            ++calls;
+            int total = 0;
+            for (int value : values) total += value;
+            return total;
+          }),
+      side_effects::cache::CacheWithLruPolicy<std::tuple<std::vector<int>>,
+                                              int>(4));
+  EXPECT_EQ(sum(std::vector<int>{1, 2, 3}), 6);
+  EXPECT_EQ(sum(std::vector<int>{1, 2, 3}), 6);
+  EXPECT_EQ(sum(std::vector<int>{3, 2, 1}), 6);
+  EXPECT_EQ(calls, 2);
+}
+
+TEST(Memoization, Hash_CStringArgument_HitsStringKey) {
+  side_effects::memoization::Memoization memoization;
+  int calls = 0;
+  auto length = memoization.Memoize(
+      std::function<size_t(const std::string&)>(
+          [&calls](const std::string& s) {
+            ++calls;
+            return s.size();
+          }),
+      side_effects::cache::CacheWithLruPolicy<std::tuple<std::string>, size_t>(
+          4));
+  EXPECT_EQ(length("memo"), 4u);
+  EXPECT_EQ(length(std::string("memo")), 4u);
+  const char* chars = "memo";
+  EXPECT_EQ(length(chars), 4u);
+  EXPECT_EQ(calls, 1);
+}
+
+}  // namespace